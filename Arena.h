@@ -0,0 +1,126 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Contiguous, non-owning view of `size` elements (typically arena memory).
+template <class T>
+class Span {
+public:
+  Span() = default;
+  Span(T* data, size_t size) : items(data), count(size) {}
+
+  T* begin() const { return items; }
+  T* end() const { return items + count; }
+  T& operator[](size_t i) const { return items[i]; }
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+
+private:
+  T* items = nullptr;
+  size_t count = 0;
+};
+
+// Bump allocator. Objects are carved out of large blocks and never freed
+// individually; the whole arena is released at once when it is destroyed or
+// reset. Destructors are not run, so only trivially destructible types may be
+// allocated from it.
+class Arena {
+public:
+  Arena() = default;
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  Arena(Arena&& other) noexcept {
+    *this = std::move(other);
+  }
+
+  Arena& operator=(Arena&& other) noexcept {
+    if (this != &other) {
+      blocks       = std::move(other.blocks);
+      cursor       = other.cursor;
+      limit        = other.limit;
+      next_block   = other.next_block;
+      used         = other.used;
+      allocations  = other.allocations;
+      other.reset();
+    }
+    return *this;
+  }
+
+  void* allocate(size_t size, size_t align) {
+    size_t pad = (align - reinterpret_cast<uintptr_t>(cursor) % align) % align;
+    if (cursor == nullptr || pad + size > static_cast<size_t>(limit - cursor)) {
+      grow(size + align);
+      pad = (align - reinterpret_cast<uintptr_t>(cursor) % align) % align;
+    }
+    char* result = cursor + pad;
+    cursor = result + size;
+    used += size;
+    allocations++;
+    return result;
+  }
+
+  template <class T, class... Args>
+  T* make(Args&&... args) {
+    static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+    return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+  }
+
+  // Copies `items` into one contiguous run of arena memory.
+  template <class T>
+  Span<T> copy(const std::vector<T>& items) {
+    static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+    if (items.empty()) {
+      return Span<T>();
+    }
+    T* data = static_cast<T*>(allocate(sizeof(T) * items.size(), alignof(T)));
+    for (size_t i = 0; i < items.size(); i++) {
+      new (data + i) T(items[i]);
+    }
+    return Span<T>(data, items.size());
+  }
+
+  // Releases every block in one step.
+  void reset() {
+    blocks.clear();
+    cursor      = nullptr;
+    limit       = nullptr;
+    next_block  = FIRST_BLOCK;
+    used        = 0;
+    allocations = 0;
+  }
+
+  size_t bytesUsed() const {
+    return used;
+  }
+
+  size_t allocationCount() const {
+    return allocations;
+  }
+
+private:
+  static constexpr size_t FIRST_BLOCK = 4 * 1024;
+  static constexpr size_t MAX_BLOCK   = 1024 * 1024;
+
+  std::vector<std::unique_ptr<char[]>> blocks;
+  char* cursor = nullptr;
+  char* limit  = nullptr;
+  size_t next_block  = FIRST_BLOCK;
+  size_t used        = 0;
+  size_t allocations = 0;
+
+  void grow(size_t at_least) {
+    size_t size = std::max(next_block, at_least);
+    blocks.push_back(std::unique_ptr<char[]>(new char[size]));
+    cursor = blocks.back().get();
+    limit  = cursor + size;
+    next_block = std::min(next_block * 2, MAX_BLOCK);
+  }
+};
@@ -0,0 +1,558 @@
+#include "Batch.h"
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include "Bytecode.h"
+
+namespace {
+
+// Where an object's lanes live in the store: `width` words for a bit_vector
+// (one per element), 64 for an integer (one per lane), one for a bit or boolean.
+struct Slot {
+  TypeKind kind;
+  uint32_t width;
+  uint32_t offset;
+};
+
+struct ProcessSlots {
+  std::vector<Slot> registers;
+  std::vector<Slot> variables;
+  std::vector<Slot> constants;
+};
+
+// A Schedule executed under `mask`; the value's words are in LaneSimulator::assigned_words
+struct Assignment {
+  uint32_t signal;
+  uint64_t mask;
+  size_t   offset;
+};
+
+inline uint64_t logicWord(Operator op, uint64_t a, uint64_t b) {
+  switch (op) {
+    case Operator::And:  return a & b;
+    case Operator::Or:   return a | b;
+    case Operator::Xor:  return a ^ b;
+    case Operator::Nand: return ~(a & b);
+    case Operator::Nor:  return ~(a | b);
+    default:             return ~(a ^ b);
+  }
+}
+
+// Relational operators on bits or booleans, lane-wise ('0' < '1', false < true)
+inline uint64_t compareWord(Operator op, uint64_t a, uint64_t b) {
+  switch (op) {
+    case Operator::Equal:     return ~(a ^ b);
+    case Operator::NotEqual:  return a ^ b;
+    case Operator::Less:      return ~a & b;
+    case Operator::LessEqual: return ~a | b;
+    case Operator::Greater:   return a & ~b;
+    default:                  return a | ~b;
+  }
+}
+
+inline bool compareInteger(Operator op, int64_t a, int64_t b) {
+  switch (op) {
+    case Operator::Equal:     return a == b;
+    case Operator::NotEqual:  return a != b;
+    case Operator::Less:      return a < b;
+    case Operator::LessEqual: return a <= b;
+    case Operator::Greater:   return a > b;
+    default:                  return a >= b;
+  }
+}
+
+inline bool isLogical(Operator op) {
+  return op == Operator::And || op == Operator::Or || op == Operator::Xor ||
+         op == Operator::Nand || op == Operator::Nor || op == Operator::Xnor;
+}
+
+// Runs up to BATCH_LANES streams of one design in lockstep, mirroring the
+// cycle-based mode of Simulator step by step.
+class LaneSimulator {
+public:
+  LaneSimulator(const Design& design, const CyclePlan& plan, const std::vector<Program>& programs,
+                std::vector<const StimulusStream*> lanes)
+    : design(design), plan(plan), programs(programs), lanes(std::move(lanes)) {
+    active_lanes = this->lanes.size() == 64 ? ~uint64_t(0) : (uint64_t(1) << this->lanes.size()) - 1;
+
+    // Lay out every object first: the store is never resized afterwards
+    size_t words = 0;
+    auto allocate = [&words](TypeKind kind, size_t width) {
+      Slot slot{kind, static_cast<uint32_t>(width), static_cast<uint32_t>(words)};
+      words += kind == TypeKind::Integer ? 64 : width;
+      return slot;
+    };
+    auto widthOf = [](const Value& value) { return value.kind == TypeKind::BitVector ? value.bits.width() : 1; };
+
+    for (const SignalInfo& signal : design.signals) {
+      signal_slots.push_back(allocate(signal.type.kind, signal.type.width()));
+    }
+    slots.resize(design.processes.size());
+    size_t longest = 0;
+    for (size_t p = 0; p < design.processes.size(); p++) {
+      for (const Value& value : programs[p].registers) {
+        slots[p].registers.push_back(allocate(value.kind, widthOf(value)));
+      }
+      for (const VariableInfo& variable : design.processes[p].variables) {
+        slots[p].variables.push_back(allocate(variable.type.kind, variable.type.width()));
+      }
+      for (const Value& value : programs[p].constants) {
+        slots[p].constants.push_back(allocate(value.kind, widthOf(value)));
+      }
+      longest = std::max(longest, programs[p].code.size());
+    }
+    store.assign(words, 0);
+    reached.assign(longest + 1, 0);
+    changed.assign(design.signals.size(), 0);
+
+    size_t widest = 64;
+    for (size_t s = 0; s < design.signals.size(); s++) {
+      fill(signal_slots[s], design.signals[s].initial);
+      widest = std::max<size_t>(widest, signal_slots[s].width);
+    }
+    for (size_t p = 0; p < design.processes.size(); p++) {
+      for (size_t i = 0; i < slots[p].registers.size(); i++) {
+        fill(slots[p].registers[i], programs[p].registers[i]);
+        widest = std::max<size_t>(widest, slots[p].registers[i].width);
+      }
+      for (size_t i = 0; i < slots[p].variables.size(); i++) {
+        fill(slots[p].variables[i], design.processes[p].variables[i].initial);
+        widest = std::max<size_t>(widest, slots[p].variables[i].width);
+      }
+      for (size_t i = 0; i < slots[p].constants.size(); i++) {
+        fill(slots[p].constants[i], programs[p].constants[i]);
+      }
+    }
+    scratch.assign(widest, 0);
+  }
+
+  // Fills responses[lane] for every lane.
+  void run(const std::vector<uint32_t>& outputs, StreamResponses* responses) {
+    // Every process runs once against the initial values
+    for (uint32_t p = 0; p < design.processes.size(); p++) {
+      execute(p, active_lanes);
+    }
+    commit();
+
+    std::vector<SimTime> times;
+    for (const StimulusStream* stream : lanes) {
+      times.insert(times.end(), stream->times.begin(), stream->times.end());
+    }
+    std::sort(times.begin(), times.end());
+    times.erase(std::unique(times.begin(), times.end()), times.end());
+    if (times.empty() || times.front() > 0) {
+      settle();
+    }
+
+    std::vector<size_t> next_row(lanes.size(), 0);
+    for (SimTime time : times) {
+      // Apply this time's rows
+      uint64_t sampled = 0;
+      for (size_t lane = 0; lane < lanes.size(); lane++) {
+        const StimulusStream& stream = *lanes[lane];
+        size_t row = next_row[lane];
+        if (row == stream.times.size() || stream.times[row] != time) continue;
+        sampled |= uint64_t(1) << lane;
+        for (size_t d = row == 0 ? 0 : stream.row_ends[row - 1]; d < stream.row_ends[row]; d++) {
+          const StimulusDrive& drive = stream.drives[d];
+          if (laneValue(signal_slots[drive.signal], lane) != drive.value) {
+            setLane(signal_slots[drive.signal], lane, drive.value);
+            changed[drive.signal] |= uint64_t(1) << lane;
+          }
+        }
+      }
+
+      // Woken sequential processes see the new inputs but not yet the logic they feed
+      for (uint32_t p = 0; p < design.processes.size(); p++) {
+        if (plan.roles[p] == ProcessRole::Sequential) {
+          if (uint64_t mask = wokenLanes(p)) {
+            execute(p, mask);
+          }
+        }
+      }
+      commit();
+      settle();
+
+      for (size_t lane = 0; lane < lanes.size(); lane++) {
+        if (!(sampled >> lane & 1)) continue;
+        std::vector<Value>& sample = responses[lane].samples.emplace_back();
+        for (uint32_t signal : outputs) {
+          sample.push_back(laneValue(signal_slots[signal], lane));
+        }
+        next_row[lane]++;
+      }
+    }
+  }
+
+private:
+  const Design& design;
+  const CyclePlan& plan;
+  const std::vector<Program>& programs;
+  std::vector<const StimulusStream*> lanes;
+  uint64_t active_lanes = 0;
+
+  std::vector<uint64_t> store;
+  std::vector<Slot> signal_slots;
+  std::vector<ProcessSlots> slots;       // per process
+  const ProcessSlots* running = nullptr;
+
+  std::vector<uint64_t> changed;         // per signal: lanes it changed in since the last settle
+  std::vector<uint64_t> reached;         // per instruction: lanes that get there
+  std::vector<uint64_t> scratch;
+  std::vector<Assignment> assignments;
+  std::vector<uint64_t> assigned_words;
+
+  uint64_t* at(const Slot& slot) {
+    return store.data() + slot.offset;
+  }
+
+  const Slot& operand(uint32_t ref) const {
+    uint32_t index = ref & OPERAND_INDEX_MASK;
+    switch (static_cast<Space>(ref >> 30)) {
+      case Space::Register: return running->registers[index];
+      case Space::Variable: return running->variables[index];
+      case Space::Signal:   return signal_slots[index];
+      default:              return running->constants[index];
+    }
+  }
+
+  // Sets every lane of `slot` to `value`
+  void fill(const Slot& slot, const Value& value) {
+    uint64_t* words = at(slot);
+    switch (slot.kind) {
+      case TypeKind::Integer:
+        std::fill(words, words + 64, static_cast<uint64_t>(value.scalar));
+        break;
+      case TypeKind::BitVector:
+        for (size_t i = 0; i < slot.width; i++) {
+          words[i] = value.bits.get(i) ? ~uint64_t(0) : 0;
+        }
+        break;
+      default:
+        words[0] = value.scalar ? ~uint64_t(0) : 0;
+        break;
+    }
+  }
+
+  Value laneValue(const Slot& slot, size_t lane) {
+    const uint64_t* words = at(slot);
+    switch (slot.kind) {
+      case TypeKind::Bit:     return Value::makeBit(words[0] >> lane & 1);
+      case TypeKind::Boolean: return Value::makeBoolean(words[0] >> lane & 1);
+      case TypeKind::Integer: return Value::makeInteger(static_cast<int64_t>(words[lane]));
+      case TypeKind::BitVector: break;
+    }
+    Value value = Value::makeVector(slot.width, false);
+    for (size_t i = 0; i < slot.width; i++) {
+      if (words[i] >> lane & 1) {
+        value.bits.set(i, true);
+      }
+    }
+    return value;
+  }
+
+  void setLane(const Slot& slot, size_t lane, const Value& value) {
+    uint64_t* words = at(slot);
+    uint64_t bit = uint64_t(1) << lane;
+    switch (slot.kind) {
+      case TypeKind::Integer:
+        words[lane] = static_cast<uint64_t>(value.scalar);
+        break;
+      case TypeKind::BitVector:
+        for (size_t i = 0; i < slot.width; i++) {
+          words[i] = value.bits.get(i) ? words[i] | bit : words[i] & ~bit;
+        }
+        break;
+      default:
+        words[0] = value.scalar ? words[0] | bit : words[0] & ~bit;
+        break;
+    }
+  }
+
+  // Writes `value` into the lanes of `mask`
+  void blend(const Slot& slot, const uint64_t* value, uint64_t mask) {
+    uint64_t* words = at(slot);
+    if (slot.kind == TypeKind::Integer) {
+      for (; mask; mask &= mask - 1) {
+        unsigned lane = __builtin_ctzll(mask);
+        words[lane] = value[lane];
+      }
+      return;
+    }
+    size_t count = slot.kind == TypeKind::BitVector ? slot.width : 1;
+    for (size_t i = 0; i < count; i++) {
+      words[i] = (words[i] & ~mask) | (value[i] & mask);
+    }
+  }
+
+  // Runs body(lane) for each lane of `mask`, naming the lane's stream in errors
+  template <class Body>
+  void eachLane(uint64_t mask, Body&& body) {
+    for (; mask; mask &= mask - 1) {
+      unsigned lane = __builtin_ctzll(mask);
+      try {
+        body(lane);
+      } catch (const std::exception& e) {
+        throw std::runtime_error("stream " + std::to_string(lanes[lane]->id) + ": " + e.what());
+      }
+    }
+  }
+
+  uint64_t wokenLanes(uint32_t process) const {
+    uint64_t mask = 0;
+    for (uint32_t signal : design.processes[process].sensitivity) {
+      mask |= changed[signal];
+    }
+    return mask & active_lanes;
+  }
+
+  // Evaluates every combinational process whose inputs changed in some lane,
+  // in level order, then forgets the changes.
+  void settle() {
+    for (uint32_t process : plan.order) {
+      if (uint64_t mask = wokenLanes(process)) {
+        execute(process, mask);
+        commit();
+      }
+    }
+    std::fill(changed.begin(), changed.end(), 0);
+  }
+
+  void commit() {
+    for (const Assignment& assignment : assignments) {
+      const Slot& slot = signal_slots[assignment.signal];
+      uint64_t* words = at(slot);
+      const uint64_t* value = assigned_words.data() + assignment.offset;
+      uint64_t diff = 0;
+      if (slot.kind == TypeKind::Integer) {
+        for (uint64_t mask = assignment.mask; mask; mask &= mask - 1) {
+          unsigned lane = __builtin_ctzll(mask);
+          if (words[lane] != value[lane]) {
+            diff |= uint64_t(1) << lane;
+            words[lane] = value[lane];
+          }
+        }
+      } else {
+        size_t count = slot.kind == TypeKind::BitVector ? slot.width : 1;
+        for (size_t i = 0; i < count; i++) {
+          diff |= (words[i] ^ value[i]) & assignment.mask;
+          words[i] = (words[i] & ~assignment.mask) | (value[i] & assignment.mask);
+        }
+      }
+      changed[assignment.signal] |= diff;
+    }
+    assignments.clear();
+    assigned_words.clear();
+  }
+
+  // Runs the program of `process` in the lanes of `mask`. Jumps only go
+  // forward, so walking the code once in order, with each instruction run
+  // for the lanes that reached it, covers every path.
+  void execute(uint32_t process, uint64_t mask) {
+    const std::vector<Instruction>& code = programs[process].code;
+    running = &slots[process];
+    std::fill(reached.begin(), reached.begin() + code.size() + 1, 0);
+    reached[0] = mask;
+
+    for (size_t pc = 0; pc < code.size(); pc++) {
+      uint64_t lanes_here = reached[pc];
+      if (!lanes_here) continue;
+      const Instruction& instruction = code[pc];
+      switch (instruction.op) {
+        case OpCode::Jump:
+          reached[instruction.a] |= lanes_here;
+          continue;
+        case OpCode::JumpIfFalse: {
+          uint64_t condition = at(operand(instruction.b))[0];
+          reached[instruction.a] |= lanes_here & ~condition;
+          reached[pc + 1] |= lanes_here & condition;
+          continue;
+        }
+        case OpCode::Halt:
+          continue;
+        case OpCode::CheckRange: {
+          const RangeCheck& range = programs[process].ranges[instruction.c];
+          const uint64_t* x = at(operand(instruction.b));
+          eachLane(lanes_here, [&](unsigned lane) {
+            checkRange(range.type, static_cast<int64_t>(x[lane]), range.target);
+          });
+          reached[pc + 1] |= lanes_here;
+          continue;
+        }
+        default:
+          step(instruction, lanes_here);
+          reached[pc + 1] |= lanes_here;
+      }
+    }
+  }
+
+  void step(const Instruction& instruction, uint64_t mask) {
+    const Slot& target = instruction.op == OpCode::Schedule ? signal_slots[instruction.a] : operand(instruction.a);
+    const Slot& left = operand(instruction.b);
+    const uint64_t* x = at(left);
+    uint64_t* out = at(target);
+    const uint64_t* y = nullptr;
+    switch (instruction.op) {
+      case OpCode::LogicScalar: case OpCode::CompareScalar:
+      case OpCode::Add: case OpCode::Subtract: case OpCode::Arith:
+        y = at(operand(instruction.c));
+        break;
+      default:
+        break;
+    }
+    Operator op = instruction.sub;
+
+    switch (instruction.op) {
+      case OpCode::Copy:
+        blend(target, x, mask);
+        return;
+      case OpCode::NotScalar:
+        scratch[0] = ~x[0];
+        blend(target, scratch.data(), mask);
+        return;
+      case OpCode::LogicScalar:
+        scratch[0] = logicWord(op, x[0], y[0]);
+        blend(target, scratch.data(), mask);
+        return;
+      case OpCode::CompareScalar:
+        if (left.kind == TypeKind::Integer) {
+          scratch[0] = 0;
+          eachLane(mask, [&](unsigned lane) {
+            scratch[0] |= uint64_t(compareInteger(op, static_cast<int64_t>(x[lane]), static_cast<int64_t>(y[lane]))) << lane;
+          });
+        } else {
+          scratch[0] = compareWord(op, x[0], y[0]);
+        }
+        blend(target, scratch.data(), mask);
+        return;
+      case OpCode::Add:
+        eachLane(mask, [&](unsigned lane) {
+          out[lane] = static_cast<uint64_t>(addInteger(static_cast<int64_t>(x[lane]), static_cast<int64_t>(y[lane])));
+        });
+        return;
+      case OpCode::Subtract:
+        eachLane(mask, [&](unsigned lane) {
+          out[lane] = static_cast<uint64_t>(subtractInteger(static_cast<int64_t>(x[lane]), static_cast<int64_t>(y[lane])));
+        });
+        return;
+      case OpCode::Arith:
+        eachLane(mask, [&](unsigned lane) {
+          Value result = evaluateBinary(op, Value::makeInteger(static_cast<int64_t>(x[lane])),
+                                        Value::makeInteger(static_cast<int64_t>(y[lane])));
+          out[lane] = static_cast<uint64_t>(result.scalar);
+        });
+        return;
+      case OpCode::Negate:
+        eachLane(mask, [&](unsigned lane) { out[lane] = static_cast<uint64_t>(negateInteger(static_cast<int64_t>(x[lane]))); });
+        return;
+      case OpCode::Absolute:
+        eachLane(mask, [&](unsigned lane) { out[lane] = static_cast<uint64_t>(absInteger(static_cast<int64_t>(x[lane]))); });
+        return;
+      case OpCode::Unary:
+        if (op == Operator::Not && left.kind == TypeKind::BitVector) {
+          for (size_t i = 0; i < left.width; i++) {
+            scratch[i] = ~x[i];
+          }
+          blend(target, scratch.data(), mask);
+          return;
+        }
+        eachLane(mask, [&](unsigned lane) { setLane(target, lane, evaluateUnary(op, laneValue(left, lane))); });
+        return;
+      case OpCode::Binary:
+        binary(instruction, target, mask);
+        return;
+      case OpCode::Fill:
+        std::fill(scratch.begin(), scratch.begin() + instruction.c, x[0]);
+        blend(target, scratch.data(), mask);
+        return;
+      case OpCode::Schedule: {
+        size_t count = left.kind == TypeKind::Integer ? 64 : left.kind == TypeKind::BitVector ? left.width : 1;
+        assignments.push_back(Assignment{instruction.a, mask, assigned_words.size()});
+        assigned_words.insert(assigned_words.end(), x, x + count);
+        return;
+      }
+      default:
+        return;
+    }
+  }
+
+  void binary(const Instruction& instruction, const Slot& target, uint64_t mask) {
+    const Slot& left = operand(instruction.b);
+    const Slot& right = operand(instruction.c);
+    const uint64_t* x = at(left);
+    const uint64_t* y = at(right);
+    Operator op = instruction.sub;
+    bool vectors = left.kind == TypeKind::BitVector && right.kind == TypeKind::BitVector;
+
+    if (isLogical(op) && vectors && left.width == right.width) {
+      for (size_t i = 0; i < left.width; i++) {
+        scratch[i] = logicWord(op, x[i], y[i]);
+      }
+      blend(target, scratch.data(), mask);
+      return;
+    }
+    if ((op == Operator::Equal || op == Operator::NotEqual) && vectors && left.width == right.width) {
+      uint64_t differ = 0;
+      for (size_t i = 0; i < left.width; i++) {
+        differ |= x[i] ^ y[i];
+      }
+      scratch[0] = op == Operator::Equal ? ~differ : differ;
+      blend(target, scratch.data(), mask);
+      return;
+    }
+    if (op == Operator::Concat && target.kind == TypeKind::BitVector) {
+      // A bit operand is laid out like a one-element vector; the right operand takes the low elements
+      std::copy(y, y + right.width, scratch.begin());
+      std::copy(x, x + left.width, scratch.begin() + right.width);
+      blend(target, scratch.data(), mask);
+      return;
+    }
+    eachLane(mask, [&](unsigned lane) {
+      setLane(target, lane, evaluateBinary(op, laneValue(left, lane), laneValue(right, lane)));
+    });
+  }
+};
+
+} // namespace
+
+std::vector<StreamResponses> simulateBatch(const Design& design, const CyclePlan& plan, const Stimulus& stimulus,
+                                           const std::vector<uint32_t>& outputs, ThreadPool* pool) {
+  if (!plan.usable) {
+    throw std::runtime_error("batch simulation needs a cycle-based design: " + plan.reason);
+  }
+  std::vector<Program> programs;
+  for (const ProcessInfo& process : design.processes) {
+    programs.push_back(compileProcess(design, process));
+  }
+
+  size_t streams = stimulus.streams.size();
+  size_t groups = (streams + BATCH_LANES - 1) / BATCH_LANES;
+  std::vector<StreamResponses> responses(streams);
+  std::vector<std::exception_ptr> errors(groups);
+  auto runGroup = [&](size_t group) {
+    try {
+      std::vector<const StimulusStream*> lanes;
+      for (size_t s = group * BATCH_LANES; s < std::min(streams, (group + 1) * BATCH_LANES); s++) {
+        lanes.push_back(&stimulus.streams[s]);
+      }
+      LaneSimulator simulator(design, plan, programs, std::move(lanes));
+      simulator.run(outputs, responses.data() + group * BATCH_LANES);
+    } catch (...) {
+      errors[group] = std::current_exception();
+    }
+  };
+
+  if (pool && groups > 1) {
+    pool->parallelFor(groups, runGroup);
+  } else {
+    for (size_t group = 0; group < groups; group++) {
+      runGroup(group);
+    }
+  }
+  for (const std::exception_ptr& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+  return responses;
+}
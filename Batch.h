@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "Elaborate.h"
+#include "Levelize.h"
+#include "Stimulus.h"
+#include "ThreadPool.h"
+
+// Batch simulation: many stimulus streams advanced in lockstep through one
+// pass over the design.
+//
+// Streams are taken BATCH_LANES at a time, one lane each, and every value is
+// stored bit-sliced across the lanes: a bit or boolean is one 64-bit word
+// holding that object in all lanes, a bit_vector one such word per element,
+// and an integer one word per lane. Logical operators, comparisons of bits,
+// concatenation, `not`, fills and equality of bit_vectors then handle all
+// lanes with a few word operations; other operators are evaluated lane by
+// lane. Each process runs once per step under a mask of the lanes it is
+// active in, and an `if` narrows that mask for each branch instead of
+// jumping.
+//
+// Only designs with a usable CyclePlan can be batched, since the cycle-based
+// schedule is the same in every lane. Responses equal running each stream
+// alone with simulateStream(); groups of streams run on `pool` when given.
+std::vector<StreamResponses> simulateBatch(const Design& design, const CyclePlan& plan, const Stimulus& stimulus,
+                                           const std::vector<uint32_t>& outputs, ThreadPool* pool);
+
+constexpr size_t BATCH_LANES = 64;
@@ -0,0 +1,456 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+#include "SourceBuffer.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "Scan.h"
+#include "ThreadPool.h"
+#include "Elaborate.h"
+#include "Levelize.h"
+#include "Simulator.h"
+
+// Benchmark suite for the front end and the simulator.
+//
+// Without file arguments it generates a synthetic project -- N entities with
+// wide bit_vector ports, clocked processes with nested ifs, and long comment
+// blocks -- and measures, best of --repeat runs:
+//
+//   scan     lexer MB/s for each scanning backend (scalar, SSE2, AVX2)
+//   lex      MB/s and tokens/s with the best backend
+//   lex ||   MB/s of Lexer::lexParallel over all inputs joined into one
+//            buffer; unlike `lex` it stores every token, as the parser needs
+//   parse    AST nodes/s (lexing included, as the parser pulls tokens)
+//   simulate events/s, clocking every generated design for --cycles cycles
+//
+// plus the peak resident set size. Given files, only the front end is
+// measured. --json FILE also writes the results in a stable, machine-readable
+// form for tracking across builds.
+//
+//   ./vhdl_bench [--repeat N] [--entities N] [--width BITS] [--depth D]
+//                [--comments LINES] [--cycles N] [--json FILE] [file.vhd ...]
+
+struct BenchConfig {
+  int repeat        = 5;
+  int entities      = 2000;
+  int width         = 64;  // bits of the data ports and registers
+  int depth         = 4;   // nesting of the ifs in each process
+  int comment_lines = 8;   // per comment block; one block per entity and per process
+  int processes     = 4;   // clocked processes per architecture
+  int cycles        = 2000;
+};
+
+static void commentBlock(std::string& out, const std::string& indent, const std::string& subject, int lines) {
+  for (int i = 0; i < lines; i++) {
+    out += indent + "-- " + subject + ": generated for the benchmark, line " + std::to_string(i) +
+           " of a header in the style of vendor license and revision comments.\n";
+  }
+}
+
+// One entity with its architecture, as a standalone file
+static std::string syntheticUnit(const BenchConfig& config, int unit) {
+  std::string n = std::to_string(unit);
+  std::string vector = "bit_vector(" + std::to_string(config.width - 1) + " downto 0)";
+  std::string out;
+  commentBlock(out, "", "entity bench_" + n, config.comment_lines);
+  out += "entity bench_" + n + " is\n";
+  out += "  port (\n";
+  out += "    clk   : in  bit;\n";
+  out += "    reset : in  bit;\n";
+  out += "    din   : in  " + vector + ";\n";
+  out += "    dout  : out " + vector + "\n";
+  out += "  );\n";
+  out += "end entity;\n\n";
+  out += "architecture rtl of bench_" + n + " is\n";
+  for (int p = 0; p < config.processes; p++) {
+    out += "  signal stage" + std::to_string(p) + " : " + vector + ";\n";
+  }
+  out += "  signal count : integer := 0;\n";
+  out += "begin\n";
+  out += "  process(clk)\n  begin\n    if clk = '1' then\n      count <= count + 1;\n    end if;\n  end process;\n\n";
+
+  for (int p = 0; p < config.processes; p++) {
+    std::string source = p == 0 ? "din" : "stage" + std::to_string(p - 1);
+    commentBlock(out, "  ", "stage " + std::to_string(p), config.comment_lines);
+    out += "  process(clk, reset)\n";
+    out += "    variable t : " + vector + ";\n";
+    out += "  begin\n";
+    out += "    if reset = '1' then\n";
+    out += "      stage" + std::to_string(p) + " <= (others => '0');\n";
+    out += "    elsif clk = '1' then\n";
+    out += "      t := " + source + " xor din;\n";
+    std::string indent = "      ";
+    for (int d = 0; d < config.depth; d++) {
+      out += indent + "if count mod " + std::to_string(d + 2) + " = " + std::to_string(p % (d + 2)) + " then\n";
+      indent += "  ";
+    }
+    out += indent + "t := t rol 1;\n";
+    for (int d = config.depth; d-- > 0;) {
+      indent.resize(indent.size() - 2);
+      out += indent + "else\n";
+      out += indent + "  t := not (t xor " + source + ");\n";
+      out += indent + "end if;\n";
+    }
+    out += "      stage" + std::to_string(p) + " <= t;\n";
+    out += "    end if;\n";
+    out += "  end process;\n\n";
+  }
+  out += "  dout <= stage" + std::to_string(config.processes - 1) + ";\n";
+  out += "end architecture;\n\n";
+  return out;
+}
+
+static size_t lexAll(std::string_view input) {
+  Lexer lexer(input);
+  size_t count = 0;
+  while (true) {
+    Token token = lexer.getNextToken();
+    if (token.getTokenType() == TokenType::EoF || token.getTokenType() == TokenType::Error) {
+      break;
+    }
+    count++;
+  }
+  return count;
+}
+
+// Walks every line of the input through the newline kernel alone, which is
+// what the lexer does for the body of each "--" comment.
+static size_t scanLines(std::string_view input) {
+  const ScanKernels& scan = scanKernels();
+  size_t lines = 0;
+  for (size_t pos = 0; pos < input.size(); pos++) {
+    pos = scan.toNewline(input.data(), pos, input.size());
+    lines++;
+  }
+  return lines;
+}
+
+// Arena allocations of a parsed file: one per node, node list or expression
+static size_t nodeCount(const VhdlFile& file) {
+  return file.allocationCount();
+}
+
+static size_t peakRssKb() {
+#ifdef _WIN32
+  return 0;
+#else
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<size_t>(usage.ru_maxrss);  // kilobytes on Linux
+#endif
+}
+
+template <class Body>
+static double secondsOf(Body&& body) {
+  auto start = std::chrono::steady_clock::now();
+  body();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+struct BackendResult {
+  const char* name;
+  bool supported;
+  double lex_mb_s;
+  double lines_mb_s;
+};
+
+struct SimulationResult {
+  size_t designs = 0;
+  size_t cycle_based = 0;
+  uint64_t events = 0;
+  uint64_t process_runs = 0;
+  double seconds = 0;
+};
+
+// Clocks every design: reset for the first cycle, a new `din` every cycle
+static SimulationResult simulateAll(const std::vector<VhdlFile>& files, const BenchConfig& config) {
+  SimulationResult result;
+  const SimTime period = 10 * 1000 * 1000;  // 10 ns
+  for (const VhdlFile& file : files) {
+    for (const auto& unit : file.architectures) {
+      const ArchitectureDeclaration& archtc = *unit.declaration;
+      Design design = Design::elaborate(*file.findEntity(archtc.entity_name), archtc);
+      CyclePlan plan = CyclePlan::analyze(design);
+      Simulator simulator(design);
+      if (plan.usable) {
+        simulator.useCyclePlan(plan);
+        result.cycle_based++;
+      }
+      uint32_t clk   = static_cast<uint32_t>(design.findSignal(NameTable::global().intern("clk")));
+      uint32_t reset = static_cast<uint32_t>(design.findSignal(NameTable::global().intern("reset")));
+      uint32_t din   = static_cast<uint32_t>(design.findSignal(NameTable::global().intern("din")));
+
+      Value data = Value::makeVector(static_cast<size_t>(config.width), false);
+      uint64_t seed = 0x9E3779B97F4A7C15ull;
+      result.seconds += secondsOf([&] {
+        simulator.drive(reset, Value::makeBit(true), 0);
+        simulator.drive(reset, Value::makeBit(false), period);
+        for (int cycle = 0; cycle < config.cycles; cycle++) {
+          SimTime time = static_cast<SimTime>(cycle) * period;
+          for (size_t i = 0; i < data.bits.wordCount(); i++) {
+            seed ^= seed << 13, seed ^= seed >> 7, seed ^= seed << 17;
+            data.bits.words()[i] = seed;
+          }
+          if (config.width % 64 != 0) {
+            data.bits.words()[data.bits.wordCount() - 1] &= (uint64_t(1) << (config.width % 64)) - 1;
+          }
+          simulator.drive(din, data, time);
+          simulator.drive(clk, Value::makeBit(true), time + period / 2);
+          simulator.drive(clk, Value::makeBit(false), time + period);
+          simulator.run(time + period);
+        }
+      });
+      result.designs++;
+      result.events += simulator.stats().events;
+      result.process_runs += simulator.stats().process_runs;
+    }
+  }
+  return result;
+}
+
+int main(int argc, char* argv[]) {
+  BenchConfig config;
+  std::string json_path;
+  std::vector<std::string> paths;
+  try {
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      auto number = [&](int minimum) {
+        std::string_view text = argv[++i];
+        int value = 0;
+        auto parsed = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (text.empty() || parsed.ec != std::errc() || parsed.ptr != text.data() + text.size()) {
+          throw std::runtime_error(arg + " expects a number");
+        }
+        return std::max(minimum, value);
+      };
+      if (i + 1 < argc && arg == "--repeat") {
+        config.repeat = number(1);
+      } else if (i + 1 < argc && arg == "--entities") {
+        config.entities = number(1);
+      } else if (i + 1 < argc && arg == "--width") {
+        config.width = number(1);
+      } else if (i + 1 < argc && arg == "--depth") {
+        config.depth = number(0);
+      } else if (i + 1 < argc && arg == "--comments") {
+        config.comment_lines = number(0);
+      } else if (i + 1 < argc && arg == "--cycles") {
+        config.cycles = number(0);
+      } else if (i + 1 < argc && arg == "--json") {
+        json_path = argv[++i];
+      } else {
+        paths.push_back(arg);
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+  }
+
+  // Each input is one file of one or more design units
+  std::vector<SourceBuffer> sources;
+  std::vector<std::string> generated;
+  std::vector<std::string_view> inputs;
+  if (paths.empty()) {
+    for (int unit = 0; unit < config.entities; unit++) {
+      generated.push_back(syntheticUnit(config, unit));
+    }
+    inputs.assign(generated.begin(), generated.end());
+  } else {
+    for (const auto& path : paths) {
+      SourceBuffer source;
+      if (!source.open(path)) {
+        std::cerr << "Error: Could not open file " << path << "\n";
+        return 1;
+      }
+      sources.push_back(std::move(source));
+    }
+    for (const auto& source : sources) {
+      inputs.push_back(source.view());
+    }
+  }
+
+  size_t total_bytes = 0;
+  for (auto input : inputs) {
+    total_bytes += input.size();
+  }
+  double megabytes = total_bytes / (1024.0 * 1024.0);
+
+  std::cout << "input: " << megabytes << " MB in " << inputs.size() << " files, best of " << config.repeat << " runs\n";
+  std::cout << std::left << std::setw(8) << "backend" << std::right
+            << std::setw(12) << "tokens" << std::setw(12) << "lex MB/s" << std::setw(12) << "speedup"
+            << std::setw(14) << "lines MB/s" << std::setw(12) << "speedup" << "\n";
+
+  std::vector<BackendResult> backends;
+  double scalar_rate = 0;
+  double scalar_line_rate = 0;
+  size_t tokens = 0;
+  for (ScanBackend backend : {ScanBackend::Scalar, ScanBackend::SSE2, ScanBackend::AVX2}) {
+    if (!setScanBackend(backend)) {
+      std::cout << std::left << std::setw(8) << scanBackendName(backend) << "  (not supported)\n";
+      backends.push_back(BackendResult{scanBackendName(backend), false, 0, 0});
+      continue;
+    }
+
+    double best = 0;
+    double best_lines = 0;
+    for (int r = 0; r < config.repeat; r++) {
+      double seconds = secondsOf([&] {
+        tokens = 0;
+        for (auto input : inputs) {
+          tokens += lexAll(input);
+        }
+      });
+      best = std::max(best, megabytes / seconds);
+
+      size_t lines = 0;
+      seconds = secondsOf([&] {
+        for (auto input : inputs) {
+          lines += scanLines(input);
+        }
+      });
+      if (lines > 0) {
+        best_lines = std::max(best_lines, megabytes / seconds);
+      }
+    }
+    if (backend == ScanBackend::Scalar) {
+      scalar_rate = best;
+      scalar_line_rate = best_lines;
+    }
+    backends.push_back(BackendResult{scanBackendName(backend), true, best, best_lines});
+
+    std::cout << std::left << std::setw(8) << scanBackendName(backend) << std::right
+              << std::setw(12) << tokens << std::setw(12) << std::fixed << std::setprecision(1) << best
+              << std::setw(11) << std::setprecision(2) << best / scalar_rate << "x"
+              << std::setw(14) << std::setprecision(1) << best_lines
+              << std::setw(11) << std::setprecision(2) << best_lines / scalar_line_rate << "x\n";
+  }
+
+  // The remaining stages use the best backend, as the simulator does
+  const BackendResult* fastest = nullptr;
+  for (const BackendResult& result : backends) {
+    if (result.supported && (!fastest || result.lex_mb_s > fastest->lex_mb_s)) {
+      fastest = &result;
+    }
+  }
+  for (ScanBackend backend : {ScanBackend::Scalar, ScanBackend::SSE2, ScanBackend::AVX2}) {
+    if (fastest->name == std::string(scanBackendName(backend))) {
+      setScanBackend(backend);
+    }
+  }
+
+  // One large file, as a generated netlist would be, split across every core
+  std::string joined;
+  joined.reserve(total_bytes + inputs.size());
+  for (auto input : inputs) {
+    joined.append(input.data(), input.size());
+    joined += '\n';
+  }
+  ThreadPool pool;
+  size_t chunk_bytes = std::max<size_t>(joined.size() / (pool.size() * 4), 64 << 10);
+  double best_parallel = 0;
+  for (int r = 0; r < config.repeat; r++) {
+    double seconds = secondsOf([&] {
+      Lexer::lexParallel(joined, pool, chunk_bytes);
+    });
+    best_parallel = std::max(best_parallel, joined.size() / (1024.0 * 1024.0) / seconds);
+  }
+
+  double best_parse = 0;
+  size_t nodes = 0;
+  std::vector<VhdlFile> files;
+  for (int r = 0; r < config.repeat; r++) {
+    std::vector<VhdlFile> parsed;
+    parsed.reserve(inputs.size());
+    double seconds = 0;
+    try {
+      seconds = secondsOf([&] {
+        for (auto input : inputs) {
+          Lexer lexer(input);
+          TokenStream stream(lexer);
+          Parser parser(stream);
+          parser.parse();
+          parsed.push_back(std::move(parser.getTree()));
+        }
+      });
+    } catch (const std::exception& e) {
+      std::cerr << "Parsing error: " << e.what() << "\n";
+      return 1;
+    }
+    nodes = 0;
+    for (const VhdlFile& file : parsed) {
+      nodes += nodeCount(file);
+    }
+    best_parse = std::max(best_parse, nodes / seconds);
+    files = std::move(parsed);
+  }
+
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << "\nlex      " << fastest->lex_mb_s << " MB/s, " << std::setprecision(0)
+            << tokens * (fastest->lex_mb_s / megabytes) << " tokens/s (" << fastest->name << ")\n";
+  std::cout << "lex ||   " << std::setprecision(1) << best_parallel << " MB/s on " << pool.size() << " threads\n"
+            << std::setprecision(0);
+  std::cout << "parse    " << best_parse << " nodes/s (" << nodes << " nodes, lexing included)\n";
+
+  SimulationResult simulation;
+  if (paths.empty() && config.cycles > 0) {
+    try {
+      simulation = simulateAll(files, config);
+    } catch (const std::exception& e) {
+      std::cerr << "Simulation error: " << e.what() << "\n";
+      return 1;
+    }
+    std::cout << "simulate " << simulation.events / simulation.seconds << " events/s, "
+              << simulation.process_runs / simulation.seconds << " process runs/s (" << simulation.designs
+              << " designs, " << simulation.cycle_based << " cycle-based, " << config.cycles << " cycles each)\n";
+  }
+  size_t rss = peakRssKb();
+  std::cout << "peak RSS " << rss << " KB\n";
+
+  if (!json_path.empty()) {
+    std::ostringstream json;
+    json << std::setprecision(6) << std::defaultfloat;
+    json << "{\n  \"schema\": 1,\n";
+    json << "  \"config\": {\"repeat\": " << config.repeat << ", \"generated\": " << (paths.empty() ? "true" : "false")
+         << ", \"entities\": " << config.entities << ", \"width\": " << config.width << ", \"depth\": " << config.depth
+         << ", \"comment_lines\": " << config.comment_lines << ", \"processes\": " << config.processes
+         << ", \"cycles\": " << config.cycles << "},\n";
+    json << "  \"input\": {\"files\": " << inputs.size() << ", \"bytes\": " << total_bytes << ", \"tokens\": " << tokens
+         << ", \"nodes\": " << nodes << "},\n";
+    json << "  \"scan\": [";
+    for (size_t i = 0; i < backends.size(); i++) {
+      json << (i ? ", " : "") << "{\"backend\": \"" << backends[i].name << "\", \"supported\": "
+           << (backends[i].supported ? "true" : "false") << ", \"lex_mb_per_s\": " << backends[i].lex_mb_s
+           << ", \"newline_mb_per_s\": " << backends[i].lines_mb_s << "}";
+    }
+    json << "],\n";
+    json << "  \"lex\": {\"backend\": \"" << fastest->name << "\", \"mb_per_s\": " << fastest->lex_mb_s
+         << ", \"tokens_per_s\": " << tokens * (fastest->lex_mb_s / megabytes) << "},\n";
+    json << "  \"parallel_lex\": {\"threads\": " << pool.size() << ", \"mb_per_s\": " << best_parallel << "},\n";
+    json << "  \"parse\": {\"nodes_per_s\": " << best_parse << "},\n";
+    json << "  \"simulate\": {\"designs\": " << simulation.designs << ", \"cycle_based\": " << simulation.cycle_based
+         << ", \"events\": " << simulation.events << ", \"events_per_s\": "
+         << (simulation.seconds > 0 ? simulation.events / simulation.seconds : 0)
+         << ", \"process_runs_per_s\": " << (simulation.seconds > 0 ? simulation.process_runs / simulation.seconds : 0)
+         << "},\n";
+    json << "  \"peak_rss_kb\": " << rss << "\n}\n";
+
+    std::ofstream out(json_path);
+    out << json.str();
+    if (!out) {
+      std::cerr << "Error: cannot write " << json_path << "\n";
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,299 @@
+#include "BitVector.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "Scan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define VHDL_BITS_X86 1
+#include <immintrin.h>
+#endif
+
+BitVector::BitVector(size_t width, bool fill) : bit_width(width) {
+  if (wordCount() > INLINE_WORDS) {
+    heap.reset(new uint64_t[wordCount()]);
+  }
+  std::memset(words(), fill ? 0xFF : 0, wordCount() * sizeof(uint64_t));
+  clearTail();
+}
+
+BitVector::BitVector(const BitVector& other) : bit_width(other.bit_width) {
+  if (other.heap) {
+    heap.reset(new uint64_t[wordCount()]);
+  }
+  std::memcpy(words(), other.words(), wordCount() * sizeof(uint64_t));
+}
+
+BitVector& BitVector::operator=(const BitVector& other) {
+  if (this != &other) {
+    if (wordCount() != other.wordCount()) {
+      heap.reset(other.heap ? new uint64_t[other.wordCount()] : nullptr);
+    }
+    bit_width = other.bit_width;
+    std::memcpy(words(), other.words(), wordCount() * sizeof(uint64_t));
+  }
+  return *this;
+}
+
+BitVector::BitVector(BitVector&& other) noexcept
+  : bit_width(other.bit_width), heap(std::move(other.heap)) {
+  std::memcpy(inline_words, other.inline_words, sizeof(inline_words));
+  other.bit_width = 0;
+}
+
+BitVector& BitVector::operator=(BitVector&& other) noexcept {
+  bit_width = other.bit_width;
+  heap = std::move(other.heap);
+  std::memcpy(inline_words, other.inline_words, sizeof(inline_words));
+  other.bit_width = 0;
+  return *this;
+}
+
+void BitVector::clearTail() {
+  if (bit_width % 64) {
+    words()[wordCount() - 1] &= (uint64_t(1) << (bit_width % 64)) - 1;
+  }
+}
+
+// Sets bits [from, to).
+void BitVector::fillRange(size_t from, size_t to) {
+  uint64_t* w = words();
+  while (from < to) {
+    size_t bit = from % 64;
+    size_t span = std::min<size_t>(64 - bit, to - from);
+    uint64_t mask = span == 64 ? ~uint64_t(0) : ((uint64_t(1) << span) - 1) << bit;
+    w[from / 64] |= mask;
+    from += span;
+  }
+}
+
+BitVector BitVector::fromString(std::string_view text) {
+  size_t width = 0;
+  for (char c : text) {
+    if (c == '0' || c == '1') {
+      width++;
+    } else if (c != '_') {
+      throw std::runtime_error("invalid bit string \"" + std::string(text) + "\"");
+    }
+  }
+
+  BitVector result(width);
+  size_t index = width;
+  for (char c : text) {
+    if (c == '_') continue;
+    index--;
+    if (c == '1') result.set(index, true);
+  }
+  return result;
+}
+
+bool BitVector::operator==(const BitVector& other) const {
+  return bit_width == other.bit_width &&
+         std::memcmp(words(), other.words(), wordCount() * sizeof(uint64_t)) == 0;
+}
+
+int BitVector::compare(const BitVector& other) const {
+  if (bit_width == other.bit_width) {
+    // Same width: the leftmost difference is the highest differing word
+    for (size_t i = wordCount(); i-- > 0;) {
+      if (words()[i] != other.words()[i]) {
+        return words()[i] < other.words()[i] ? -1 : 1;
+      }
+    }
+    return 0;
+  }
+  size_t common = std::min(bit_width, other.bit_width);
+  for (size_t i = 0; i < common; i++) {
+    bool a = get(bit_width - 1 - i);
+    bool b = other.get(other.bit_width - 1 - i);
+    if (a != b) return a ? 1 : -1;
+  }
+  return bit_width < other.bit_width ? -1 : 1;
+}
+
+// ---------------------------------------------------------------------------
+// Word-parallel logic. Wide buses go through SSE2 (two words per step) or,
+// when the CPU has it, AVX2 (four words per step).
+
+enum class LogicKind { And, Or, Xor };
+
+static inline uint64_t logicWord(LogicKind kind, uint64_t a, uint64_t b) {
+  switch (kind) {
+    case LogicKind::And: return a & b;
+    case LogicKind::Or:  return a | b;
+    default:             return a ^ b;
+  }
+}
+
+static void scalarLogic(LogicKind kind, const uint64_t* a, const uint64_t* b, uint64_t* out, size_t n, bool invert) {
+  uint64_t flip = invert ? ~uint64_t(0) : 0;
+  for (size_t i = 0; i < n; i++) {
+    out[i] = logicWord(kind, a[i], b[i]) ^ flip;
+  }
+}
+
+#ifdef VHDL_BITS_X86
+
+static void sse2Logic(LogicKind kind, const uint64_t* a, const uint64_t* b, uint64_t* out, size_t n, bool invert) {
+  __m128i flip = invert ? _mm_set1_epi32(-1) : _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+    __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+    __m128i r = kind == LogicKind::And ? _mm_and_si128(x, y)
+              : kind == LogicKind::Or  ? _mm_or_si128(x, y)
+              :                          _mm_xor_si128(x, y);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_xor_si128(r, flip));
+  }
+  scalarLogic(kind, a + i, b + i, out + i, n - i, invert);
+}
+
+__attribute__((target("avx2")))
+static void avx2Logic(LogicKind kind, const uint64_t* a, const uint64_t* b, uint64_t* out, size_t n, bool invert) {
+  __m256i flip = invert ? _mm256_set1_epi32(-1) : _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+    __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+    __m256i r = kind == LogicKind::And ? _mm256_and_si256(x, y)
+              : kind == LogicKind::Or  ? _mm256_or_si256(x, y)
+              :                          _mm256_xor_si256(x, y);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_xor_si256(r, flip));
+  }
+  sse2Logic(kind, a + i, b + i, out + i, n - i, invert);
+}
+
+#endif // VHDL_BITS_X86
+
+using LogicKernel = void (*)(LogicKind, const uint64_t*, const uint64_t*, uint64_t*, size_t, bool);
+
+static LogicKernel wideLogicKernel() {
+#ifdef VHDL_BITS_X86
+  static const LogicKernel kernel = scanBackendSupported(ScanBackend::AVX2) ? avx2Logic : sse2Logic;
+  return kernel;
+#else
+  return scalarLogic;
+#endif
+}
+
+BitVector BitVector::logic(Operator op, const BitVector& left, const BitVector& right) {
+  LogicKind kind;
+  bool invert = false;
+  switch (op) {
+    case Operator::And:  kind = LogicKind::And; break;
+    case Operator::Or:   kind = LogicKind::Or;  break;
+    case Operator::Xor:  kind = LogicKind::Xor; break;
+    case Operator::Nand: kind = LogicKind::And; invert = true; break;
+    case Operator::Nor:  kind = LogicKind::Or;  invert = true; break;
+    case Operator::Xnor: kind = LogicKind::Xor; invert = true; break;
+    default: throw std::runtime_error("not a logical operator");
+  }
+
+  BitVector result(left.width());
+  size_t n = result.wordCount();
+  if (n <= INLINE_WORDS) {
+    scalarLogic(kind, left.words(), right.words(), result.words(), n, invert);
+  } else {
+    wideLogicKernel()(kind, left.words(), right.words(), result.words(), n, invert);
+  }
+  result.clearTail();
+  return result;
+}
+
+BitVector BitVector::operator~() const {
+  BitVector result(bit_width);
+  const uint64_t* src = words();
+  uint64_t* dst = result.words();
+  for (size_t i = 0; i < wordCount(); i++) {
+    dst[i] = ~src[i];
+  }
+  result.clearTail();
+  return result;
+}
+
+// ---------------------------------------------------------------------------
+// Shifts and concatenation, a word at a time.
+
+BitVector BitVector::shiftLeft(size_t count, bool fill) const {
+  BitVector result(bit_width);
+  if (count >= bit_width) {
+    return BitVector(bit_width, fill);
+  }
+  size_t word_shift = count / 64, bit_shift = count % 64;
+  const uint64_t* src = words();
+  uint64_t* dst = result.words();
+  for (size_t i = wordCount(); i-- > word_shift;) {
+    uint64_t value = src[i - word_shift] << bit_shift;
+    if (bit_shift && i > word_shift) {
+      value |= src[i - word_shift - 1] >> (64 - bit_shift);
+    }
+    dst[i] = value;
+  }
+  if (fill) {
+    result.fillRange(0, count);
+  }
+  result.clearTail();
+  return result;
+}
+
+BitVector BitVector::shiftRight(size_t count, bool fill) const {
+  BitVector result(bit_width);
+  if (count >= bit_width) {
+    return BitVector(bit_width, fill);
+  }
+  size_t word_shift = count / 64, bit_shift = count % 64;
+  size_t n = wordCount();
+  const uint64_t* src = words();
+  uint64_t* dst = result.words();
+  for (size_t i = 0; i + word_shift < n; i++) {
+    uint64_t value = src[i + word_shift] >> bit_shift;
+    if (bit_shift && i + word_shift + 1 < n) {
+      value |= src[i + word_shift + 1] << (64 - bit_shift);
+    }
+    dst[i] = value;
+  }
+  if (fill) {
+    result.fillRange(bit_width - count, bit_width);
+  }
+  return result;
+}
+
+BitVector BitVector::rotateLeft(size_t count) const {
+  if (bit_width == 0 || count % bit_width == 0) {
+    return *this;
+  }
+  count %= bit_width;
+  BitVector high = shiftLeft(count, false);
+  BitVector low  = shiftRight(bit_width - count, false);
+  uint64_t* dst = high.words();
+  const uint64_t* src = low.words();
+  for (size_t i = 0; i < wordCount(); i++) {
+    dst[i] |= src[i];
+  }
+  return high;
+}
+
+BitVector BitVector::concat(const BitVector& left, const BitVector& right) {
+  BitVector result(left.width() + right.width());
+  uint64_t* dst = result.words();
+  std::memcpy(dst, right.words(), right.wordCount() * sizeof(uint64_t));
+
+  // Splice `left` in above `right`, starting mid-word when right.width() % 64 != 0
+  size_t offset = right.width() / 64, bit_shift = right.width() % 64;
+  const uint64_t* src = left.words();
+  for (size_t i = 0; i < left.wordCount(); i++) {
+    dst[offset + i] |= src[i] << bit_shift;
+    if (bit_shift && offset + i + 1 < result.wordCount()) {
+      dst[offset + i + 1] = src[i] >> (64 - bit_shift);
+    }
+  }
+  return result;
+}
+
+std::string BitVector::toString() const {
+  std::string result(bit_width, '0');
+  for (size_t i = 0; i < bit_width; i++) {
+    if (get(i)) result[bit_width - 1 - i] = '1';
+  }
+  return result;
+}
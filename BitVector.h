@@ -0,0 +1,84 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "Lexicon.h"
+
+// Packed bit_vector value: 64 elements per machine word, element 0 being the
+// rightmost one, so `bit_vector(7 downto 0)` maps bit i to index i. Bits above
+// the width are kept zero, which lets equality and ordering work on whole
+// words. Vectors of up to 128 bits live inline; wider ones own a heap block.
+class BitVector {
+public:
+  BitVector() = default;
+  explicit BitVector(size_t width, bool fill = false);
+
+  BitVector(const BitVector& other);
+  BitVector& operator=(const BitVector& other);
+  BitVector(BitVector&& other) noexcept;
+  BitVector& operator=(BitVector&& other) noexcept;
+
+  // "1100" -> leftmost character is the highest element; '_' is skipped.
+  // Throws std::runtime_error on any other character.
+  static BitVector fromString(std::string_view text);
+
+  size_t width() const {
+    return bit_width;
+  }
+
+  size_t wordCount() const {
+    return (bit_width + 63) / 64;
+  }
+
+  const uint64_t* words() const {
+    return heap ? heap.get() : inline_words;
+  }
+
+  uint64_t* words() {
+    return heap ? heap.get() : inline_words;
+  }
+
+  bool get(size_t index) const {
+    return (words()[index / 64] >> (index % 64)) & 1;
+  }
+
+  void set(size_t index, bool bit) {
+    uint64_t mask = uint64_t(1) << (index % 64);
+    words()[index / 64] = bit ? (words()[index / 64] | mask) : (words()[index / 64] & ~mask);
+  }
+
+  bool operator==(const BitVector& other) const;
+  bool operator!=(const BitVector& other) const {
+    return !(*this == other);
+  }
+
+  // VHDL ordering: element by element from the left, a proper prefix first.
+  int compare(const BitVector& other) const;
+
+  // and, or, xor, nand, nor, xnor on equal widths (the caller checks).
+  static BitVector logic(Operator op, const BitVector& left, const BitVector& right);
+  BitVector operator~() const;
+
+  // left & right: `left` ends up in the high elements.
+  static BitVector concat(const BitVector& left, const BitVector& right);
+
+  // Shifts towards the left (higher indices) or right, filling the vacated
+  // elements with `fill`; shifting by the width or more gives all `fill`.
+  BitVector shiftLeft(size_t count, bool fill) const;
+  BitVector shiftRight(size_t count, bool fill) const;
+  BitVector rotateLeft(size_t count) const;
+
+  std::string toString() const;
+
+private:
+  static constexpr size_t INLINE_WORDS = 2;
+
+  size_t bit_width = 0;
+  uint64_t inline_words[INLINE_WORDS] = {};
+  std::unique_ptr<uint64_t[]> heap;
+
+  void clearTail();
+  void fillRange(size_t from, size_t to);
+};
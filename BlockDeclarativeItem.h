@@ -1,4 +1,6 @@
+#pragma once
 #include "Node.h"
+#include "Expression.h"
 
 /*
 block_declarative_item ::=
@@ -30,30 +32,74 @@ block_declarative_item ::=
 */
 
 
+enum class DeclarationKind : uint8_t {
+  Constant, Signal, Variable,
+};
+
+
+// Object declarations share one shape: `<kind> name : subtype [ := value ];`
 class BlockDeclarativeItem : public Node {
 public:
-  virtual ~BlockDeclarativeItem() = default; 
+  DeclarationKind kind;
+  NameId name = NO_NAME;
+  InterfaceType* type = nullptr;
+  Expression* value = nullptr;
+
+  void setName(NameId name) {
+    this->name = name;
+  }
+
+  void setType(InterfaceType* type) {
+    this->type = type;
+  }
+
+  void setValue(Expression* value) {
+    this->value = value;
+  }
+
+protected:
+  explicit BlockDeclarativeItem(DeclarationKind kind) : kind(kind) {}
+  ~BlockDeclarativeItem() = default;
+
+  void dumpDeclaration(std::ostream& out, const char* label) const {
+    out << label << "(" << nameString(name) << ": ";
+    dumpOrNull(out, type);
+    if (value) {
+      out << " := ";
+      value->dump(out);
+    }
+    out << ")";
+  }
 };
 
 
 class ConstantDeclaration : public BlockDeclarativeItem {
 public:
-  std::string name;
-  std::string value;
+  ConstantDeclaration() : BlockDeclarativeItem(DeclarationKind::Constant) {}
 
-  std::string toString() const override {
-    return "ConstantDeclaration(" + name + " := " + value + ")";
+  void dump(std::ostream& out) const override {
+    dumpDeclaration(out, "ConstantDeclaration");
   }
 };
 
 
 class SignalDeclaration : public BlockDeclarativeItem {
 public:
-  std::string name;
-  std::string type;
+  SignalDeclaration() : BlockDeclarativeItem(DeclarationKind::Signal) {}
+
+  void dump(std::ostream& out) const override {
+    dumpDeclaration(out, "SignalDeclaration");
+  }
+};
+
+
+// process_declarative_item; only legal inside processes and subprograms.
+class VariableDeclaration : public BlockDeclarativeItem {
+public:
+  VariableDeclaration() : BlockDeclarativeItem(DeclarationKind::Variable) {}
 
-  std::string toString() const override {
-    return "SignalDeclaration(" + name + ": " + type + ")";
+  void dump(std::ostream& out) const override {
+    dumpDeclaration(out, "VariableDeclaration");
   }
 };
 
@@ -0,0 +1,633 @@
+#include "Bytecode.h"
+#include <stdexcept>
+
+#if defined(__GNUC__) && !defined(VHDL_NO_COMPUTED_GOTO)
+#define VHDL_COMPUTED_GOTO 1
+#endif
+
+// ---------------------------------------------------------------------------
+// Lowering
+
+static ValueType typeOf(const Value& value) {
+  if (value.kind == TypeKind::Integer) {
+    return ValueType::integer();
+  }
+  ValueType type;
+  type.kind = value.kind;
+  if (value.kind == TypeKind::BitVector) {
+    type.left  = static_cast<int64_t>(value.bits.width()) - 1;
+    type.right = 0;
+  }
+  return type;
+}
+
+static ValueType vectorType(size_t width) {
+  ValueType type;
+  type.kind  = TypeKind::BitVector;
+  type.left  = static_cast<int64_t>(width) - 1;
+  type.right = 0;
+  return type;
+}
+
+static ValueType scalarType(TypeKind kind) {
+  if (kind == TypeKind::Integer) {
+    return ValueType::integer();
+  }
+  ValueType type;
+  type.kind = kind;
+  return type;
+}
+
+static std::runtime_error operandError(Operator op, TypeKind left, const TypeKind* right) {
+  std::string message = "operator '" + std::string(operatorSpelling(op)) + "' is not defined for " + typeName(left);
+  if (right) {
+    message += " and " + typeName(*right);
+  }
+  return std::runtime_error(message);
+}
+
+static bool isLogical(Operator op) {
+  return op == Operator::And || op == Operator::Or || op == Operator::Xor ||
+         op == Operator::Nand || op == Operator::Nor || op == Operator::Xnor;
+}
+
+static bool isShift(Operator op) {
+  return op == Operator::Sll || op == Operator::Srl || op == Operator::Sla ||
+         op == Operator::Sra || op == Operator::Rol || op == Operator::Ror;
+}
+
+static bool isRelational(Operator op) {
+  return op == Operator::Equal || op == Operator::NotEqual || op == Operator::Less ||
+         op == Operator::LessEqual || op == Operator::Greater || op == Operator::GreaterEqual;
+}
+
+static bool isArithmetic(Operator op) {
+  return op == Operator::Plus || op == Operator::Minus || op == Operator::Multiply || op == Operator::Divide ||
+         op == Operator::Mod || op == Operator::Rem || op == Operator::Power;
+}
+
+// Same checks as checkAssignable, on the static type of the value.
+static void checkStaticAssignable(const ValueType& target_type, const ValueType& type, NameId target) {
+  if (type.kind != target_type.kind) {
+    throw std::runtime_error("cannot assign " + typeName(type.kind) + " to '" +
+                             NameTable::global().str(target) + "' of type " + target_type.toString());
+  }
+  if (type.kind == TypeKind::BitVector && type.width() != target_type.width()) {
+    throw std::runtime_error("cannot assign " + std::to_string(type.width()) + " bits to '" +
+                             NameTable::global().str(target) + "' of type " + target_type.toString());
+  }
+}
+
+namespace {
+
+struct Operand {
+  uint32_t  ref;
+  ValueType type;
+
+  bool isConstant() const {
+    return (ref >> 30) == static_cast<uint32_t>(Space::Constant);
+  }
+};
+
+class Compiler {
+public:
+  Compiler(const Design& design, const ProcessInfo& process) : design(design), process(process) {}
+
+  Program compile() {
+    for (const SequentialStatement* statement : process.body) {
+      compileStatement(statement);
+    }
+    emit(Instruction{OpCode::Halt});
+    return std::move(program);
+  }
+
+private:
+  const Design& design;
+  const ProcessInfo& process;
+  Program program;
+  std::unordered_map<uint32_t, uint32_t> design_constants;  // design constant -> pool slot
+
+  size_t emit(const Instruction& instruction) {
+    program.code.push_back(instruction);
+    return program.code.size() - 1;
+  }
+
+  uint32_t newRegister(const ValueType& type) {
+    program.registers.push_back(Value::defaultFor(type));
+    return makeOperand(Space::Register, static_cast<uint32_t>(program.registers.size() - 1));
+  }
+
+  Operand constant(Value value) {
+    ValueType type = typeOf(value);
+    program.constants.push_back(std::move(value));
+    return Operand{makeOperand(Space::Constant, static_cast<uint32_t>(program.constants.size() - 1)), type};
+  }
+
+  const Value& constantValue(const Operand& operand) const {
+    return program.constants[operand.ref & OPERAND_INDEX_MASK];
+  }
+
+  Operand compileName(NameId name) {
+    const NameRef* ref = design.resolve(process, name);
+    if (!ref) {
+      throw std::runtime_error("unknown name '" + NameTable::global().str(name) + "'");
+    }
+    switch (ref->kind) {
+      case RefKind::Signal:
+        return Operand{makeOperand(Space::Signal, ref->index), design.signals[ref->index].type};
+      case RefKind::Variable:
+        return Operand{makeOperand(Space::Variable, ref->index), process.variables[ref->index].type};
+      default: {
+        auto found = design_constants.find(ref->index);
+        if (found != design_constants.end()) {
+          return Operand{makeOperand(Space::Constant, found->second), typeOf(design.constants[ref->index])};
+        }
+        Operand operand = constant(design.constants[ref->index]);
+        design_constants.emplace(ref->index, operand.ref & OPERAND_INDEX_MASK);
+        return operand;
+      }
+    }
+  }
+
+  Operand compileUnary(Operator op, const Operand& operand) {
+    TypeKind kind = operand.type.kind;
+    Instruction instruction{OpCode::Unary, op};
+    switch (op) {
+      case Operator::Not:
+        if (kind == TypeKind::Bit || kind == TypeKind::Boolean) {
+          instruction.op = OpCode::NotScalar;
+        } else if (kind != TypeKind::BitVector) {
+          throw operandError(op, kind, nullptr);
+        }
+        break;
+      case Operator::Plus:
+        if (kind != TypeKind::Integer) throw operandError(op, kind, nullptr);
+        return operand;
+      case Operator::Minus:
+        if (kind != TypeKind::Integer) throw operandError(op, kind, nullptr);
+        instruction.op = OpCode::Negate;
+        break;
+      case Operator::Abs:
+        if (kind != TypeKind::Integer) throw operandError(op, kind, nullptr);
+        instruction.op = OpCode::Absolute;
+        break;
+      default:
+        throw operandError(op, kind, nullptr);
+    }
+
+    if (operand.isConstant()) {
+      return constant(evaluateUnary(op, constantValue(operand)));
+    }
+    instruction.a = newRegister(operand.type);
+    instruction.b = operand.ref;
+    emit(instruction);
+    return Operand{instruction.a, operand.type};
+  }
+
+  // Result type of `left op right`, with the diagnostics of evaluateBinary.
+  static ValueType binaryType(Operator op, const ValueType& left, const ValueType& right) {
+    TypeKind a = left.kind, b = right.kind;
+    if (isLogical(op) && a == b) {
+      if (a == TypeKind::BitVector && left.width() != right.width()) {
+        throw std::runtime_error("operator '" + std::string(operatorSpelling(op)) + "' on bit_vectors of different lengths");
+      }
+      if (a != TypeKind::Integer) return left;
+    } else if (isRelational(op) && a == b) {
+      return scalarType(TypeKind::Boolean);
+    } else if (op == Operator::Concat) {
+      if ((a == TypeKind::Bit || a == TypeKind::BitVector) && (b == TypeKind::Bit || b == TypeKind::BitVector)) {
+        return vectorType(left.width() + right.width());
+      }
+    } else if (isShift(op)) {
+      if (a == TypeKind::BitVector && b == TypeKind::Integer) return left;
+    } else if (isArithmetic(op)) {
+      if (a == TypeKind::Integer && b == TypeKind::Integer) return left;
+    }
+    throw operandError(op, a, &b);
+  }
+
+  Operand compileBinary(Operator op, const Operand& left, const Operand& right) {
+    ValueType type = binaryType(op, left.type, right.type);
+    if (left.isConstant() && right.isConstant()) {
+      try {
+        return constant(evaluateBinary(op, constantValue(left), constantValue(right)));
+      } catch (const std::runtime_error&) {
+        // e.g. a division by zero: only an error if it is ever executed
+      }
+    }
+
+    bool scalar = left.type.kind != TypeKind::BitVector && right.type.kind != TypeKind::BitVector;
+    Instruction instruction{OpCode::Binary, op};
+    if (scalar && isLogical(op)) {
+      instruction.op = OpCode::LogicScalar;
+    } else if (scalar && isRelational(op)) {
+      instruction.op = OpCode::CompareScalar;
+    } else if (op == Operator::Plus) {
+      instruction.op = OpCode::Add;
+    } else if (op == Operator::Minus) {
+      instruction.op = OpCode::Subtract;
+    } else if (isArithmetic(op)) {
+      instruction.op = OpCode::Arith;
+    }
+    instruction.a = newRegister(type);
+    instruction.b = left.ref;
+    instruction.c = right.ref;
+    emit(instruction);
+    return Operand{instruction.a, type};
+  }
+
+  Operand compileExpression(const Expression* expr, const ValueType* expected) {
+    switch (expr->kind) {
+      case ExpressionKind::Name:
+        return compileName(expr->identifier());
+
+      case ExpressionKind::Literal: {
+        std::string_view unit = expr->unit() == NO_NAME ? std::string_view() : NameTable::global().spelling(expr->unit());
+        return constant(parseLiteral(NameTable::global().spelling(expr->text()), unit));
+      }
+
+      case ExpressionKind::Unary:
+        return compileUnary(expr->op, compileExpression(expr->operand(), expected));
+
+      case ExpressionKind::Binary: {
+        Operand left  = compileExpression(expr->left(), nullptr);
+        Operand right = compileExpression(expr->right(), nullptr);
+        return compileBinary(expr->op, left, right);
+      }
+
+      case ExpressionKind::Aggregate: {
+        if (!expected || expected->kind != TypeKind::BitVector) {
+          throw std::runtime_error("'others' aggregate needs a bit_vector target");
+        }
+        Operand element = compileExpression(expr->others(), nullptr);
+        if (element.type.kind != TypeKind::Bit) {
+          throw std::runtime_error("'others' aggregate element must be a bit");
+        }
+        size_t width = expected->width();
+        if (element.isConstant()) {
+          return constant(Value::makeVector(width, constantValue(element).scalar != 0));
+        }
+        Instruction instruction{OpCode::Fill};
+        instruction.a = newRegister(vectorType(width));
+        instruction.b = element.ref;
+        instruction.c = static_cast<uint32_t>(width);
+        emit(instruction);
+        return Operand{instruction.a, vectorType(width)};
+      }
+    }
+    throw std::runtime_error("unknown expression kind");
+  }
+
+  void compileStatements(Span<SequentialStatement*> statements) {
+    for (const SequentialStatement* statement : statements) {
+      compileStatement(statement);
+    }
+  }
+
+  void compileStatement(const SequentialStatement* statement) {
+    switch (statement->kind) {
+      case StatementKind::SignalAssignment:
+        compileSignalAssignment(*static_cast<const SignalAssignment*>(statement));
+        break;
+
+      case StatementKind::VariableAssignment:
+        compileVariableAssignment(*static_cast<const VariableAssignment*>(statement));
+        break;
+
+      case StatementKind::If:
+        compileIf(*static_cast<const IfStatement*>(statement));
+        break;
+
+      case StatementKind::Null:
+        break;
+    }
+  }
+
+  void compileSignalAssignment(const SignalAssignment& assignment) {
+    uint32_t signal = static_cast<uint32_t>(design.findSignal(assignment.target));
+    const SignalInfo& info = design.signals[signal];
+
+    for (size_t i = 0; i < assignment.waveform.size(); i++) {
+      const WaveformElement& element = assignment.waveform[i];
+      Operand value = compileExpression(element.value, &info.type);
+      checkStaticAssignable(info.type, value.type, info.name);
+      checkRangeOf(value, value.ref, info.type, info.name);
+
+      Instruction instruction{OpCode::Schedule};
+      instruction.a = signal;
+      instruction.b = value.ref;
+      instruction.c = NO_OPERAND;
+      if (element.after) {
+        Operand after = compileExpression(element.after, nullptr);
+        if (after.type.kind != TypeKind::Integer) {
+          throw std::runtime_error("'after' needs a non-negative time: " + element.after->toString());
+        }
+        instruction.c = after.ref;
+      }
+      instruction.flags = static_cast<uint8_t>((i == 0 ? SCHEDULE_FIRST : 0) |
+                                               (assignment.transport ? SCHEDULE_TRANSPORT : 0));
+      emit(instruction);
+    }
+  }
+
+  void compileVariableAssignment(const VariableAssignment& assignment) {
+    const NameRef* ref = design.resolve(process, assignment.target);
+    if (!ref || ref->kind != RefKind::Variable) {
+      throw std::runtime_error("'" + NameTable::global().str(assignment.target) + "' is not a variable");
+    }
+    const VariableInfo& info = process.variables[ref->index];
+    Operand value = compileExpression(assignment.value, &info.type);
+    checkStaticAssignable(info.type, value.type, info.name);
+
+    uint32_t target = makeOperand(Space::Variable, ref->index);
+    if (producedBy(value.ref)) {
+      // Retarget the instruction that computed the value; its register is dead
+      program.code.back().a = target;
+      if ((value.ref & OPERAND_INDEX_MASK) + 1 == program.registers.size()) {
+        program.registers.pop_back();
+      }
+    } else {
+      Instruction copy{OpCode::Copy};
+      copy.a = target;
+      copy.b = value.ref;
+      emit(copy);
+    }
+    checkRangeOf(value, target, info.type, info.name);
+  }
+
+  // Checks `stored`, the operand holding `value`, against an integer
+  // subtype. Constants are checked here instead, when they are in range.
+  void checkRangeOf(const Operand& value, uint32_t stored, const ValueType& type, NameId target) {
+    if (type.kind != TypeKind::Integer || (value.isConstant() && type.contains(constantValue(value).scalar))) {
+      return;
+    }
+    Instruction check{OpCode::CheckRange};
+    check.b = stored;
+    check.c = static_cast<uint32_t>(program.ranges.size());
+    program.ranges.push_back(RangeCheck{type, target});
+    emit(check);
+  }
+
+  // True when `ref` is the register written by the last instruction.
+  bool producedBy(uint32_t ref) const {
+    if ((ref >> 30) != static_cast<uint32_t>(Space::Register) || program.code.empty()) {
+      return false;
+    }
+    const Instruction& last = program.code.back();
+    switch (last.op) {
+      case OpCode::Jump: case OpCode::JumpIfFalse: case OpCode::Schedule:
+      case OpCode::CheckRange: case OpCode::Halt:
+        return false;
+      default:
+        return last.a == ref;
+    }
+  }
+
+  void compileIf(const IfStatement& statement) {
+    std::vector<size_t> exits;
+    size_t last_skip = SIZE_MAX;
+    for (const IfBranch& branch : statement.branches) {
+      size_t skip = SIZE_MAX;
+      if (branch.condition) {
+        Operand condition = compileExpression(branch.condition, nullptr);
+        if (condition.type.kind != TypeKind::Boolean) {
+          throw std::runtime_error("if condition is not a boolean: " + branch.condition->toString());
+        }
+        if (condition.isConstant()) {
+          if (!constantValue(condition).scalar) {
+            continue;  // never taken
+          }
+        } else {
+          Instruction test{OpCode::JumpIfFalse};
+          test.b = condition.ref;
+          skip = emit(test);
+        }
+      }
+
+      compileStatements(branch.body);
+      if (skip == SIZE_MAX) {
+        break;  // an else branch or an always-true condition ends the chain
+      }
+      exits.push_back(emit(Instruction{OpCode::Jump}));
+      program.code[skip].a = static_cast<uint32_t>(program.code.size());
+      last_skip = skip;
+    }
+
+    // The exit jump of the last conditional branch would go to the next instruction
+    if (!exits.empty() && exits.back() + 1 == program.code.size()) {
+      program.code.pop_back();
+      exits.pop_back();
+      program.code[last_skip].a = static_cast<uint32_t>(program.code.size());
+    }
+    for (size_t exit : exits) {
+      program.code[exit].a = static_cast<uint32_t>(program.code.size());
+    }
+  }
+};
+
+} // namespace
+
+Program compileProcess(const Design& design, const ProcessInfo& process) {
+  return Compiler(design, process).compile();
+}
+
+// ---------------------------------------------------------------------------
+// Disassembly
+
+static std::string operandString(uint32_t ref) {
+  if (ref == NO_OPERAND) return "-";
+  static const char prefix[] = { 'r', 'v', 's', 'k' };
+  return prefix[ref >> 30] + std::to_string(ref & OPERAND_INDEX_MASK);
+}
+
+std::string Program::toString() const {
+  static const char* names[] = {
+    "copy", "not", "logic", "compare", "add", "sub", "arith", "neg", "abs",
+    "unary", "binary", "fill", "check_range", "jump", "jump_if_false", "schedule", "halt",
+  };
+  std::string result;
+  for (size_t i = 0; i < code.size(); i++) {
+    const Instruction& instruction = code[i];
+    result += std::to_string(i) + ": " + names[static_cast<size_t>(instruction.op)];
+    switch (instruction.op) {
+      case OpCode::LogicScalar: case OpCode::CompareScalar: case OpCode::Arith:
+      case OpCode::Unary: case OpCode::Binary:
+        result += " " + std::string(operatorSpelling(instruction.sub));
+        break;
+      default:
+        break;
+    }
+    switch (instruction.op) {
+      case OpCode::Halt:
+        break;
+      case OpCode::Jump:
+        result += " -> " + std::to_string(instruction.a);
+        break;
+      case OpCode::JumpIfFalse:
+        result += " " + operandString(instruction.b) + " -> " + std::to_string(instruction.a);
+        break;
+      case OpCode::Schedule:
+        result += " signal " + std::to_string(instruction.a) + ", " + operandString(instruction.b) +
+                  " after " + operandString(instruction.c);
+        if (instruction.flags & SCHEDULE_TRANSPORT) result += " transport";
+        break;
+      case OpCode::Fill:
+        result += " " + operandString(instruction.a) + ", " + operandString(instruction.b) +
+                  " x" + std::to_string(instruction.c);
+        break;
+      case OpCode::CheckRange:
+        result += " " + operandString(instruction.b) + " in " + ranges[instruction.c].type.toString();
+        break;
+      case OpCode::Copy: case OpCode::NotScalar: case OpCode::Negate:
+      case OpCode::Absolute: case OpCode::Unary:
+        result += " " + operandString(instruction.a) + ", " + operandString(instruction.b);
+        break;
+      default:
+        result += " " + operandString(instruction.a) + ", " + operandString(instruction.b) +
+                  ", " + operandString(instruction.c);
+        break;
+    }
+    result += "\n";
+  }
+  for (size_t i = 0; i < constants.size(); i++) {
+    result += "k" + std::to_string(i) + " = " + constants[i].toString() + "\n";
+  }
+  return result;
+}
+
+// ---------------------------------------------------------------------------
+// Interpreter. With GCC and Clang every handler ends in its own indirect jump
+// through a label table (computed goto), which predicts far better than the
+// single shared jump of a switch; other compilers get the switch.
+
+static inline bool logicScalar(Operator op, int64_t a, int64_t b) {
+  switch (op) {
+    case Operator::And:  return a & b;
+    case Operator::Or:   return a | b;
+    case Operator::Xor:  return a ^ b;
+    case Operator::Nand: return !(a & b);
+    case Operator::Nor:  return !(a | b);
+    default:             return !(a ^ b);
+  }
+}
+
+static inline bool compareScalar(Operator op, int64_t a, int64_t b) {
+  switch (op) {
+    case Operator::Equal:     return a == b;
+    case Operator::NotEqual:  return a != b;
+    case Operator::Less:      return a < b;
+    case Operator::LessEqual: return a <= b;
+    case Operator::Greater:   return a > b;
+    default:                  return a >= b;
+  }
+}
+
+void runProgram(const Program& program, const ProcessFrame& frame, std::vector<ScheduledValue>& scheduled) {
+  const Value* const sources[] = { frame.registers, frame.variables, frame.signals, program.constants.data() };
+  Value* const targets[] = { frame.registers, frame.variables };
+  auto in  = [&](uint32_t ref) -> const Value& { return sources[ref >> 30][ref & OPERAND_INDEX_MASK]; };
+  auto out = [&](uint32_t ref) -> Value&       { return targets[ref >> 30][ref & OPERAND_INDEX_MASK]; };
+
+  const Instruction* const code = program.code.data();
+  const Instruction* pc = code;
+
+#ifdef VHDL_COMPUTED_GOTO
+  // Same order as OpCode
+  static const void* const handlers[] = {
+    &&op_Copy, &&op_NotScalar, &&op_LogicScalar, &&op_CompareScalar, &&op_Add, &&op_Subtract,
+    &&op_Arith, &&op_Negate, &&op_Absolute, &&op_Unary, &&op_Binary, &&op_Fill, &&op_CheckRange,
+    &&op_Jump, &&op_JumpIfFalse, &&op_Schedule, &&op_Halt,
+  };
+#define VM_CASE(name) op_##name:
+#define VM_DISPATCH() goto *handlers[static_cast<size_t>(pc->op)]
+#define VM_NEXT() do { ++pc; VM_DISPATCH(); } while (0)
+#define VM_JUMP(target) do { pc = code + (target); VM_DISPATCH(); } while (0)
+  VM_DISPATCH();
+#else
+#define VM_CASE(name) case OpCode::name:
+#define VM_NEXT() ++pc; continue
+#define VM_JUMP(target) pc = code + (target); continue
+  for (;;) {
+    switch (pc->op) {
+#endif
+
+  VM_CASE(Copy) {
+    out(pc->a) = in(pc->b);
+    VM_NEXT();
+  }
+  VM_CASE(NotScalar) {
+    out(pc->a).scalar = !in(pc->b).scalar;
+    VM_NEXT();
+  }
+  VM_CASE(LogicScalar) {
+    out(pc->a).scalar = logicScalar(pc->sub, in(pc->b).scalar, in(pc->c).scalar);
+    VM_NEXT();
+  }
+  VM_CASE(CompareScalar) {
+    out(pc->a).scalar = compareScalar(pc->sub, in(pc->b).scalar, in(pc->c).scalar);
+    VM_NEXT();
+  }
+  VM_CASE(Add) {
+    out(pc->a).scalar = addInteger(in(pc->b).scalar, in(pc->c).scalar);
+    VM_NEXT();
+  }
+  VM_CASE(Subtract) {
+    out(pc->a).scalar = subtractInteger(in(pc->b).scalar, in(pc->c).scalar);
+    VM_NEXT();
+  }
+  VM_CASE(Arith) {
+    out(pc->a).scalar = evaluateBinary(pc->sub, in(pc->b), in(pc->c)).scalar;
+    VM_NEXT();
+  }
+  VM_CASE(Negate) {
+    out(pc->a).scalar = negateInteger(in(pc->b).scalar);
+    VM_NEXT();
+  }
+  VM_CASE(Absolute) {
+    out(pc->a).scalar = absInteger(in(pc->b).scalar);
+    VM_NEXT();
+  }
+  VM_CASE(Unary) {
+    out(pc->a) = evaluateUnary(pc->sub, in(pc->b));
+    VM_NEXT();
+  }
+  VM_CASE(Binary) {
+    out(pc->a) = evaluateBinary(pc->sub, in(pc->b), in(pc->c));
+    VM_NEXT();
+  }
+  VM_CASE(Fill) {
+    out(pc->a).bits = BitVector(pc->c, in(pc->b).scalar != 0);
+    VM_NEXT();
+  }
+  VM_CASE(CheckRange) {
+    const RangeCheck& range = program.ranges[pc->c];
+    checkRange(range.type, in(pc->b).scalar, range.target);
+    VM_NEXT();
+  }
+  VM_CASE(Jump) {
+    VM_JUMP(pc->a);
+  }
+  VM_CASE(JumpIfFalse) {
+    if (!in(pc->b).scalar) {
+      VM_JUMP(pc->a);
+    }
+    VM_NEXT();
+  }
+  VM_CASE(Schedule) {
+    int64_t delay = pc->c == NO_OPERAND ? 0 : in(pc->c).scalar;
+    scheduled.push_back(ScheduledValue{pc->a, pc->flags, delay, in(pc->b)});
+    VM_NEXT();
+  }
+  VM_CASE(Halt) {
+    return;
+  }
+
+#ifndef VHDL_COMPUTED_GOTO
+    }
+  }
+#endif
+#undef VM_CASE
+#undef VM_NEXT
+#undef VM_JUMP
+#undef VM_DISPATCH
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Elaborate.h"
+#include "Value.h"
+
+// Register bytecode for process bodies.
+//
+// Every operand is a 32-bit reference whose top two bits name the space it
+// lives in (a temporary register, a process variable, a signal's current
+// value, or the program's constant pool) and whose low bits are the index, so
+// instructions read objects in place and never look a name up. Types and
+// bit_vector widths are fully known when a process is compiled: type errors
+// are reported then, and scalar operations get opcodes that work on the raw
+// integer without any checks.
+
+enum class OpCode : uint8_t {
+  Copy,          // a := b
+  NotScalar,     // a := not b            (bit, boolean)
+  LogicScalar,   // a := b <op> c         (bit, boolean)
+  CompareScalar, // a := b <op> c         (bit, boolean, integer)
+  Add,           // a := b + c            (integer)
+  Subtract,      // a := b - c            (integer)
+  Arith,         // a := b <op> c         (other integer operators)
+  Negate,        // a := -b
+  Absolute,      // a := abs b
+  Unary,         // a := <op> b           (generic, bit_vector)
+  Binary,        // a := b <op> c         (generic, bit_vector)
+  Fill,          // a := (others => b), c bits wide
+  CheckRange,    // fail unless integer b is within ranges[c]
+  Jump,          // goto a
+  JumpIfFalse,   // if not b goto a
+  Schedule,      // signal a <= b after c (c == NO_OPERAND: no delay)
+  Halt,
+};
+
+enum class Space : uint32_t {
+  Register, Variable, Signal, Constant,
+};
+
+constexpr uint32_t OPERAND_INDEX_MASK = (uint32_t(1) << 30) - 1;
+constexpr uint32_t NO_OPERAND = ~uint32_t(0);
+
+constexpr uint32_t makeOperand(Space space, uint32_t index) {
+  return (static_cast<uint32_t>(space) << 30) | index;
+}
+
+// Flags of a Schedule instruction
+constexpr uint8_t SCHEDULE_FIRST     = 1;  // first waveform element: preempts the driver
+constexpr uint8_t SCHEDULE_TRANSPORT = 2;
+
+struct Instruction {
+  OpCode   op;
+  Operator sub   = Operator::None;  // operator of Unary/Binary/... instructions
+  uint8_t  flags = 0;
+  uint32_t a = 0;
+  uint32_t b = 0;
+  uint32_t c = 0;
+};
+
+// The subtype of an integer signal or variable a value is about to be stored in.
+struct RangeCheck {
+  ValueType type;
+  NameId    target;
+};
+
+struct Program {
+  std::vector<Instruction> code;
+  std::vector<Value> constants;
+  std::vector<Value> registers;  // initial register contents, typed
+  std::vector<RangeCheck> ranges;
+
+  std::string toString() const;
+};
+
+// A value a process has assigned to a signal, to be applied by the kernel.
+struct ScheduledValue {
+  uint32_t signal;
+  uint8_t  flags;
+  int64_t  delay;   // validated by the kernel
+  Value    value;
+};
+
+// What a running program reads and writes.
+struct ProcessFrame {
+  const Value* signals;
+  Value* variables;
+  Value* registers;
+};
+
+// Lowers one elaborated process. Throws std::runtime_error on type errors.
+Program compileProcess(const Design& design, const ProcessInfo& process);
+
+// Runs `program` to completion, appending its signal assignments to `scheduled`.
+void runProgram(const Program& program, const ProcessFrame& frame, std::vector<ScheduledValue>& scheduled);
@@ -0,0 +1,611 @@
+#include "DesignCache.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <random>
+#include <unordered_map>
+#include <vector>
+#include "SourceBuffer.h"
+
+namespace fs = std::filesystem;
+
+static const char CACHE_MAGIC[8] = {'V', 'H', 'D', 'L', 'L', 'I', 'B', '\0'};
+static constexpr uint32_t NO_INDEX = 0xFFFFFFFFu;
+
+struct CacheHeader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t reserved_count;  // keyword ids are only stable for one Lexicon table
+  uint64_t source_hash;
+  uint32_t name_count;      // followed by name_count {offset, length} pairs,
+  uint32_t word_count;      // then word_count tree words,
+  uint32_t chars_size;      // then the name characters
+  uint32_t padding;
+};
+
+// Builds the word stream and name table for one file.
+class CacheWriter {
+public:
+  std::vector<uint32_t> words;
+  std::vector<uint32_t> names;  // offset, length pairs
+  std::string chars;
+
+  void word(uint32_t value) {
+    words.push_back(value);
+  }
+
+  void name(NameId id) {
+    if (id == NO_NAME) {
+      word(NO_INDEX);
+      return;
+    }
+    auto it = local.find(id);
+    if (it == local.end()) {
+      std::string_view text = NameTable::global().spelling(id);
+      it = local.emplace(id, static_cast<uint32_t>(names.size() / 2)).first;
+      names.push_back(static_cast<uint32_t>(chars.size()));
+      names.push_back(static_cast<uint32_t>(text.size()));
+      chars.append(text);
+    }
+    word(it->second);
+  }
+
+  void keyword(Keyword keyword) {
+    word(static_cast<uint32_t>(keyword));
+  }
+
+  void op(Operator op) {
+    word(static_cast<uint32_t>(op));
+  }
+
+private:
+  std::unordered_map<NameId, uint32_t> local;
+};
+
+// Reads the word stream straight out of the mapped entry.
+class CacheReader {
+public:
+  CacheReader(const char* words, uint32_t word_count, std::vector<NameId> names)
+    : words(words), word_count(word_count), names(std::move(names)) {}
+
+  uint32_t word() {
+    if (pos >= word_count) {
+      throw std::runtime_error("truncated cache entry");
+    }
+    uint32_t value;
+    std::memcpy(&value, words + 4 * pos++, sizeof(value));
+    return value;
+  }
+
+  NameId name() {
+    uint32_t index = word();
+    if (index == NO_INDEX) {
+      return NO_NAME;
+    }
+    if (index >= names.size()) {
+      throw std::runtime_error("bad name index in cache entry");
+    }
+    return names[index];
+  }
+
+  uint32_t remaining() const {
+    return word_count - pos;
+  }
+
+  // A list length; every element takes at least one word.
+  uint32_t count() {
+    uint32_t value = word();
+    if (value > remaining()) {
+      throw std::runtime_error("bad element count in cache entry");
+    }
+    return value;
+  }
+
+  Operator op() {
+    uint32_t value = word();
+    if (value > 0xFF || operatorSpelling(static_cast<Operator>(value)).empty()) {
+      throw std::runtime_error("bad operator in cache entry");
+    }
+    return static_cast<Operator>(value);
+  }
+
+  // Reads an enum stored as a word, checking it against the last enumerator.
+  template <class Enum>
+  Enum kind(Enum last) {
+    uint32_t value = word();
+    if (value > static_cast<uint32_t>(last)) {
+      throw std::runtime_error("bad node kind in cache entry");
+    }
+    return static_cast<Enum>(value);
+  }
+
+  Keyword keyword() {
+    uint32_t value = word();
+    if (value >= RESERVED_COUNT) {
+      throw std::runtime_error("bad keyword in cache entry");
+    }
+    return static_cast<Keyword>(value);
+  }
+
+private:
+  const char* words;
+  uint32_t word_count;
+  std::vector<NameId> names;
+  uint32_t pos = 0;
+};
+
+// ---------------------------------------------------------------------------
+// Tree encoding. Optional children are preceded by a 0/1 presence word.
+
+static void writeType(CacheWriter& out, const InterfaceType* type) {
+  out.word(type != nullptr);
+  if (!type) return;
+  out.name(type->identifier);
+  out.name(type->upper);
+  out.keyword(type->direction);
+  out.name(type->lower);
+}
+
+static InterfaceType* readType(CacheReader& in, Arena& arena) {
+  if (!in.word()) return nullptr;
+  auto type = arena.make<InterfaceType>();
+  type->setIdentifier(in.name());
+  type->setUpper(in.name());
+  type->setDirection(in.keyword());
+  type->setLower(in.name());
+  return type;
+}
+
+static void writeInterfaceList(CacheWriter& out, const InterfaceList* list) {
+  out.word(list != nullptr);
+  if (!list) return;
+  out.word(static_cast<uint32_t>(list->elems.size()));
+  for (const InterfaceElement& elem : list->elems) {
+    out.name(elem.identifier);
+    out.keyword(elem.mode);
+    writeType(out, elem.type);
+  }
+}
+
+static InterfaceList* readInterfaceList(CacheReader& in, Arena& arena) {
+  if (!in.word()) return nullptr;
+  auto list = arena.make<InterfaceList>();
+  std::vector<InterfaceElement> elems(in.count());
+  for (InterfaceElement& elem : elems) {
+    elem.setIdentifier(in.name());
+    elem.setMode(in.keyword());
+    elem.setType(readType(in, arena));
+  }
+  list->setElements(arena.copy(elems));
+  return list;
+}
+
+// An expression is written as its postfix run, node by node; subtree sizes
+// are recomputed on reading.
+static void writeExpression(CacheWriter& out, const Expression* expr) {
+  out.word(expr != nullptr);
+  if (!expr) return;
+  out.word(expr->size);
+  for (const Expression& node : expr->nodes()) {
+    out.word(static_cast<uint32_t>(node.kind));
+    switch (node.kind) {
+      case ExpressionKind::Name:
+        out.name(node.identifier());
+        break;
+      case ExpressionKind::Literal:
+        out.name(node.text());
+        out.name(node.unit());
+        break;
+      case ExpressionKind::Unary:
+      case ExpressionKind::Binary:
+        out.op(node.op);
+        break;
+      case ExpressionKind::Aggregate:
+        break;
+    }
+  }
+}
+
+static Expression* readExpression(CacheReader& in, Arena& arena) {
+  if (!in.word()) return nullptr;
+  uint32_t count = in.count();
+  std::vector<Expression> run;
+  run.reserve(count);
+  std::vector<uint32_t> sizes;  // of the subtrees not yet taken as operands
+  auto pop = [&sizes]() {
+    if (sizes.empty()) {
+      throw std::runtime_error("missing operand in cache entry");
+    }
+    uint32_t size = sizes.back();
+    sizes.pop_back();
+    return size;
+  };
+  for (uint32_t i = 0; i < count; i++) {
+    switch (in.kind(ExpressionKind::Aggregate)) {
+      case ExpressionKind::Name:
+        run.push_back(Expression::name(in.name()));
+        break;
+      case ExpressionKind::Literal: {
+        NameId text = in.name();
+        run.push_back(Expression::literal(text, in.name()));
+        break;
+      }
+      case ExpressionKind::Unary: {
+        Operator op = in.op();
+        run.push_back(Expression::unary(op, pop()));
+        break;
+      }
+      case ExpressionKind::Binary: {
+        Operator op = in.op();
+        uint32_t right = pop();
+        run.push_back(Expression::binary(op, pop(), right));
+        break;
+      }
+      case ExpressionKind::Aggregate:
+        run.push_back(Expression::aggregate(pop()));
+        break;
+    }
+    sizes.push_back(run.back().size);
+  }
+  if (sizes.size() != 1) {
+    throw std::runtime_error("bad expression in cache entry");
+  }
+  Span<Expression> copy = arena.copy(run);
+  return &copy[copy.size() - 1];
+}
+
+// Operands are never null in a parsed tree
+static Expression* readOperand(CacheReader& in, Arena& arena) {
+  Expression* expr = readExpression(in, arena);
+  if (!expr) {
+    throw std::runtime_error("missing operand in cache entry");
+  }
+  return expr;
+}
+
+static void writeDeclarations(CacheWriter& out, Span<BlockDeclarativeItem*> items) {
+  out.word(static_cast<uint32_t>(items.size()));
+  for (const BlockDeclarativeItem* item : items) {
+    out.word(static_cast<uint32_t>(item->kind));
+    out.name(item->name);
+    writeType(out, item->type);
+    writeExpression(out, item->value);
+  }
+}
+
+static Span<BlockDeclarativeItem*> readDeclarations(CacheReader& in, Arena& arena) {
+  std::vector<BlockDeclarativeItem*> items(in.count());
+  for (BlockDeclarativeItem*& item : items) {
+    switch (in.kind(DeclarationKind::Variable)) {
+      case DeclarationKind::Constant: item = arena.make<ConstantDeclaration>(); break;
+      case DeclarationKind::Signal:   item = arena.make<SignalDeclaration>(); break;
+      case DeclarationKind::Variable: item = arena.make<VariableDeclaration>(); break;
+    }
+    item->setName(in.name());
+    item->setType(readType(in, arena));
+    item->setValue(readExpression(in, arena));
+  }
+  return arena.copy(items);
+}
+
+static void writeStatements(CacheWriter& out, Span<SequentialStatement*> statements);
+
+static void writeSignalAssignment(CacheWriter& out, const SignalAssignment* assignment) {
+  out.name(assignment->target);
+  out.word(assignment->transport);
+  out.word(static_cast<uint32_t>(assignment->waveform.size()));
+  for (const WaveformElement& element : assignment->waveform) {
+    writeExpression(out, element.value);
+    writeExpression(out, element.after);
+  }
+}
+
+static SignalAssignment* readSignalAssignment(CacheReader& in, Arena& arena) {
+  auto assignment = arena.make<SignalAssignment>();
+  assignment->setTarget(in.name());
+  assignment->setTransport(in.word() != 0);
+  std::vector<WaveformElement> waveform(in.count());
+  for (WaveformElement& element : waveform) {
+    element.setValue(readOperand(in, arena));
+    element.setAfter(readExpression(in, arena));
+  }
+  assignment->setWaveform(arena.copy(waveform));
+  return assignment;
+}
+
+static void writeStatement(CacheWriter& out, const SequentialStatement* statement) {
+  out.word(static_cast<uint32_t>(statement->kind));
+  switch (statement->kind) {
+    case StatementKind::SignalAssignment:
+      writeSignalAssignment(out, static_cast<const SignalAssignment*>(statement));
+      break;
+    case StatementKind::VariableAssignment:
+      out.name(static_cast<const VariableAssignment*>(statement)->target);
+      writeExpression(out, static_cast<const VariableAssignment*>(statement)->value);
+      break;
+    case StatementKind::If: {
+      Span<IfBranch> branches = static_cast<const IfStatement*>(statement)->branches;
+      out.word(static_cast<uint32_t>(branches.size()));
+      for (const IfBranch& branch : branches) {
+        writeExpression(out, branch.condition);
+        writeStatements(out, branch.body);
+      }
+      break;
+    }
+    case StatementKind::Null:
+      break;
+  }
+}
+
+static void writeStatements(CacheWriter& out, Span<SequentialStatement*> statements) {
+  out.word(static_cast<uint32_t>(statements.size()));
+  for (const SequentialStatement* statement : statements) {
+    writeStatement(out, statement);
+  }
+}
+
+static Span<SequentialStatement*> readStatements(CacheReader& in, Arena& arena);
+
+static SequentialStatement* readStatement(CacheReader& in, Arena& arena) {
+  switch (in.kind(StatementKind::Null)) {
+    case StatementKind::SignalAssignment:
+      return readSignalAssignment(in, arena);
+    case StatementKind::VariableAssignment: {
+      auto assignment = arena.make<VariableAssignment>();
+      assignment->setTarget(in.name());
+      assignment->setValue(readOperand(in, arena));
+      return assignment;
+    }
+    case StatementKind::If: {
+      auto if_stmt = arena.make<IfStatement>();
+      std::vector<IfBranch> branches(in.count());
+      for (IfBranch& branch : branches) {
+        branch.setCondition(readExpression(in, arena));
+        branch.setBody(readStatements(in, arena));
+      }
+      if_stmt->setBranches(arena.copy(branches));
+      return if_stmt;
+    }
+    case StatementKind::Null:
+      return arena.make<NullStatement>();
+  }
+  return nullptr;
+}
+
+static Span<SequentialStatement*> readStatements(CacheReader& in, Arena& arena) {
+  std::vector<SequentialStatement*> statements(in.count());
+  for (SequentialStatement*& statement : statements) {
+    statement = readStatement(in, arena);
+  }
+  return arena.copy(statements);
+}
+
+static void writeArchitecture(CacheWriter& out, const ArchitectureDeclaration* archtc) {
+  out.name(archtc->identifier);
+  out.name(archtc->entity_name);
+  out.name(archtc->simple_name);
+
+  out.word(archtc->archtct_decl_part != nullptr);
+  if (archtc->archtct_decl_part) {
+    writeDeclarations(out, archtc->archtct_decl_part->items);
+  }
+
+  out.word(static_cast<uint32_t>(archtc->statements.size()));
+  for (const ConcurrentStatement* statement : archtc->statements) {
+    out.word(static_cast<uint32_t>(statement->kind));
+    out.name(statement->label);
+    if (statement->kind == ConcurrentKind::Process) {
+      auto process = static_cast<const ProcessStatement*>(statement);
+      out.word(static_cast<uint32_t>(process->sensitivity.size()));
+      for (NameId name : process->sensitivity) {
+        out.name(name);
+      }
+      writeDeclarations(out, process->declarations);
+      writeStatements(out, process->body);
+    } else {
+      writeSignalAssignment(out, static_cast<const ConcurrentSignalAssignment*>(statement)->assignment);
+    }
+  }
+}
+
+static ArchitectureDeclaration* readArchitecture(CacheReader& in, Arena& arena) {
+  auto archtc = arena.make<ArchitectureDeclaration>();
+  archtc->setIdentifier(in.name());
+  archtc->setEntityName(in.name());
+  archtc->setSimpleName(in.name());
+
+  if (in.word()) {
+    auto part = arena.make<ArchitectureDeclarativePart>();
+    part->setItems(readDeclarations(in, arena));
+    archtc->setDeclarativePart(part);
+  }
+
+  std::vector<ConcurrentStatement*> statements(in.count());
+  for (ConcurrentStatement*& statement : statements) {
+    ConcurrentKind kind = in.kind(ConcurrentKind::SignalAssignment);
+    NameId label = in.name();
+    if (kind == ConcurrentKind::Process) {
+      auto process = arena.make<ProcessStatement>();
+      std::vector<NameId> sensitivity(in.count());
+      for (NameId& name : sensitivity) {
+        name = in.name();
+      }
+      process->setSensitivity(arena.copy(sensitivity));
+      process->setDeclarations(readDeclarations(in, arena));
+      process->setBody(readStatements(in, arena));
+      statement = process;
+    } else {
+      auto assignment = arena.make<ConcurrentSignalAssignment>();
+      assignment->setAssignment(readSignalAssignment(in, arena));
+      statement = assignment;
+    }
+    statement->setLabel(label);
+  }
+  archtc->setStatements(arena.copy(statements));
+  return archtc;
+}
+
+static void writeFile(CacheWriter& out, const VhdlFile& file) {
+  out.name(file.identifier);
+
+  out.word(static_cast<uint32_t>(file.entities.size()));
+  for (const auto& unit : file.entities) {
+    const EntityDeclaration* entity = unit.declaration;
+    out.name(entity->identifier);
+    out.name(entity->simple_name);
+    out.word(entity->entity_header != nullptr);
+    if (entity->entity_header) {
+      writeInterfaceList(out, entity->entity_header->port_list);
+      writeInterfaceList(out, entity->entity_header->generic_list);
+    }
+  }
+
+  out.word(static_cast<uint32_t>(file.architectures.size()));
+  for (const auto& unit : file.architectures) {
+    writeArchitecture(out, unit.declaration);
+  }
+}
+
+static void readFile(CacheReader& in, VhdlFile& file) {
+  file.setIdentifier(in.name());
+
+  for (uint32_t count = in.count(); count > 0; count--) {
+    DesignUnit<EntityDeclaration> unit;
+    Arena& arena = unit.arena;
+    auto entity = arena.make<EntityDeclaration>();
+    entity->setIdentifier(in.name());
+    entity->setSimpleName(in.name());
+    if (in.word()) {
+      auto header = arena.make<EntityHeader>();
+      header->setPortList(readInterfaceList(in, arena));
+      header->generic_list = readInterfaceList(in, arena);
+      entity->setEntityHeader(header);
+    }
+    unit.declaration = entity;
+    file.addEntity(std::move(unit));
+  }
+
+  for (uint32_t count = in.count(); count > 0; count--) {
+    DesignUnit<ArchitectureDeclaration> unit;
+    unit.declaration = readArchitecture(in, unit.arena);
+    file.addArchtc(std::move(unit));
+  }
+}
+
+// ---------------------------------------------------------------------------
+
+DesignCache::DesignCache(const std::string& directory) : directory(directory) {
+  std::error_code ec;
+  fs::create_directories(directory, ec);
+}
+
+uint64_t DesignCache::hashSource(std::string_view source) {
+  // 8 bytes per step with a multiply/xor-shift mix; quality is plenty for a
+  // content key, and it runs at memory speed on large netlists.
+  const uint64_t k = 0x9E3779B97F4A7C15ull;
+  uint64_t hash = 0xCBF29CE484222325ull ^ (source.size() * k);
+  size_t i = 0;
+  for (; i + 8 <= source.size(); i += 8) {
+    uint64_t chunk;
+    std::memcpy(&chunk, source.data() + i, sizeof(chunk));
+    hash = (hash ^ chunk) * k;
+    hash ^= hash >> 29;
+  }
+  uint64_t tail = 0;
+  std::memcpy(&tail, source.data() + i, source.size() - i);
+  hash = (hash ^ tail) * k;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+std::string DesignCache::pathFor(uint64_t hash) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.vlib", static_cast<unsigned long long>(hash));
+  return (fs::path(directory) / name).string();
+}
+
+bool DesignCache::load(uint64_t hash, VhdlFile& file) const {
+  SourceBuffer entry;
+  if (!entry.open(pathFor(hash)) || entry.size() < sizeof(CacheHeader)) {
+    return false;
+  }
+  const char* data = entry.view().data();
+
+  CacheHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+      header.version != FORMAT_VERSION || header.reserved_count != RESERVED_COUNT ||
+      header.source_hash != hash) {
+    return false;
+  }
+  uint64_t names_size = uint64_t(header.name_count) * 8;
+  uint64_t words_size = uint64_t(header.word_count) * 4;
+  if (sizeof(CacheHeader) + names_size + words_size + header.chars_size != entry.size()) {
+    return false;
+  }
+
+  const char* name_table = data + sizeof(CacheHeader);
+  const char* words = name_table + names_size;
+  const char* chars = words + words_size;
+
+  std::vector<NameId> names(header.name_count);
+  for (uint32_t i = 0; i < header.name_count; i++) {
+    uint32_t span[2];
+    std::memcpy(span, name_table + 8 * i, sizeof(span));
+    if (uint64_t(span[0]) + span[1] > header.chars_size) {
+      return false;
+    }
+    names[i] = NameTable::global().intern(std::string_view(chars + span[0], span[1]));
+  }
+
+  VhdlFile loaded;
+  try {
+    CacheReader reader(words, header.word_count, std::move(names));
+    readFile(reader, loaded);
+  } catch (const std::exception&) {
+    return false;
+  }
+  file = std::move(loaded);
+  return true;
+}
+
+bool DesignCache::store(uint64_t hash, const VhdlFile& file) const {
+  CacheWriter out;
+  writeFile(out, file);
+
+  CacheHeader header = {};
+  std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  header.version        = FORMAT_VERSION;
+  header.reserved_count = static_cast<uint32_t>(RESERVED_COUNT);
+  header.source_hash    = hash;
+  header.name_count     = static_cast<uint32_t>(out.names.size() / 2);
+  header.word_count     = static_cast<uint32_t>(out.words.size());
+  header.chars_size     = static_cast<uint32_t>(out.chars.size());
+
+  // Write beside the final name and rename, so concurrent jobs sharing the
+  // cache never see a half-written entry.
+  std::string path = pathFor(hash);
+  std::string temp = path + ".tmp" + std::to_string(std::random_device()());
+  {
+    std::ofstream stream(temp, std::ios::binary | std::ios::trunc);
+    if (!stream.is_open()) {
+      return false;
+    }
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(out.names.data()), out.names.size() * sizeof(uint32_t));
+    stream.write(reinterpret_cast<const char*>(out.words.data()), out.words.size() * sizeof(uint32_t));
+    stream.write(out.chars.data(), out.chars.size());
+    if (!stream.good()) {
+      return false;
+    }
+  }
+  std::error_code ec;
+  fs::rename(temp, path, ec);
+  if (ec) {
+    fs::remove(temp, ec);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "Node.h"
+
+// On-disk cache of parsed files, keyed by a hash of each file's contents.
+//
+// A cache entry is a flat little-endian image that is memory-mapped and read
+// in place: a fixed header, a name table (offset/length pairs into a character
+// block), and the tree as a stream of 32-bit words in which names are indices
+// into that table. Names are stored as text because NameIds are only
+// meaningful inside one process; loading interns them and rebuilds the tree in
+// the file's arenas without touching the lexer or parser.
+class DesignCache {
+public:
+  explicit DesignCache(const std::string& directory);
+
+  static uint64_t hashSource(std::string_view source);
+
+  // Fills `file` from the entry for `hash`. Returns false on a miss or when
+  // the entry was written by an incompatible format version.
+  bool load(uint64_t hash, VhdlFile& file) const;
+
+  // Writes the entry for `hash` (atomically, via rename).
+  bool store(uint64_t hash, const VhdlFile& file) const;
+
+  static constexpr uint32_t FORMAT_VERSION = 4;
+
+private:
+  std::string directory;
+
+  std::string pathFor(uint64_t hash) const;
+};
@@ -0,0 +1,152 @@
+#include "DesignLibrary.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include "SourceBuffer.h"
+#include "Lexer.h"
+#include "TokenStream.h"
+#include "Parser.h"
+#include "ThreadPool.h"
+#include "DesignCache.h"
+#include "Profile.h"
+
+namespace fs = std::filesystem;
+
+static bool isVhdlSource(const fs::path& path) {
+  std::string ext = path.extension().string();
+  std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+  return ext == ".vhd" || ext == ".vhdl";
+}
+
+std::vector<std::string> DesignLibrary::collectSources(const std::string& path) {
+  std::vector<std::string> sources;
+  std::error_code ec;
+
+  if (fs::is_directory(path, ec)) {
+    for (const auto& entry : fs::recursive_directory_iterator(path, ec)) {
+      if (entry.is_regular_file() && isVhdlSource(entry.path())) {
+        sources.push_back(entry.path().string());
+      }
+    }
+    // Directory iteration order is unspecified; keep runs reproducible.
+    std::sort(sources.begin(), sources.end());
+    return sources;
+  }
+
+  std::ifstream list(path);
+  if (!list.is_open()) {
+    throw std::runtime_error("Could not open project " + path);
+  }
+  std::string line;
+  while (std::getline(list, line)) {
+    line.erase(0, line.find_first_not_of(" \t\r"));
+    line.erase(line.find_last_not_of(" \t\r") + 1);
+    if (!line.empty() && line[0] != '#') {
+      sources.push_back(line);
+    }
+  }
+  return sources;
+}
+
+DesignLibrary DesignLibrary::load(const std::vector<std::string>& paths, ThreadPool& pool,
+                                  const DesignCache* cache, bool all_errors) {
+  struct Result {
+    VhdlFile tree;
+    std::vector<std::string> errors;
+    bool cached = false;
+  };
+  std::vector<Result> results(paths.size());
+
+  for (size_t i = 0; i < paths.size(); i++) {
+    pool.submit([&paths, &results, cache, all_errors, i] {
+      ProfileScope scope("load file");
+      Result& result = results[i];
+      SourceBuffer source;
+      if (!source.open(paths[i])) {
+        result.errors.push_back(paths[i] + ": could not open file");
+        return;
+      }
+
+      uint64_t hash = 0;
+      if (cache) {
+        hash = DesignCache::hashSource(source.view());
+        if (cache->load(hash, result.tree)) {
+          result.cached = true;
+          return;
+        }
+      }
+
+      try {
+        Lexer lexer(source.view());
+        TokenStream tokens(lexer);
+        Parser parser(tokens);
+        if (all_errors) {
+          for (const Diagnostic& diagnostic : parser.parseRecovering()) {
+            result.errors.push_back(paths[i] + ": " + diagnostic.message);
+          }
+          if (!result.errors.empty()) {
+            return;
+          }
+        } else {
+          parser.parse();
+        }
+        // The tree only holds interned names, so the buffer can go away now.
+        result.tree = std::move(parser.getTree());
+        if (cache) {
+          cache->store(hash, result.tree);
+        }
+      } catch (const std::exception& e) {
+        result.errors.push_back(paths[i] + ": " + e.what());
+      }
+    });
+  }
+  pool.wait();
+
+  DesignLibrary library;
+  for (size_t i = 0; i < paths.size(); i++) {
+    if (!results[i].errors.empty()) {
+      for (const std::string& error : results[i].errors) {
+        library.addError(error);
+      }
+    } else {
+      library.cache_hits += results[i].cached;
+      library.add(paths[i], std::move(results[i].tree));
+    }
+  }
+  return library;
+}
+
+void DesignLibrary::add(const std::string& path, VhdlFile&& tree) {
+  auto unit = std::make_unique<Unit>();
+  unit->path = path;
+  unit->tree = std::move(tree);
+
+  for (const auto& entity_unit : unit->tree.entities) {
+    const EntityDeclaration* entity = entity_unit.declaration;
+    auto inserted = entities.emplace(entity->identifier, entity);
+    if (inserted.second) {
+      entity_order.push_back(entity->identifier);
+    } else {
+      addError(path + ": entity '" + NameTable::global().str(entity->identifier) + "' is already declared");
+    }
+  }
+  for (const auto& archtc_unit : unit->tree.architectures) {
+    const ArchitectureDeclaration* archtc = archtc_unit.declaration;
+    architectures[archtc->entity_name].push_back(archtc);
+  }
+  units.push_back(std::move(unit));
+}
+
+void DesignLibrary::addError(const std::string& message) {
+  errors.push_back(message);
+}
+
+const EntityDeclaration* DesignLibrary::findEntity(NameId name) const {
+  auto it = entities.find(name);
+  return it != entities.end() ? it->second : nullptr;
+}
+
+std::vector<const ArchitectureDeclaration*> DesignLibrary::architecturesOf(NameId entity) const {
+  auto it = architectures.find(entity);
+  return it != architectures.end() ? it->second : std::vector<const ArchitectureDeclaration*>();
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Node.h"
+
+class ThreadPool;
+class DesignCache;
+
+// Design units gathered from many source files, indexed by entity name.
+class DesignLibrary {
+public:
+  struct Unit {
+    std::string path;
+    VhdlFile tree;
+  };
+
+  // Collects the .vhd/.vhdl files under a directory (recursively), or the
+  // paths listed one per line in a file list ('#' starts a comment).
+  static std::vector<std::string> collectSources(const std::string& path);
+
+  // Lexes and parses every file on `pool`, one task per file, then merges the
+  // trees in the order the paths were given so the result is deterministic.
+  // With a cache, files whose contents are unchanged since they were cached
+  // are loaded from it instead, and freshly parsed files are added to it.
+  // With `all_errors` every syntax error of a file is reported, not just the
+  // first one.
+  static DesignLibrary load(const std::vector<std::string>& paths, ThreadPool& pool,
+                            const DesignCache* cache = nullptr, bool all_errors = false);
+
+  void add(const std::string& path, VhdlFile&& tree);
+  void addError(const std::string& message);
+
+  const EntityDeclaration* findEntity(NameId name) const;
+  std::vector<const ArchitectureDeclaration*> architecturesOf(NameId entity) const;
+
+  const std::vector<std::unique_ptr<Unit>>& getUnits() const {
+    return units;
+  }
+
+  const std::vector<NameId>& getEntityNames() const {
+    return entity_order;
+  }
+
+  const std::vector<std::string>& getErrors() const {
+    return errors;
+  }
+
+  size_t getCacheHits() const {
+    return cache_hits;
+  }
+
+private:
+  std::vector<std::unique_ptr<Unit>> units;
+  std::unordered_map<NameId, const EntityDeclaration*> entities;
+  std::unordered_map<NameId, std::vector<const ArchitectureDeclaration*>> architectures;
+  std::vector<NameId> entity_order;
+  std::vector<std::string> errors;
+  size_t cache_hits = 0;
+};
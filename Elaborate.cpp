@@ -0,0 +1,255 @@
+#include "Elaborate.h"
+#include <algorithm>
+
+static std::runtime_error elaborationError(const std::string& message, NameId name) {
+  return std::runtime_error(message + " '" + NameTable::global().str(name) + "'");
+}
+
+const NameRef* Design::resolve(const ProcessInfo& process, NameId name) const {
+  auto local = process.locals.find(name);
+  if (local != process.locals.end()) {
+    return &local->second;
+  }
+  auto global = names.find(name);
+  return global != names.end() ? &global->second : nullptr;
+}
+
+int Design::findSignal(NameId name) const {
+  auto it = names.find(name);
+  if (it == names.end() || it->second.kind != RefKind::Signal) {
+    return -1;
+  }
+  return static_cast<int>(it->second.index);
+}
+
+std::string Design::processName(uint32_t process) const {
+  const ProcessInfo& info = processes[process];
+  if (info.label != NO_NAME) {
+    return "process '" + NameTable::global().str(info.label) + "'";
+  }
+  if (!info.drives.empty()) {
+    return "the process driving '" + NameTable::global().str(signals[info.drives.front()].name) + "'";
+  }
+  return "process #" + std::to_string(process);
+}
+
+// Initial values and constants may only refer to constants.
+static Value evaluateStatic(const Design& design, const ProcessInfo& scope, const Expression* expr, const ValueType& type) {
+  return evaluateExpression(expr, &type, [&](NameId name) -> const Value& {
+    const NameRef* ref = design.resolve(scope, name);
+    if (!ref) {
+      throw elaborationError("unknown name", name);
+    }
+    if (ref->kind != RefKind::Constant) {
+      throw elaborationError("initial value refers to non-constant", name);
+    }
+    return design.constants[ref->index];
+  });
+}
+
+// Signals read by an expression, in order of first use. Names appear in the
+// postfix run in source order, so one pass over it finds them.
+static void collectSignals(const Design& design, const ProcessInfo& scope, const Expression* expr,
+                           std::vector<uint32_t>& signals) {
+  for (const Expression& node : expr->nodes()) {
+    if (node.kind != ExpressionKind::Name) {
+      continue;
+    }
+    const NameRef* ref = design.resolve(scope, node.identifier());
+    if (!ref) {
+      throw elaborationError("unknown name", node.identifier());
+    }
+    if (ref->kind == RefKind::Signal &&
+        std::find(signals.begin(), signals.end(), ref->index) == signals.end()) {
+      signals.push_back(ref->index);
+    }
+  }
+}
+
+// Checks every name used by `statements` and records the signals they drive.
+static void checkStatements(const Design& design, const ProcessInfo& scope, Span<SequentialStatement*> statements,
+                            std::vector<uint32_t>& reads, std::vector<uint32_t>& drives);
+
+static void checkStatement(const Design& design, const ProcessInfo& scope, const SequentialStatement* statement,
+                           std::vector<uint32_t>& reads, std::vector<uint32_t>& drives) {
+  switch (statement->kind) {
+    case StatementKind::SignalAssignment: {
+      auto assignment = static_cast<const SignalAssignment*>(statement);
+      const NameRef* ref = design.resolve(scope, assignment->target);
+      if (!ref || ref->kind != RefKind::Signal) {
+        throw elaborationError("signal assignment to non-signal", assignment->target);
+      }
+      if (design.signals[ref->index].mode == Keyword::In) {
+        throw elaborationError("assignment to input port", assignment->target);
+      }
+      if (std::find(drives.begin(), drives.end(), ref->index) == drives.end()) {
+        drives.push_back(ref->index);
+      }
+      for (const WaveformElement& element : assignment->waveform) {
+        collectSignals(design, scope, element.value, reads);
+        if (element.after) {
+          collectSignals(design, scope, element.after, reads);
+        }
+      }
+      break;
+    }
+    case StatementKind::VariableAssignment: {
+      auto assignment = static_cast<const VariableAssignment*>(statement);
+      const NameRef* ref = design.resolve(scope, assignment->target);
+      if (!ref || ref->kind != RefKind::Variable) {
+        throw elaborationError("variable assignment to non-variable", assignment->target);
+      }
+      collectSignals(design, scope, assignment->value, reads);
+      break;
+    }
+    case StatementKind::If:
+      for (const IfBranch& branch : static_cast<const IfStatement*>(statement)->branches) {
+        if (branch.condition) {
+          collectSignals(design, scope, branch.condition, reads);
+        }
+        checkStatements(design, scope, branch.body, reads, drives);
+      }
+      break;
+    case StatementKind::Null:
+      break;
+  }
+}
+
+static void checkStatements(const Design& design, const ProcessInfo& scope, Span<SequentialStatement*> statements,
+                            std::vector<uint32_t>& reads, std::vector<uint32_t>& drives) {
+  for (const SequentialStatement* statement : statements) {
+    checkStatement(design, scope, statement, reads, drives);
+  }
+}
+
+Design Design::elaborate(const EntityDeclaration& entity, const ArchitectureDeclaration& archtc) {
+  Design design;
+  design.entity_name       = entity.identifier;
+  design.architecture_name = archtc.identifier;
+
+  const ProcessInfo no_scope;
+
+  auto declare = [&design](NameId name, NameRef ref) {
+    if (!design.names.emplace(name, ref).second) {
+      throw elaborationError("duplicate declaration of", name);
+    }
+  };
+
+  // Predefined boolean literals
+  design.constants.push_back(Value::makeBoolean(false));
+  declare(NameTable::global().intern("false"), NameRef{RefKind::Constant, 0});
+  design.constants.push_back(Value::makeBoolean(true));
+  declare(NameTable::global().intern("true"), NameRef{RefKind::Constant, 1});
+
+  // Ports
+  if (entity.entity_header && entity.entity_header->port_list) {
+    for (const InterfaceElement& port : entity.entity_header->port_list->elems) {
+      SignalInfo signal;
+      signal.name    = port.identifier;
+      signal.mode    = port.mode == Keyword::None ? Keyword::In : port.mode;
+      signal.type    = ValueType::fromInterfaceType(*port.type);
+      signal.initial = Value::defaultFor(signal.type);
+      declare(signal.name, NameRef{RefKind::Signal, static_cast<uint32_t>(design.signals.size())});
+      design.signals.push_back(signal);
+    }
+  }
+
+  // Architecture signals and constants
+  if (archtc.archtct_decl_part) {
+    for (const BlockDeclarativeItem* item : archtc.archtct_decl_part->items) {
+      ValueType type = ValueType::fromInterfaceType(*item->type);
+      if (item->kind == DeclarationKind::Constant && !item->value) {
+        throw elaborationError("deferred constants are not supported:", item->name);
+      }
+      Value initial = item->value ? evaluateStatic(design, no_scope, item->value, type) : Value::defaultFor(type);
+      checkAssignable(type, initial, item->name);
+
+      if (item->kind == DeclarationKind::Signal) {
+        declare(item->name, NameRef{RefKind::Signal, static_cast<uint32_t>(design.signals.size())});
+        design.signals.push_back(SignalInfo{item->name, Keyword::None, type, initial, -1});
+      } else {
+        declare(item->name, NameRef{RefKind::Constant, static_cast<uint32_t>(design.constants.size())});
+        design.constants.push_back(initial);
+      }
+    }
+  }
+
+  // Processes
+  for (const ConcurrentStatement* statement : archtc.statements) {
+    ProcessInfo process;
+    process.label = statement->label;
+    std::vector<uint32_t>& reads  = process.reads;
+    std::vector<uint32_t>& drives = process.drives;
+
+    if (statement->kind == ConcurrentKind::Process) {
+      auto body = static_cast<const ProcessStatement*>(statement);
+      if (body->sensitivity.empty()) {
+        throw std::runtime_error("processes without a sensitivity list are not supported (no wait statements)");
+      }
+
+      for (const BlockDeclarativeItem* item : body->declarations) {
+        ValueType type = ValueType::fromInterfaceType(*item->type);
+        Value initial = item->value ? evaluateStatic(design, process, item->value, type) : Value::defaultFor(type);
+        checkAssignable(type, initial, item->name);
+
+        NameRef ref;
+        if (item->kind == DeclarationKind::Variable) {
+          ref = NameRef{RefKind::Variable, static_cast<uint32_t>(process.variables.size())};
+          process.variables.push_back(VariableInfo{item->name, type, initial});
+        } else {
+          ref = NameRef{RefKind::Constant, static_cast<uint32_t>(design.constants.size())};
+          design.constants.push_back(initial);
+        }
+        if (!process.locals.emplace(item->name, ref).second) {
+          throw elaborationError("duplicate declaration of", item->name);
+        }
+      }
+
+      for (NameId name : body->sensitivity) {
+        int signal = design.findSignal(name);
+        if (signal < 0) {
+          throw elaborationError("sensitivity list names non-signal", name);
+        }
+        process.sensitivity.push_back(static_cast<uint32_t>(signal));
+      }
+      process.body.assign(body->body.begin(), body->body.end());
+      checkStatements(design, process, body->body, reads, drives);
+    } else {
+      // The implicit process is sensitive to every signal it reads
+      auto assignment = static_cast<const ConcurrentSignalAssignment*>(statement)->assignment;
+      process.body.push_back(assignment);
+      checkStatement(design, process, assignment, reads, drives);
+      process.sensitivity = reads;
+    }
+
+    int index = static_cast<int>(design.processes.size());
+    for (uint32_t signal : drives) {
+      SignalInfo& info = design.signals[signal];
+      if (info.driver >= 0) {
+        throw elaborationError("multiple processes drive signal", info.name);
+      }
+      info.driver = index;
+    }
+    design.processes.push_back(std::move(process));
+  }
+
+  // Fan-out: count the processes of each signal, then place them
+  design.fanout_starts.assign(design.signals.size() + 1, 0);
+  for (const ProcessInfo& process : design.processes) {
+    for (uint32_t signal : process.sensitivity) {
+      design.fanout_starts[signal + 1]++;
+    }
+  }
+  for (size_t signal = 0; signal < design.signals.size(); signal++) {
+    design.fanout_starts[signal + 1] += design.fanout_starts[signal];
+  }
+  design.fanout_processes.resize(design.fanout_starts.back());
+  std::vector<uint32_t> next(design.fanout_starts.begin(), design.fanout_starts.end() - 1);
+  for (uint32_t p = 0; p < design.processes.size(); p++) {
+    for (uint32_t signal : design.processes[p].sensitivity) {
+      design.fanout_processes[next[signal]++] = p;
+    }
+  }
+
+  return design;
+}
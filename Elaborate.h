@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Node.h"
+#include "Value.h"
+
+// An entity port or architecture signal of the elaborated design.
+struct SignalInfo {
+  NameId    name = NO_NAME;
+  Keyword   mode = Keyword::None;  // port mode, None for internal signals
+  ValueType type;
+  Value     initial;
+  int       driver = -1;           // process that drives it, -1 for inputs
+};
+
+struct VariableInfo {
+  NameId    name = NO_NAME;
+  ValueType type;
+  Value     initial;
+};
+
+// What a name used inside a process refers to.
+enum class RefKind : uint8_t {
+  Signal, Variable, Constant,
+};
+
+struct NameRef {
+  RefKind  kind;
+  uint32_t index;
+};
+
+// A process statement, or the implicit process of a concurrent assignment.
+struct ProcessInfo {
+  NameId label = NO_NAME;
+  std::vector<const SequentialStatement*> body;
+  std::vector<uint32_t> sensitivity;                 // signal ids
+  std::vector<uint32_t> reads;                       // signals read anywhere in the body
+  std::vector<uint32_t> drives;                      // signals assigned by the body
+  std::vector<VariableInfo> variables;
+  std::unordered_map<NameId, NameRef> locals;        // variables and process constants
+};
+
+// One entity/architecture pair resolved into flat tables of signals and
+// processes. The design refers into the AST, so the VhdlFile (or library)
+// it was elaborated from must outlive it.
+class Design {
+public:
+  // Throws std::runtime_error for unknown names, unsupported types, signals
+  // with more than one driving process, and assignments to input ports.
+  static Design elaborate(const EntityDeclaration& entity, const ArchitectureDeclaration& archtc);
+
+  NameId entity_name       = NO_NAME;
+  NameId architecture_name = NO_NAME;
+
+  std::vector<SignalInfo>  signals;
+  std::vector<Value>       constants;
+  std::vector<ProcessInfo> processes;
+
+  // Processes sensitive to each signal as one compressed sparse row table:
+  // those of signal s are fanout_processes[fanout_starts[s], fanout_starts[s + 1]),
+  // in process order.
+  std::vector<uint32_t> fanout_starts;
+  std::vector<uint32_t> fanout_processes;
+
+  Span<const uint32_t> fanout(uint32_t signal) const {
+    return Span<const uint32_t>(fanout_processes.data() + fanout_starts[signal],
+                                fanout_starts[signal + 1] - fanout_starts[signal]);
+  }
+
+  // Resolves a name as seen from inside `process`.
+  const NameRef* resolve(const ProcessInfo& process, NameId name) const;
+
+  // Signal id of a port or architecture signal, or -1.
+  int findSignal(NameId name) const;
+
+  // "process 'label'", "the process driving 'x'" or "process #n", for messages.
+  std::string processName(uint32_t process) const;
+
+private:
+  std::unordered_map<NameId, NameRef> names;  // signals and architecture constants
+};
@@ -0,0 +1,127 @@
+#pragma once
+#include <cstdint>
+#include "Node.h"
+
+/*
+expression ::=
+  relation { and relation } | relation { or relation } | relation { xor relation }
+| relation [ nand relation ] | relation [ nor relation ] | relation { xnor relation }
+
+relation        ::= shift_expression [ relational_operator shift_expression ]
+shift_expression ::= simple_expression [ shift_operator simple_expression ]
+simple_expression ::= [ sign ] term { adding_operator term }
+term            ::= factor { multiplying_operator factor }
+factor          ::= primary [ ** primary ] | abs primary | not primary
+primary         ::= name | literal | aggregate | ( expression )
+*/
+
+
+enum class ExpressionKind : uint8_t {
+  Name, Literal, Unary, Binary, Aggregate,
+};
+
+
+// One node of an expression. A whole expression is stored as one contiguous
+// run of nodes in postfix order: every operator follows its operands, and the
+// root is the last node of the run. Children are therefore found by position
+// rather than by pointer (the operand of a unary node is the node just before
+// it, the right operand of a binary node likewise, and its left operand ends
+// where the right one's subtree starts), each node being 16 bytes with no
+// vtable. Statements and declarations point at the root.
+class Expression {
+public:
+  ExpressionKind kind = ExpressionKind::Name;
+  Operator op = Operator::None;  // Unary and Binary
+  uint32_t size = 1;             // nodes in the subtree rooted here, itself included
+
+  static Expression name(NameId identifier) {
+    return Expression(ExpressionKind::Name, Operator::None, identifier, NO_NAME);
+  }
+
+  // Character, string, numeric and physical literals. `text` is the spelling
+  // as lexed (quotes included); `unit` is set for physical literals such as `5 ns`.
+  static Expression literal(NameId text, NameId unit) {
+    return Expression(ExpressionKind::Literal, Operator::None, text, unit);
+  }
+
+  // The following take the sizes of their operand subtrees, which must
+  // immediately precede them in the run.
+  static Expression unary(Operator op, uint32_t operand_size) {
+    Expression node(ExpressionKind::Unary, op, NO_NAME, NO_NAME);
+    node.size = 1 + operand_size;
+    return node;
+  }
+
+  static Expression binary(Operator op, uint32_t left_size, uint32_t right_size) {
+    Expression node(ExpressionKind::Binary, op, NO_NAME, NO_NAME);
+    node.size = 1 + left_size + right_size;
+    return node;
+  }
+
+  // Only the `(others => <expression>)` form; its width comes from the target.
+  static Expression aggregate(uint32_t others_size) {
+    Expression node(ExpressionKind::Aggregate, Operator::None, NO_NAME, NO_NAME);
+    node.size = 1 + others_size;
+    return node;
+  }
+
+  NameId identifier() const { return first; }
+  NameId text() const { return first; }
+  NameId unit() const { return second; }
+
+  const Expression* operand() const { return this - 1; }
+  const Expression* others() const { return this - 1; }
+  const Expression* right() const { return this - 1; }
+  const Expression* left() const { return right() - right()->size; }
+
+  // The subtree rooted here, operands first; for a root, its whole run.
+  Span<const Expression> nodes() const {
+    return Span<const Expression>(this + 1 - size, size);
+  }
+
+  void dump(std::ostream& out) const {
+    switch (kind) {
+      case ExpressionKind::Name:
+        out << NameTable::global().spelling(first);
+        break;
+      case ExpressionKind::Literal:
+        out << NameTable::global().spelling(first);
+        if (second != NO_NAME) {
+          out << " " << NameTable::global().spelling(second);
+        }
+        break;
+      case ExpressionKind::Unary:
+        out << "(" << operatorSpelling(op) << " ";
+        operand()->dump(out);
+        out << ")";
+        break;
+      case ExpressionKind::Binary:
+        out << "(";
+        left()->dump(out);
+        out << " " << operatorSpelling(op) << " ";
+        right()->dump(out);
+        out << ")";
+        break;
+      case ExpressionKind::Aggregate:
+        out << "(others => ";
+        others()->dump(out);
+        out << ")";
+        break;
+    }
+  }
+
+  std::string toString() const {
+    std::ostringstream out;
+    dump(out);
+    return out.str();
+  }
+
+private:
+  NameId first  = NO_NAME;
+  NameId second = NO_NAME;
+
+  Expression(ExpressionKind kind, Operator op, NameId first, NameId second)
+      : kind(kind), op(op), first(first), second(second) {}
+};
+
+static_assert(sizeof(Expression) == 16, "expression nodes are packed four to a cache line");
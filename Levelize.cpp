@@ -0,0 +1,137 @@
+#include "Levelize.h"
+#include <algorithm>
+
+static std::string signalName(const Design& design, uint32_t signal) {
+  return "'" + NameTable::global().str(design.signals[signal].name) + "'";
+}
+
+// First signal assigned with an `after` clause, or -1.
+static int delayedTarget(const Design& design, Span<SequentialStatement*> statements);
+
+static int delayedTarget(const Design& design, const SequentialStatement* statement) {
+  switch (statement->kind) {
+    case StatementKind::SignalAssignment: {
+      auto assignment = static_cast<const SignalAssignment*>(statement);
+      for (const WaveformElement& element : assignment->waveform) {
+        if (element.after) {
+          return design.findSignal(assignment->target);
+        }
+      }
+      return -1;
+    }
+    case StatementKind::If:
+      for (const IfBranch& branch : static_cast<const IfStatement*>(statement)->branches) {
+        int target = delayedTarget(design, branch.body);
+        if (target >= 0) return target;
+      }
+      return -1;
+    default:
+      return -1;
+  }
+}
+
+static int delayedTarget(const Design& design, Span<SequentialStatement*> statements) {
+  for (const SequentialStatement* statement : statements) {
+    int target = delayedTarget(design, statement);
+    if (target >= 0) return target;
+  }
+  return -1;
+}
+
+static CyclePlan reject(std::string reason) {
+  CyclePlan plan;
+  plan.reason = std::move(reason);
+  return plan;
+}
+
+CyclePlan CyclePlan::analyze(const Design& design) {
+  CyclePlan plan;
+  size_t count = design.processes.size();
+  plan.roles.resize(count);
+
+  auto isInput = [&design](uint32_t signal) { return design.signals[signal].driver < 0; };
+
+  for (uint32_t p = 0; p < count; p++) {
+    const ProcessInfo& process = design.processes[p];
+    for (const SequentialStatement* statement : process.body) {
+      int target = delayedTarget(design, statement);
+      if (target >= 0) {
+        return reject(design.processName(p) + " assigns " + signalName(design, static_cast<uint32_t>(target)) +
+                      " with an 'after' delay");
+      }
+    }
+
+    if (!process.sensitivity.empty() &&
+        std::all_of(process.sensitivity.begin(), process.sensitivity.end(), isInput)) {
+      plan.roles[p] = ProcessRole::Sequential;
+      continue;
+    }
+
+    // Woken by other processes: it must be a pure function of what it reads
+    plan.roles[p] = ProcessRole::Combinational;
+    if (!process.variables.empty()) {
+      return reject(design.processName(p) + " keeps state in variables but is woken by a driven signal");
+    }
+    for (uint32_t signal : process.reads) {
+      if (std::find(process.sensitivity.begin(), process.sensitivity.end(), signal) == process.sensitivity.end()) {
+        return reject(design.processName(p) + " reads " + signalName(design, signal) +
+                      ", which is not in its sensitivity list");
+      }
+    }
+  }
+
+  // Levelize the combinational processes (Kahn's algorithm, one level at a time)
+  std::vector<std::vector<uint32_t>> successors(count);
+  std::vector<uint32_t> pending(count, 0);  // unscheduled combinational predecessors
+  for (uint32_t p = 0; p < count; p++) {
+    if (plan.roles[p] != ProcessRole::Combinational) continue;
+    for (uint32_t signal : design.processes[p].reads) {
+      int driver = design.signals[signal].driver;
+      if (driver < 0 || plan.roles[driver] != ProcessRole::Combinational) continue;
+      if (static_cast<uint32_t>(driver) == p) {
+        return reject("combinational loop: " + design.processName(p) + " reads " + signalName(design, signal) +
+                      ", which it drives");
+      }
+      successors[driver].push_back(p);
+      pending[p]++;
+    }
+  }
+
+  std::vector<uint32_t> level;
+  for (uint32_t p = 0; p < count; p++) {
+    if (plan.roles[p] == ProcessRole::Combinational && pending[p] == 0) {
+      level.push_back(p);
+    }
+  }
+  while (!level.empty()) {
+    plan.level_starts.push_back(static_cast<uint32_t>(plan.order.size()));
+    plan.order.insert(plan.order.end(), level.begin(), level.end());
+    std::vector<uint32_t> next;
+    for (uint32_t p : level) {
+      for (uint32_t successor : successors[p]) {
+        if (--pending[successor] == 0) {
+          next.push_back(successor);
+        }
+      }
+    }
+    std::sort(next.begin(), next.end());
+    level.swap(next);
+  }
+  plan.level_starts.push_back(static_cast<uint32_t>(plan.order.size()));
+
+  for (uint32_t p = 0; p < count; p++) {
+    if (pending[p] != 0) {
+      // Name a signal on the loop: one this process reads from another unscheduled process
+      for (uint32_t signal : design.processes[p].reads) {
+        int driver = design.signals[signal].driver;
+        if (driver >= 0 && pending[driver] != 0) {
+          return reject("combinational loop through " + signalName(design, signal));
+        }
+      }
+      return reject("combinational loop through " + design.processName(p));
+    }
+  }
+
+  plan.usable = true;
+  return plan;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Elaborate.h"
+
+enum class ProcessRole : uint8_t {
+  Sequential,     // woken only by undriven inputs, e.g. process(clk, reset)
+  Combinational,  // stateless, sensitive to everything it reads
+};
+
+// Static schedule for cycle-based simulation of a synchronous design.
+//
+// A design qualifies when every process is either sequential or
+// combinational, no assignment has an `after` delay, and the combinational
+// processes form no loop. Then each change of the inputs can be simulated as
+// one cycle: run the woken sequential processes against the current values,
+// commit their assignments, and evaluate the affected combinational processes
+// once each in level order -- the same result the event-driven kernel reaches
+// through delta cycles, without the event queue.
+struct CyclePlan {
+  bool usable = false;
+  std::string reason;                  // why not, when !usable
+
+  std::vector<ProcessRole> roles;      // per process
+  std::vector<uint32_t> order;         // combinational processes, level by level
+  std::vector<uint32_t> level_starts;  // index into `order` where each level begins, plus the end
+
+  size_t levels() const {
+    return level_starts.empty() ? 0 : level_starts.size() - 1;
+  }
+
+  static CyclePlan analyze(const Design& design);
+};
@@ -1,147 +1,138 @@
 #include "Lexer.h"
 #include "Token.h"
+#include "Scan.h"
+#include "ThreadPool.h"
+#include <algorithm>
 
-Lexer::Lexer(const std::string& input) {
+Lexer::Lexer(std::string_view input, int first_line) : lines(first_line) {
   this->input = input;
   this->pos   = 0;
-  this->line  = 1;
-  this->col   = 0;
   this->max_pos = input.size();
+  this->scan    = &scanKernels();
+}
+
+// Classify input[start, pos) and intern the spelling of identifiers and literals
+Token Lexer::makeToken(size_t start) const {
+  Token token(input.substr(start, pos - start), start);
+  if (token.getTokenType() == TokenType::Identifier || token.getTokenType() == TokenType::Literal) {
+    token.setName(NameTable::global().intern(token.getText()));
+  }
+  return token;
 }
 
 Token Lexer::getNextToken() {
   while (true) {
-    skipWhitespace();      
+    skipWhitespace();
+    if (pos < max_pos && input[pos] == '\n') {
+      pos++;
+      lines.addLine(pos);
+      continue;
+    }
     if (!skipComments()) {
       break;
-    }                  
+    }
   }
 
   if (pos >= max_pos) {
-    return Token(TokenType::EoF, "", line, col);
+    return Token(TokenType::EoF, "", pos);
   }
 
   char cur = input[pos];
-  int tok_col = col;
-  int tok_line = line;
-  std::string token_value = "";
+  size_t start = pos;
+  size_t offset = start;
 
   // identifiers / keywords / operators
-  if (isalpha(cur)) {
-    while (pos < max_pos && (isalnum(input[pos]) || input[pos] == '_')) {
-      token_value += input[pos++];
-      col++;
-    }
-    return Token(token_value, tok_line, tok_col);
+  if (asciiAlpha(cur)) {
+    pos = scan->identifier(input.data(), pos + 1, max_pos);
+    return makeToken(start);
   }
 
   // numeric / based literals
-  if (isdigit(cur)) {
-    while (pos < max_pos && isdigit(input[pos])) {
-      token_value += input[pos++];
-      col++;
+  if (asciiDigit(cur)) {
+    while (pos < max_pos && asciiDigit(input[pos])) {
+      pos++;
     }
     if (pos < max_pos && input[pos] == '.') {
-      token_value += input[pos++];
-      col++;
-      while (pos < max_pos && isdigit(input[pos])) {
-        token_value += input[pos++];
-        col++;
+      pos++;
+      while (pos < max_pos && asciiDigit(input[pos])) {
+        pos++;
       }
     } else if (pos < max_pos && input[pos] == '#') {
-      token_value += input[pos++];
-      col++;
+      pos++;
       while (pos < max_pos && input[pos] != '#') {
-        char ch = tolower(input[pos]);
-        if (!isalnum(ch) && ch != '.' && ch != '-' && ch != '+' && ch != 'e') {
-          return Token(TokenType::Error, "Err: invalid character in based literal", tok_line, tok_col);
+        char ch = lowerAscii(input[pos]);
+        if (!asciiAlnum(ch) && ch != '.' && ch != '-' && ch != '+' && ch != 'e') {
+          return Token(TokenType::Error, "Err: invalid character in based literal", offset);
         }
-        token_value += input[pos++];
-        col++;
+        pos++;
       }
       if (pos < max_pos && input[pos] == '#') {
-        token_value += input[pos++];
-        col++;
+        pos++;
       } else {
-        return Token(TokenType::Error, "Err: missing closing '#'", tok_line, tok_col);
+        return Token(TokenType::Error, "Err: missing closing '#'", offset);
       }
     }
-    return Token(token_value, tok_line, tok_col);
+    return makeToken(start);
   }
 
   // string literal
   if (cur == '"') {
-    token_value += input[pos++];
-    col++;
-    while (pos < max_pos && input[pos] != '"') {
-      token_value += input[pos++];
-      col++;
+    pos = scan->toQuote(input.data(), pos + 1, max_pos);
+    for (size_t i = start + 1; i < pos; i++) {
+      if (input[i] == '\n') {
+        lines.addLine(i + 1);  // keeps later positions right
+      }
     }
     if (pos < max_pos && input[pos] == '"') {
-      token_value += input[pos++];
-      col++;
+      pos++;
     } else {
-      return Token(TokenType::Error, "Err: missing closing quote", tok_line, tok_col);
+      return Token(TokenType::Error, "Err: missing closing quote", offset);
     }
-    return Token(token_value, tok_line, tok_col);
+    return makeToken(start);
   }
 
   // character literal
   if (cur == '\'') {
-    token_value += input[pos++];
-    col++;
-    if (pos < input.size() && isalnum(input[pos])) {
-      token_value += input[pos++];
-      col++;
+    pos++;
+    if (pos < input.size() && asciiAlnum(input[pos])) {
+      pos++;
     } else {
-      return Token(TokenType::Error, "Err: invalid char literal", tok_line, tok_col);
+      return Token(TokenType::Error, "Err: invalid char literal", offset);
     }
     if (pos < input.size() && input[pos] == '\'') {
-      token_value += input[pos++];
-      col++;
+      pos++;
     } else {
-      return Token(TokenType::Error, "Err: missing closing single quote", tok_line, tok_col);
+      return Token(TokenType::Error, "Err: missing closing single quote", offset);
     }
-    return Token(token_value, tok_line, tok_col);
-  }
-
-  // end-of-line
-  if (cur == '\n') {
-    token_value += input[pos++];
-    line++;
-    col = 0;
-    return Token(token_value, tok_line, tok_col);
+    return makeToken(start);
   }
 
   // operators (including two-character operators)
   if (strchr("+-*/&=<>:?", input[pos])) {
     if (pos + 1 < input.size()) {
-      std::string twoChar = std::string(1, input[pos]) + input[pos + 1];
+      std::string_view twoChar = input.substr(pos, 2);
       if (Token::isOperator(twoChar)) {
         pos += 2;
-        col += 2;
-        return Token(twoChar, tok_line, tok_col);
+        return makeToken(pos - 2);
       }
     }
 
-    std::string oneChar(1, input[pos]);
+    std::string_view oneChar = input.substr(pos, 1);
     if (Token::isOperator(oneChar)) {
       pos++;
-      col++;
-      return Token(oneChar, tok_line, tok_col);
+      return makeToken(pos - 1);
     }
   }
 
   // symbols (punctuation and delimiters)
-  std::string singleChar(1, input[pos]);
+  std::string_view singleChar = input.substr(pos, 1);
   if (Token::isSymbol(singleChar)) {
-    token_value += input[pos++];
-    col++;
-    return Token(token_value, tok_line, tok_col);
+    pos++;
+    return makeToken(start);
   }
   
   // unknown character
-  return Token(TokenType::Error, "Err: unknown token", tok_line, tok_col);
+  return Token(TokenType::Error, "Err: unknown token", offset);
 }
 
 bool Lexer::hasMoreTokens() const {
@@ -149,22 +140,141 @@ bool Lexer::hasMoreTokens() const {
 }
 
 void Lexer::skipWhitespace() {
-  while(pos < max_pos && (input[pos] == ' ' || input[pos] == '\t' || input[pos] == '\r')) { 
-    pos++; 
-    col++; 
-  }
+  size_t end = scan->blanks(input.data(), pos, max_pos);
+  pos = end;
 };
 
 bool Lexer::skipComments() {
   if (pos + 1 >= input.size()) return false;
   if (input[pos] == '-' && input[pos + 1] == '-') {
-    pos += 2;
-    col += 2;
-    while (pos < input.size() && input[pos] != '\n') {
-      pos++;
-      col++;
-    }
+    size_t end = scan->toNewline(input.data(), pos + 2, max_pos);
+    pos = end;
     return true;
   }
   return false;
-}
\ No newline at end of file
+}
+
+// Chunks begin at line starts, where the lexer is between tokens unless a
+// string literal spans the newline (comments end at the newline). Each chunk
+// is lexed on the assumption that it begins between tokens; the fix-up pass
+// checks that against where the previous chunk's last token actually ended.
+namespace {
+struct Chunk {
+  size_t begin = 0;
+  size_t end   = 0;
+  std::vector<Token> tokens;   // starting in [begin, end)
+  size_t last_end = 0;         // just past the last of them
+  std::vector<size_t> lines;   // line starts in (begin, end]
+
+  // Set by the fix-up: tokens lexed again from the true start of the chunk,
+  // then tokens[adopt, keep) and, at the output index `first`
+  std::vector<Token> relexed;
+  size_t adopt = 0;
+  size_t keep  = 0;
+  size_t first = 0;
+};
+}
+
+LexedSource Lexer::lexParallel(std::string_view input, ThreadPool& pool, size_t chunk_bytes) {
+  std::vector<Chunk> chunks;
+  for (size_t begin = 0; begin < input.size() || chunks.empty();) {
+    Chunk chunk;
+    chunk.begin = begin;
+    chunk.end = input.size();
+    if (input.size() - begin > chunk_bytes) {
+      size_t newline = input.find('\n', begin + chunk_bytes);
+      if (newline != std::string_view::npos) {
+        chunk.end = newline + 1;
+      }
+    }
+    begin = chunk.end;
+    chunks.push_back(std::move(chunk));
+  }
+
+  pool.parallelFor(chunks.size(), [&](size_t i) {
+    Chunk& chunk = chunks[i];
+    chunk.tokens.reserve((chunk.end - chunk.begin) / 8);
+    Lexer lexer(input);
+    lexer.pos = chunk.begin;
+    chunk.last_end = chunk.begin;
+    while (true) {
+      Token token = lexer.getNextToken();
+      if (token.getOffset() >= chunk.end) {
+        break;
+      }
+      chunk.tokens.push_back(token);
+      chunk.last_end = lexer.pos;
+      if (token.getTokenType() == TokenType::Error) {
+        break;
+      }
+    }
+    for (const char* p = input.data() + chunk.begin, *stop = input.data() + chunk.end;
+         (p = static_cast<const char*>(memchr(p, '\n', stop - p))) != nullptr; p++) {
+      chunk.lines.push_back(static_cast<size_t>(p - input.data()) + 1);
+    }
+  });
+
+  // Fix-up, in order: keep each chunk's tokens from the first one that
+  // starts where the single-threaded lexer would have started one
+  bool failed = false;  // stopped at an Error token
+  size_t total = 0;
+  size_t last_end = 0;  // of the tokens kept so far
+  for (Chunk& chunk : chunks) {
+    chunk.first = total;
+    if (failed) {
+      continue;
+    }
+    chunk.keep = chunk.tokens.size();
+    if (last_end > chunk.begin) {
+      // A string literal ran into this chunk. Lex again from where it ended
+      // until a token starts where one of the chunk's tokens does; from
+      // there on the two agree.
+      Lexer lexer(input);
+      lexer.pos = last_end;
+      chunk.adopt = chunk.tokens.size();
+      while (!failed) {
+        Token token = lexer.getNextToken();
+        if (token.getOffset() >= chunk.end) {
+          break;
+        }
+        auto same = std::lower_bound(chunk.tokens.begin(), chunk.tokens.end(), token.getOffset(),
+                                     [](const Token& t, size_t offset) { return t.getOffset() < offset; });
+        if (same != chunk.tokens.end() && same->getOffset() == token.getOffset()) {
+          chunk.adopt = static_cast<size_t>(same - chunk.tokens.begin());
+          break;
+        }
+        chunk.relexed.push_back(token);
+        last_end = lexer.pos;
+        failed = token.getTokenType() == TokenType::Error;
+      }
+      if (failed) {
+        chunk.keep = chunk.adopt;
+      }
+    }
+    if (chunk.adopt < chunk.keep) {
+      last_end = chunk.last_end;
+      failed = chunk.tokens[chunk.keep - 1].getTokenType() == TokenType::Error;
+    }
+    total += chunk.relexed.size() + (chunk.keep - chunk.adopt);
+  }
+
+  LexedSource result;
+  result.tokens.resize(total + (failed ? 0 : 1));
+  pool.parallelFor(chunks.size(), [&](size_t i) {
+    Chunk& chunk = chunks[i];
+    auto out = std::copy(chunk.relexed.begin(), chunk.relexed.end(),
+                         result.tokens.begin() + static_cast<std::ptrdiff_t>(chunk.first));
+    std::copy(chunk.tokens.begin() + static_cast<std::ptrdiff_t>(chunk.adopt),
+              chunk.tokens.begin() + static_cast<std::ptrdiff_t>(chunk.keep), out);
+    std::vector<Token>().swap(chunk.tokens);
+  });
+  if (!failed) {
+    result.tokens.back() = Token(TokenType::EoF, "", input.size());
+  }
+  for (const Chunk& chunk : chunks) {
+    for (size_t line : chunk.lines) {
+      result.lines.addLine(line);
+    }
+  }
+  return result;
+}
@@ -1,24 +1,55 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cctype>
 #include <cstring>
 #include "Token.h"
+#include "LineIndex.h"
+
+class ThreadPool;
+
+// Every token of a source, lexed ahead of parsing.
+struct LexedSource {
+  std::vector<Token> tokens;  // ends with the EoF token or the first Error token
+  LineIndex lines;
+};
 
 class Lexer {
 public:
-  explicit Lexer(const std::string& input);
+  // The lexer does not copy the input: `input` (typically a SourceBuffer) must
+  // outlive the lexer and every token it returns. Lines are numbered from
+  // `first_line`, for input that starts partway through a file.
+  explicit Lexer(std::string_view input, int first_line = 1);
 
+  // Newlines are not tokens; they only extend lineIndex().
   Token getNextToken();
   bool hasMoreTokens() const;
 
+  // Starts of the lines lexed so far, which covers every token returned.
+  const LineIndex& lineIndex() const {
+    return lines;
+  }
+
+  SourceLocation locate(const Token& token) const {
+    return lines.locate(token.getOffset());
+  }
+
+  // Lexes `input` on `pool` in chunks of about `chunk_bytes` that start at
+  // line starts. The result is the same as a getNextToken() loop up to EoF
+  // or the first error, interned name ids aside.
+  static LexedSource lexParallel(std::string_view input, ThreadPool& pool, size_t chunk_bytes = CHUNK_BYTES);
+
+  static constexpr size_t CHUNK_BYTES = 4 << 20;
+
 private:
-  std::string input;
+  std::string_view input;
   size_t pos;
   size_t max_pos;
-  int line;
-  int col;
+  LineIndex lines;
+  const ScanKernels* scan;
 
+  Token makeToken(size_t start) const;
   void skipWhitespace();
   bool skipComments();
 };
\ No newline at end of file
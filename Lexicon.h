@@ -0,0 +1,296 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+// Reserved words, operators and delimiters of IEEE 1076, and a perfect hash
+// over them that is built entirely at compile time. Classifying a lexeme is a
+// single hash of its (case-folded) spelling plus one comparison; the parser
+// then works with the enum ids instead of strings.
+
+enum class Keyword : uint8_t {
+  None,
+  Access, After, Alias, All, Architecture, Array, Assert, Attribute,
+  Begin, Block, Body, Buffer, Bus, Case, Component, Configuration,
+  Constant, Disconnect, Downto, Else, Elsif, End, Entity, Exit,
+  File, For, Function, Generate, Generic, Group, Guarded, If,
+  Impure, In, Inertial, Inout, Is, Label, Library, Linkage,
+  Literal, Loop, Map, Mod, Nand, New, Next, Nor,
+  Not, Null, Of, On, Open, Or, Others, Out,
+  Package, Port, Postponed, Procedure, Process, Pure, Range, Record,
+  Reject, Rem, Report, Return, Rol, Ror, Select, Severity,
+  Signal, Shared, Sla, Sll, Sra, Srl, Subtype, Then,
+  To, Transport, Type, Unaffected, Units, Until, Use, Variable,
+  Wait, When, While, With, Xnor, Xor,
+};
+
+enum class Operator : uint8_t {
+  None,
+  Plus, Minus, Multiply, Divide, Concat, Equal, NotEqual, Less,
+  LessEqual, Greater, GreaterEqual, Arrow, Power, Assign, Mod, Rem,
+  And, Or, Nand, Nor, Xor, Xnor, Not, Rol,
+  Ror, Sla, Sll, Sra, Srl, In, Abs, Condition,
+};
+
+enum class Symbol : uint8_t {
+  None,
+  LeftParen, RightParen, Comma, Dot, Colon, Semicolon, Tick, LeftBracket,
+  RightBracket,
+};
+
+struct Reserved {
+  std::string_view text;
+  Keyword  keyword;
+  Operator op;
+  Symbol   symbol;
+};
+
+// Words such as "mod" or "not" are both keywords and operators, so an entry
+// may carry both ids. Token classification prefers keyword, then operator,
+// then symbol, exactly as the old set probes did.
+static constexpr Reserved IEEE_1076_VHDL_RESERVED[] = {
+  { "access",        Keyword::Access,           Operator::None,          Symbol::None },
+  { "after",         Keyword::After,            Operator::None,          Symbol::None },
+  { "alias",         Keyword::Alias,            Operator::None,          Symbol::None },
+  { "all",           Keyword::All,              Operator::None,          Symbol::None },
+  { "architecture",  Keyword::Architecture,     Operator::None,          Symbol::None },
+  { "array",         Keyword::Array,            Operator::None,          Symbol::None },
+  { "assert",        Keyword::Assert,           Operator::None,          Symbol::None },
+  { "attribute",     Keyword::Attribute,        Operator::None,          Symbol::None },
+  { "begin",         Keyword::Begin,            Operator::None,          Symbol::None },
+  { "block",         Keyword::Block,            Operator::None,          Symbol::None },
+  { "body",          Keyword::Body,             Operator::None,          Symbol::None },
+  { "buffer",        Keyword::Buffer,           Operator::None,          Symbol::None },
+  { "bus",           Keyword::Bus,              Operator::None,          Symbol::None },
+  { "case",          Keyword::Case,             Operator::None,          Symbol::None },
+  { "component",     Keyword::Component,        Operator::None,          Symbol::None },
+  { "configuration", Keyword::Configuration,    Operator::None,          Symbol::None },
+  { "constant",      Keyword::Constant,         Operator::None,          Symbol::None },
+  { "disconnect",    Keyword::Disconnect,       Operator::None,          Symbol::None },
+  { "downto",        Keyword::Downto,           Operator::None,          Symbol::None },
+  { "else",          Keyword::Else,             Operator::None,          Symbol::None },
+  { "elsif",         Keyword::Elsif,            Operator::None,          Symbol::None },
+  { "end",           Keyword::End,              Operator::None,          Symbol::None },
+  { "entity",        Keyword::Entity,           Operator::None,          Symbol::None },
+  { "exit",          Keyword::Exit,             Operator::None,          Symbol::None },
+  { "file",          Keyword::File,             Operator::None,          Symbol::None },
+  { "for",           Keyword::For,              Operator::None,          Symbol::None },
+  { "function",      Keyword::Function,         Operator::None,          Symbol::None },
+  { "generate",      Keyword::Generate,         Operator::None,          Symbol::None },
+  { "generic",       Keyword::Generic,          Operator::None,          Symbol::None },
+  { "group",         Keyword::Group,            Operator::None,          Symbol::None },
+  { "guarded",       Keyword::Guarded,          Operator::None,          Symbol::None },
+  { "if",            Keyword::If,               Operator::None,          Symbol::None },
+  { "impure",        Keyword::Impure,           Operator::None,          Symbol::None },
+  { "in",            Keyword::In,               Operator::In,            Symbol::None },
+  { "inertial",      Keyword::Inertial,         Operator::None,          Symbol::None },
+  { "inout",         Keyword::Inout,            Operator::None,          Symbol::None },
+  { "is",            Keyword::Is,               Operator::None,          Symbol::None },
+  { "label",         Keyword::Label,            Operator::None,          Symbol::None },
+  { "library",       Keyword::Library,          Operator::None,          Symbol::None },
+  { "linkage",       Keyword::Linkage,          Operator::None,          Symbol::None },
+  { "literal",       Keyword::Literal,          Operator::None,          Symbol::None },
+  { "loop",          Keyword::Loop,             Operator::None,          Symbol::None },
+  { "map",           Keyword::Map,              Operator::None,          Symbol::None },
+  { "mod",           Keyword::Mod,              Operator::Mod,           Symbol::None },
+  { "nand",          Keyword::Nand,             Operator::Nand,          Symbol::None },
+  { "new",           Keyword::New,              Operator::None,          Symbol::None },
+  { "next",          Keyword::Next,             Operator::None,          Symbol::None },
+  { "nor",           Keyword::Nor,              Operator::Nor,           Symbol::None },
+  { "not",           Keyword::Not,              Operator::Not,           Symbol::None },
+  { "null",          Keyword::Null,             Operator::None,          Symbol::None },
+  { "of",            Keyword::Of,               Operator::None,          Symbol::None },
+  { "on",            Keyword::On,               Operator::None,          Symbol::None },
+  { "open",          Keyword::Open,             Operator::None,          Symbol::None },
+  { "or",            Keyword::Or,               Operator::Or,            Symbol::None },
+  { "others",        Keyword::Others,           Operator::None,          Symbol::None },
+  { "out",           Keyword::Out,              Operator::None,          Symbol::None },
+  { "package",       Keyword::Package,          Operator::None,          Symbol::None },
+  { "port",          Keyword::Port,             Operator::None,          Symbol::None },
+  { "postponed",     Keyword::Postponed,        Operator::None,          Symbol::None },
+  { "procedure",     Keyword::Procedure,        Operator::None,          Symbol::None },
+  { "process",       Keyword::Process,          Operator::None,          Symbol::None },
+  { "pure",          Keyword::Pure,             Operator::None,          Symbol::None },
+  { "range",         Keyword::Range,            Operator::None,          Symbol::None },
+  { "record",        Keyword::Record,           Operator::None,          Symbol::None },
+  { "reject",        Keyword::Reject,           Operator::None,          Symbol::None },
+  { "rem",           Keyword::Rem,              Operator::Rem,           Symbol::None },
+  { "report",        Keyword::Report,           Operator::None,          Symbol::None },
+  { "return",        Keyword::Return,           Operator::None,          Symbol::None },
+  { "rol",           Keyword::Rol,              Operator::Rol,           Symbol::None },
+  { "ror",           Keyword::Ror,              Operator::Ror,           Symbol::None },
+  { "select",        Keyword::Select,           Operator::None,          Symbol::None },
+  { "severity",      Keyword::Severity,         Operator::None,          Symbol::None },
+  { "signal",        Keyword::Signal,           Operator::None,          Symbol::None },
+  { "shared",        Keyword::Shared,           Operator::None,          Symbol::None },
+  { "sla",           Keyword::Sla,              Operator::Sla,           Symbol::None },
+  { "sll",           Keyword::Sll,              Operator::Sll,           Symbol::None },
+  { "sra",           Keyword::Sra,              Operator::Sra,           Symbol::None },
+  { "srl",           Keyword::Srl,              Operator::Srl,           Symbol::None },
+  { "subtype",       Keyword::Subtype,          Operator::None,          Symbol::None },
+  { "then",          Keyword::Then,             Operator::None,          Symbol::None },
+  { "to",            Keyword::To,               Operator::None,          Symbol::None },
+  { "transport",     Keyword::Transport,        Operator::None,          Symbol::None },
+  { "type",          Keyword::Type,             Operator::None,          Symbol::None },
+  { "unaffected",    Keyword::Unaffected,       Operator::None,          Symbol::None },
+  { "units",         Keyword::Units,            Operator::None,          Symbol::None },
+  { "until",         Keyword::Until,            Operator::None,          Symbol::None },
+  { "use",           Keyword::Use,              Operator::None,          Symbol::None },
+  { "variable",      Keyword::Variable,         Operator::None,          Symbol::None },
+  { "wait",          Keyword::Wait,             Operator::None,          Symbol::None },
+  { "when",          Keyword::When,             Operator::None,          Symbol::None },
+  { "while",         Keyword::While,            Operator::None,          Symbol::None },
+  { "with",          Keyword::With,             Operator::None,          Symbol::None },
+  { "xnor",          Keyword::Xnor,             Operator::Xnor,          Symbol::None },
+  { "xor",           Keyword::Xor,              Operator::Xor,           Symbol::None },
+  { "+",             Keyword::None,             Operator::Plus,          Symbol::None },
+  { "-",             Keyword::None,             Operator::Minus,         Symbol::None },
+  { "*",             Keyword::None,             Operator::Multiply,      Symbol::None },
+  { "/",             Keyword::None,             Operator::Divide,        Symbol::None },
+  { "&",             Keyword::None,             Operator::Concat,        Symbol::None },
+  { "=",             Keyword::None,             Operator::Equal,         Symbol::None },
+  { "/=",            Keyword::None,             Operator::NotEqual,      Symbol::None },
+  { "<",             Keyword::None,             Operator::Less,          Symbol::None },
+  { "<=",            Keyword::None,             Operator::LessEqual,     Symbol::None },
+  { ">",             Keyword::None,             Operator::Greater,       Symbol::None },
+  { ">=",            Keyword::None,             Operator::GreaterEqual,  Symbol::None },
+  { "=>",            Keyword::None,             Operator::Arrow,         Symbol::None },
+  { "**",            Keyword::None,             Operator::Power,         Symbol::None },
+  { ":=",            Keyword::None,             Operator::Assign,        Symbol::None },
+  { "and",           Keyword::None,             Operator::And,           Symbol::None },
+  { "abs",           Keyword::None,             Operator::Abs,           Symbol::None },
+  { "??",            Keyword::None,             Operator::Condition,     Symbol::None },
+  { "(",             Keyword::None,             Operator::None,          Symbol::LeftParen },
+  { ")",             Keyword::None,             Operator::None,          Symbol::RightParen },
+  { ",",             Keyword::None,             Operator::None,          Symbol::Comma },
+  { ".",             Keyword::None,             Operator::None,          Symbol::Dot },
+  { ":",             Keyword::None,             Operator::None,          Symbol::Colon },
+  { ";",             Keyword::None,             Operator::None,          Symbol::Semicolon },
+  { "'",             Keyword::None,             Operator::None,          Symbol::Tick },
+  { "[",             Keyword::None,             Operator::None,          Symbol::LeftBracket },
+  { "]",             Keyword::None,             Operator::None,          Symbol::RightBracket },
+};
+
+static constexpr size_t RESERVED_COUNT = sizeof(IEEE_1076_VHDL_RESERVED) / sizeof(Reserved);
+
+// Longest entry in the table ("configuration").
+static constexpr size_t MAX_RESERVED_LENGTH = 13;
+
+static constexpr size_t RESERVED_BUCKETS = 64;
+static constexpr size_t RESERVED_SLOTS   = 256;
+
+constexpr char lowerAscii(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// FNV-1a over the case-folded spelling.
+constexpr uint64_t reservedHash(std::string_view text) {
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : text) {
+    hash ^= static_cast<unsigned char>(lowerAscii(c));
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+constexpr size_t reservedSlot(uint64_t hash, uint16_t displacement) {
+  uint64_t x = hash ^ (displacement * 0x9E3779B97F4A7C15ull);
+  x ^= x >> 31;
+  x *= 0xBF58476D1CE4E5B9ull;
+  x ^= x >> 29;
+  return static_cast<size_t>(x % RESERVED_SLOTS);
+}
+
+// Hash-and-displace: every entry is first hashed into a bucket, then each
+// bucket (largest first) searches for a displacement that moves all of its
+// entries into free slots. The result is collision-free by construction.
+struct ReservedTable {
+  std::array<uint16_t, RESERVED_BUCKETS> displacement{};
+  std::array<uint8_t, RESERVED_SLOTS> slot{};  // entry index + 1, 0 when empty
+  bool complete = false;
+};
+
+constexpr ReservedTable buildReservedTable() {
+  ReservedTable table{};
+  std::array<size_t, RESERVED_BUCKETS> bucket_size{};
+  size_t largest = 0;
+  for (size_t i = 0; i < RESERVED_COUNT; i++) {
+    size_t b = reservedHash(IEEE_1076_VHDL_RESERVED[i].text) % RESERVED_BUCKETS;
+    bucket_size[b]++;
+    largest = bucket_size[b] > largest ? bucket_size[b] : largest;
+  }
+
+  for (size_t size = largest; size > 0; size--) {
+    for (size_t b = 0; b < RESERVED_BUCKETS; b++) {
+      if (bucket_size[b] != size) continue;
+
+      bool placed = false;
+      for (uint32_t d = 0; d <= 0xFFFF && !placed; d++) {
+        std::array<size_t, RESERVED_SLOTS> claimed{};
+        size_t claimed_count = 0;
+        bool fits = true;
+        for (size_t i = 0; i < RESERVED_COUNT && fits; i++) {
+          uint64_t hash = reservedHash(IEEE_1076_VHDL_RESERVED[i].text);
+          if (hash % RESERVED_BUCKETS != b) continue;
+          size_t s = reservedSlot(hash, static_cast<uint16_t>(d));
+          if (table.slot[s] != 0) fits = false;
+          for (size_t c = 0; c < claimed_count && fits; c++) {
+            if (claimed[c] == s) fits = false;
+          }
+          claimed[claimed_count++] = s;
+        }
+        if (!fits) continue;
+
+        size_t next = 0;
+        for (size_t i = 0; i < RESERVED_COUNT; i++) {
+          if (reservedHash(IEEE_1076_VHDL_RESERVED[i].text) % RESERVED_BUCKETS != b) continue;
+          table.slot[claimed[next++]] = static_cast<uint8_t>(i + 1);
+        }
+        table.displacement[b] = static_cast<uint16_t>(d);
+        placed = true;
+      }
+      if (!placed) return table;
+    }
+  }
+  table.complete = true;
+  return table;
+}
+
+static constexpr ReservedTable RESERVED_TABLE = buildReservedTable();
+static_assert(RESERVED_TABLE.complete, "no perfect hash found for the reserved word table");
+static_assert(RESERVED_COUNT < 255, "slot indices are stored in a uint8_t");
+
+// Returns the table entry for `text` (any letter case), or nullptr if it is not
+// a reserved word, operator or delimiter.
+constexpr const Reserved* lookupReserved(std::string_view text) {
+  if (text.empty() || text.size() > MAX_RESERVED_LENGTH) return nullptr;
+  uint64_t hash = reservedHash(text);
+  uint8_t index = RESERVED_TABLE.slot[reservedSlot(hash, RESERVED_TABLE.displacement[hash % RESERVED_BUCKETS])];
+  if (index == 0) return nullptr;
+
+  const Reserved& entry = IEEE_1076_VHDL_RESERVED[index - 1];
+  if (entry.text.size() != text.size()) return nullptr;
+  for (size_t i = 0; i < text.size(); i++) {
+    if (lowerAscii(text[i]) != entry.text[i]) return nullptr;
+  }
+  return &entry;
+}
+
+static_assert(lookupReserved("ENTITY")->keyword == Keyword::Entity, "reserved lookup is case-insensitive");
+static_assert(lookupReserved("bit_vector") == nullptr, "identifiers are not reserved");
+
+// Lowercase spelling of a keyword, for printing.
+constexpr std::string_view keywordSpelling(Keyword keyword) {
+  for (const Reserved& entry : IEEE_1076_VHDL_RESERVED) {
+    if (entry.keyword == keyword && keyword != Keyword::None) return entry.text;
+  }
+  return std::string_view();
+}
+
+// Spelling of an operator, for printing.
+constexpr std::string_view operatorSpelling(Operator op) {
+  for (const Reserved& entry : IEEE_1076_VHDL_RESERVED) {
+    if (entry.op == op && op != Operator::None) return entry.text;
+  }
+  return std::string_view();
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Line and column of a position in the source; columns count bytes from 0.
+struct SourceLocation {
+  int line = 0;
+  int col  = 0;
+};
+
+// Byte offsets at which the lines of a source start. The lexer appends one
+// entry per newline it passes, so tokens need to carry only their offset;
+// the line and column are looked up by binary search when a diagnostic or a
+// token listing asks for them.
+class LineIndex {
+public:
+  // The line starting at offset 0 is numbered `first_line`.
+  explicit LineIndex(int first_line = 1) : first_line(first_line) {
+    starts.push_back(0);
+  }
+
+  // Records that a line starts at `offset`, after every earlier line.
+  void addLine(size_t offset) {
+    starts.push_back(offset);
+  }
+
+  SourceLocation locate(size_t offset) const {
+    size_t index = static_cast<size_t>(std::upper_bound(starts.begin(), starts.end(), offset) - starts.begin()) - 1;
+    return SourceLocation{first_line + static_cast<int>(index), static_cast<int>(offset - starts[index])};
+  }
+
+  size_t lineCount() const {
+    return starts.size();
+  }
+
+private:
+  std::vector<size_t> starts;
+  int first_line;
+};
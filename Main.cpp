@@ -1,62 +1,738 @@
-#include <iostream>
+#include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <iostream>
+#include <memory>
 #include <sstream>
+#include <string>
+#include <thread>
 #include <vector>
+#include "SourceBuffer.h"
 #include "Lexer.h"
 #include "Parser.h"
+#include "DesignLibrary.h"
+#include "ThreadPool.h"
+#include "DesignCache.h"
+#include "Elaborate.h"
+#include "Native.h"
+#include "Simulator.h"
+#include "Stimulus.h"
+#include "Batch.h"
+#include "Waveform.h"
+#include "Profile.h"
+#include "Workspace.h"
 
-int main(int argc, char* argv[]) {
-  if (argc < 2) {
-    std::cerr << "Usage: " << argv[0] << " <input_file.vhd>\n";
+// Writes the profile as a table on stdout (`--profile table`) or as a Chrome
+// trace to a file.
+static bool reportProfile(const Profiler& profiler, const std::string& target) {
+  if (target == "table") {
+    std::cout << "\n--- Profile ---\n";
+    profiler.writeSummary(std::cout);
+    return true;
+  }
+  std::ofstream file(target);
+  profiler.writeChromeTrace(file);
+  if (!file) {
+    std::cerr << "Error: cannot write " << target << "\n";
+    return false;
+  }
+  std::cout << "Profile written to " << target << "\n";
+  return true;
+}
+
+// Statistics and process times of one or more finished simulations, summed
+// until they are handed to the profiler.
+struct SimulationProfile {
+  SimulationStats totals;
+  std::vector<ProcessProfile> processes;
+
+  void add(const Simulator& simulator) {
+    const SimulationStats& stats = simulator.stats();
+    totals.transactions += stats.transactions;
+    totals.events       += stats.events;
+    totals.delta_cycles += stats.delta_cycles;
+    totals.process_runs += stats.process_runs;
+    totals.cycles       += stats.cycles;
+    totals.max_deltas   = std::max(totals.max_deltas, stats.max_deltas);
+    totals.peak_pending = std::max(totals.peak_pending, stats.peak_pending);
+    const std::vector<ProcessProfile>& runs = simulator.processProfiles();
+    processes.resize(runs.size());
+    for (size_t p = 0; p < runs.size(); p++) {
+      processes[p].runs        += runs[p].runs;
+      processes[p].nanoseconds += runs[p].nanoseconds;
+    }
+  }
+
+  void report(Profiler& profiler, const Design& design) const {
+    profiler.count("transactions", totals.transactions);
+    profiler.count("events", totals.events);
+    profiler.count("delta cycles", totals.delta_cycles);
+    profiler.count("cycles", totals.cycles);
+    profiler.count("process runs", totals.process_runs);
+    profiler.setCount("max deltas at one time", totals.max_deltas);
+    profiler.setCount("peak pending transactions", totals.peak_pending);
+    for (uint32_t p = 0; p < processes.size(); p++) {
+      profiler.addProcess(design.processName(p), processes[p].runs, processes[p].nanoseconds);
+    }
+  }
+};
+
+// Lexes and parses every file of a project in parallel and reports the merged library
+static int runProject(const std::string& project, size_t jobs, const std::string& cache_dir,
+                      const std::string& profile, bool all_errors) {
+  std::vector<std::string> paths;
+  try {
+    paths = DesignLibrary::collectSources(project);
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << "\n";
     return 1;
   }
 
-  std::ifstream file(argv[1]);
-  if (!file.is_open()) {
-    std::cerr << "Error: Could not open file " << argv[1] << "\n";
+  std::unique_ptr<Profiler> profiler;
+  if (!profile.empty()) {
+    profiler.reset(new Profiler);
+    Profiler::install(profiler.get());
+  }
+  auto start = std::chrono::steady_clock::now();
+  ThreadPool pool(jobs);
+  std::unique_ptr<DesignCache> cache;
+  if (!cache_dir.empty()) {
+    cache = std::make_unique<DesignCache>(cache_dir);
+  }
+  DesignLibrary library = [&] {
+    ProfileScope scope("load project");
+    return DesignLibrary::load(paths, pool, cache.get(), all_errors);
+  }();
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  Profiler::install(nullptr);
+
+  std::cout << "\n--- Project ---\n";
+  std::cout << paths.size() << " files parsed in " << elapsed.count() << " ms on "
+            << pool.size() << " threads";
+  if (cache) {
+    std::cout << " (" << library.getCacheHits() << " loaded from cache)";
+  }
+  std::cout << "\n";
+  for (NameId name : library.getEntityNames()) {
+    std::cout << "entity " << NameTable::global().spelling(name);
+    for (const ArchitectureDeclaration* archtc : library.architecturesOf(name)) {
+      std::cout << ", architecture " << NameTable::global().spelling(archtc->identifier);
+    }
+    std::cout << "\n";
+  }
+  for (const std::string& error : library.getErrors()) {
+    std::cerr << "Error: " << error << "\n";
+  }
+  if (profiler) {
+    profiler->count("files", paths.size());
+    profiler->count("files from cache", library.getCacheHits());
+    if (!reportProfile(*profiler, profile)) {
+      return 1;
+    }
+  }
+  return library.getErrors().empty() ? 0 : 1;
+}
+
+// One `--drive NAME=VALUE[@TIME]` option
+struct DriveOption {
+  std::string name;
+  std::string value;
+  SimTime time = 0;
+};
+
+struct SimulationOptions {
+  bool simulate = false;
+  SimTime until = 0;
+  std::vector<DriveOption> drives;
+  std::string native_dir;  // build and cache native code here; empty for bytecode
+  size_t jobs = 1;         // threads lexing large files and evaluating processes; 0 = all cores
+  std::string mode = "auto";  // auto, cycle or event
+  std::string wave_path;      // waveform file; empty for none
+  std::vector<std::string> trace_patterns;
+  std::string stimulus_path;  // streams to run instead of the drives
+  bool batch = false;         // run the streams bit-sliced, 64 at a time
+  std::string responses_path; // sampled outputs; empty for stdout
+  std::string profile;        // "table", a Chrome trace file, or empty for none
+  bool all_errors = false;    // report every syntax error, not just the first (--errors all)
+
+  // Output stages written to stdout (--emit)
+  bool emit_tokens  = true;
+  bool emit_ast     = true;
+  bool emit_results = true;
+};
+
+// Takes the place of std::cout for stages that are not emitted; with no
+// buffer attached, every write is dropped before any formatting.
+static std::ostream quiet(nullptr);
+
+static std::ostream& resultStream(const SimulationOptions& options) {
+  return options.emit_results ? std::cout : quiet;
+}
+
+// `--emit tokens,ast,results`, any subset of them, or `none`
+static void parseEmit(SimulationOptions& options, const std::string& list) {
+  options.emit_tokens = options.emit_ast = options.emit_results = false;
+  if (list == "none") {
+    return;
+  }
+  for (size_t start = 0; start <= list.size();) {
+    size_t comma = std::min(list.find(',', start), list.size());
+    std::string stage = list.substr(start, comma - start);
+    if (stage == "tokens") {
+      options.emit_tokens = true;
+    } else if (stage == "ast") {
+      options.emit_ast = true;
+    } else if (stage == "results") {
+      options.emit_results = true;
+    } else {
+      throw std::runtime_error("--emit expects tokens, ast, results or none, not '" + stage + "'");
+    }
+    start = comma + 1;
+  }
+}
+
+// `--errors first` stops at the first syntax error; `all` reports every one
+static bool parseErrors(const std::string& value, bool& all_errors) {
+  if (value != "first" && value != "all") {
+    return false;
+  }
+  all_errors = value == "all";
+  return true;
+}
+
+// `--jobs N`; 0 means one thread per core. More than a few threads per core
+// only adds queues and contention, so larger counts are refused.
+static size_t parseJobs(const std::string& value) {
+  size_t limit = 4 * std::max(1u, std::thread::hardware_concurrency());
+  if (!value.empty() && asciiDigit(value[0])) {
+    try {
+      size_t used = 0;
+      unsigned long jobs = std::stoul(value, &used);
+      if (used == value.size() && jobs <= limit) {
+        return jobs;
+      }
+    } catch (const std::logic_error&) {
+    }
+  }
+  throw std::runtime_error("--jobs expects a number from 0 to " + std::to_string(limit));
+}
+
+// Runs every stream of the stimulus file, one at a time or in lockstep
+// batches, and writes the outputs sampled at each row.
+static void runStimulus(const Design& design, const SimulationOptions& options, const NativeModule* native,
+                        ThreadPool* pool, const CyclePlan& plan, bool cycle_based) {
+  std::ostream& out = resultStream(options);
+  Stimulus stimulus = [&] {
+    ProfileScope scope("load stimulus");
+    return Stimulus::load(design, options.stimulus_path);
+  }();
+  std::vector<uint32_t> outputs = outputPorts(design);
+
+  Profiler* profiler = Profiler::current();
+  SimulationProfile profile;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<StreamResponses> responses;
+  if (options.batch) {
+    ProfileScope scope("simulate batches");
+    if (!cycle_based) {
+      throw std::runtime_error("batch simulation needs a cycle-based design" +
+                               (plan.reason.empty() ? std::string() : ": " + plan.reason));
+    }
+    responses = simulateBatch(design, plan, stimulus, outputs, pool);
+  } else {
+    ProfileScope scope("simulate streams");
+    for (const StimulusStream& stream : stimulus.streams) {
+      Simulator simulator(design, native, pool);
+      if (cycle_based) {
+        simulator.useCyclePlan(plan);
+      }
+      if (profiler) {
+        simulator.profileProcesses();
+      }
+      responses.push_back(simulateStream(simulator, stream, outputs));
+      profile.add(simulator);
+    }
+  }
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  if (profiler) {
+    profiler->count("stimulus streams", stimulus.streams.size());
+    if (!options.batch) {
+      profile.report(*profiler, design);
+    }
+  }
+
+  size_t streams = stimulus.streams.size();
+  out << streams << " stimulus streams simulated in " << elapsed.count() << " ms";
+  if (options.batch) {
+    out << " (" << (streams + BATCH_LANES - 1) / BATCH_LANES << " batches of up to " << BATCH_LANES << " lanes)";
+  }
+  out << "\n";
+  if (options.responses_path.empty()) {
+    writeResponses(out, design, stimulus, outputs, responses);
+    return;
+  }
+  std::ofstream file(options.responses_path);
+  writeResponses(file, design, stimulus, outputs, responses);
+  if (!file) {
+    throw std::runtime_error("cannot write " + options.responses_path);
+  }
+  out << "Responses written to " << options.responses_path << "\n";
+}
+
+// Elaborates the file's last architecture with its entity, applies the drives
+// and simulates until `options.until`, then reports every signal's final value.
+static int runSimulation(const VhdlFile& file, const SimulationOptions& options) {
+  if (file.entities.empty() || file.architectures.empty()) {
+    std::cerr << "Simulation error: the file needs an entity and an architecture\n";
+    return 1;
+  }
+  const ArchitectureDeclaration* archtc = file.architectures.back().declaration;
+  const EntityDeclaration* entity = file.findEntity(archtc->entity_name);
+  if (!entity) {
+    std::cerr << "Simulation error: architecture " << NameTable::global().str(archtc->identifier)
+              << " is of entity " << NameTable::global().str(archtc->entity_name)
+              << ", which is not in the file\n";
     return 1;
   }
 
-  std::stringstream buffer;
-  buffer << file.rdbuf();  // read entire file into buffer
-  std::string input = buffer.str();
+  std::ostream& out = resultStream(options);
+  out << "\n--- Simulation ---\n";
+  try {
+    Profiler* profiler = Profiler::current();
+    Design design = [&] {
+      ProfileScope scope("elaborate");
+      return Design::elaborate(*entity, *archtc);
+    }();
+    if (profiler) {
+      profiler->setCount("signals", design.signals.size());
+      profiler->setCount("processes", design.processes.size());
+    }
+    std::unique_ptr<NativeModule> native;
+    if (!options.native_dir.empty()) {
+      ProfileScope scope("native build");
+      native = NativeModule::build(design, options.native_dir);
+      out << "Native code " << (native->fromCache() ? "loaded from cache" : "built") << "\n";
+    }
+    std::unique_ptr<ThreadPool> pool;
+    if (options.jobs != 1) {
+      pool.reset(new ThreadPool(options.jobs));
+    }
+    CyclePlan plan;
+    bool cycle_based = false;
+    if (options.mode != "event") {
+      ProfileScope scope("levelize");
+      plan = CyclePlan::analyze(design);
+      if (plan.usable) {
+        size_t sequential = std::count(plan.roles.begin(), plan.roles.end(), ProcessRole::Sequential);
+        out << "Cycle-based simulation: " << sequential << " sequential processes, "
+                  << plan.order.size() << " combinational in " << plan.levels() << " levels\n";
+        cycle_based = true;
+      } else if (options.mode == "cycle") {
+        throw std::runtime_error("cycle-based simulation is not possible: " + plan.reason);
+      } else {
+        out << "Event-driven simulation: " << plan.reason << "\n";
+      }
+    }
+    if (!options.stimulus_path.empty()) {
+      runStimulus(design, options, native.get(), pool.get(), plan, cycle_based);
+      return 0;
+    }
+
+    Simulator simulator(design, native.get(), pool.get());
+    if (cycle_based) {
+      simulator.useCyclePlan(plan);
+    }
+    if (profiler) {
+      simulator.profileProcesses();
+    }
+    std::unique_ptr<WaveformWriter> waveform;
+    if (!options.wave_path.empty()) {
+      waveform.reset(new WaveformWriter(design, options.wave_path, options.trace_patterns));
+      simulator.trace(*waveform);
+      out << "Tracing " << waveform->signals().size() << " signals to " << options.wave_path << "\n";
+    }
+    for (const DriveOption& drive : options.drives) {
+      int signal = design.findSignal(NameTable::global().intern(drive.name));
+      if (signal < 0) {
+        throw std::runtime_error("no signal named '" + drive.name + "' to drive");
+      }
+      simulator.drive(static_cast<uint32_t>(signal), parseValue(design.signals[signal].type, drive.value), drive.time);
+    }
+    {
+      ProfileScope scope("simulate");
+      simulator.run(options.until);
+    }
+    if (waveform) {
+      ProfileScope scope("close waveform");
+      waveform->close(simulator.now());
+    }
+    if (profiler) {
+      SimulationProfile profile;
+      profile.add(simulator);
+      profile.report(*profiler, design);
+    }
 
+    const SimulationStats& stats = simulator.stats();
+    out << "Simulated " << formatTime(simulator.now()) << ": ";
+    if (cycle_based) {
+      out << stats.cycles << " cycles, " << stats.events << " events, " << stats.transactions
+                << " transactions, " << stats.process_runs << " process runs\n";
+    } else {
+      out << stats.events << " events, " << stats.transactions << " transactions, "
+                << stats.delta_cycles << " delta cycles, " << stats.process_runs << " process runs\n";
+    }
+    for (size_t i = 0; i < design.signals.size(); i++) {
+      out << NameTable::global().spelling(design.signals[i].name) << " = "
+                << simulator.value(static_cast<uint32_t>(i)).toString() << "\n";
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Simulation error: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
+
+// Keeps files open for an editor or lint service and answers commands on
+// stdin, one per line:
+//
+//   open PATH
+//   edit FIRST_LINE REMOVED INSERTED PATH   followed by INSERTED lines of text
+//   diagnostics PATH
+//   close PATH
+//   quit
+//
+// A reply lists the file's diagnostics as `PATH:LINE:COL: message` lines and
+// ends with a line starting with "ok", or is a single "error ..." line.
+static int runServer() {
+  Workspace workspace;
+  std::string request;
+  while (std::getline(std::cin, request)) {
+    std::istringstream command(request);
+    std::string verb;
+    if (!(command >> verb)) {
+      continue;
+    }
+    if (verb == "quit") {
+      break;
+    }
+    auto pathArgument = [&command] {
+      std::string path;
+      std::getline(command >> std::ws, path);
+      if (path.empty()) {
+        throw std::runtime_error("missing file path");
+      }
+      return path;
+    };
 
-  // Lexing
-  std::cout << "\n--- Lexing ---\n";
+    try {
+      auto start = std::chrono::steady_clock::now();
+      std::string path;
+      bool changed = true;
+      Workspace::EditResult result;
+      if (verb == "open") {
+        path = pathArgument();
+        result = workspace.open(path);
+      } else if (verb == "edit") {
+        size_t first = 0, removed = 0, inserted = 0;
+        if (!(command >> first >> removed >> inserted)) {
+          throw std::runtime_error("edit expects FIRST_LINE REMOVED INSERTED PATH");
+        }
+        path = pathArgument();
+        std::vector<std::string> lines(inserted);
+        for (std::string& line : lines) {
+          if (!std::getline(std::cin, line)) {
+            throw std::runtime_error("input ended inside an edit");
+          }
+        }
+        result = workspace.edit(path, first, removed, lines);
+      } else if (verb == "diagnostics") {
+        path = pathArgument();
+        changed = false;
+      } else if (verb == "close") {
+        path = pathArgument();
+        if (!workspace.close(path)) {
+          throw std::runtime_error(path + " is not open");
+        }
+        std::cout << "ok" << std::endl;
+        continue;
+      } else {
+        throw std::runtime_error("unknown command '" + verb + "'");
+      }
 
-  std::vector<Token> tokens;
-  Lexer lexer(input);
+      std::vector<Diagnostic> diagnostics = workspace.diagnostics(path);
+      std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+      for (const Diagnostic& diagnostic : diagnostics) {
+        std::cout << path << ":" << diagnostic.line << ":" << diagnostic.col << ": " << diagnostic.message << "\n";
+      }
+      std::cout << "ok " << diagnostics.size() << " diagnostics, " << workspace.lineCount(path) << " lines";
+      if (changed) {
+        std::cout << ", lexed " << result.relexed_lines << " lines and parsed " << result.reparsed_units
+                  << " units in " << static_cast<long long>(elapsed.count()) << " us";
+      }
+      std::cout << std::endl;
+    } catch (const std::exception& e) {
+      std::cout << "error " << e.what() << std::endl;
+    }
+  }
+  return 0;
+}
 
-  int tokens_length = 0;
-  while(lexer.hasMoreTokens()) {
-    Token token = lexer.getNextToken();
-    if (token.getTokenType() == TokenType::Error) {
-      std::cout << token.getValue() << ", line: "<< token.getLine() << " ," <<token.getCol() <<'\n';
-      return -1;
+// Prints the value of every signal in a binary waveform file at `time`
+static int readWaveform(const std::string& path, const char* time) {
+  try {
+    std::unique_ptr<WaveformReader> reader = WaveformReader::open(path);
+    SimTime at = time ? static_cast<SimTime>(parseTime(time)) : reader->endTime();
+    std::cout << reader->signals().size() << " signals in " << reader->blockCount() << " blocks, ending at "
+              << formatTime(reader->endTime()) << "\n";
+    std::cout << "Values at " << formatTime(at) << ":\n";
+    std::vector<Value> values = reader->valuesAt(at);
+    for (size_t i = 0; i < values.size(); i++) {
+      std::cout << reader->signals()[i].name << " = " << values[i].toString() << "\n";
     }
-    tokens.push_back(token);
-    tokens_length++;
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
   }
-  Token eof_tk = lexer.getNextToken();
-  tokens.push_back(eof_tk);
-  tokens_length++;
+  return 0;
+}
+
+// Files from this size on are lexed in chunks on the --jobs threads.
+static constexpr size_t PARALLEL_LEX_BYTES = 16 << 20;
 
-  for (int i = 0; i < tokens_length; i++) {
-    std::cout << tokens.at(i).toDebugString() << "\n";
+// Prints the tokens and the AST of one file, then simulates it when asked.
+static int runFile(const char* path, const SimulationOptions& options) {
+  // Tokens are views into this buffer, so it has to stay alive until parsing is done
+  SourceBuffer source;
+  if (!source.open(path)) {
+    std::cerr << "Error: Could not open file " << path << "\n";
+    return 1;
   }
 
-  // Parsing
-  std::cout << "\n--- Parsing ---\n";
+
+  // Lexing -- a pass of its own only to list the tokens; the parser lexes as it goes
+  if (options.emit_tokens) {
+    std::cout << "\n--- Lexing ---\n";
+    ProfileScope scope("lex and print tokens");
+    Lexer lexer(source.view());
+    uint64_t count = 0;
+    while (true) {
+      Token token = lexer.getNextToken();
+      SourceLocation location = lexer.locate(token);
+      if (token.getTokenType() == TokenType::Error) {
+        std::cout << token.getValue() << ", line: "<< location.line << " ," << location.col <<'\n';
+        return -1;
+      }
+      token.writeDebug(std::cout, location);
+      std::cout << '\n';
+      if (token.getTokenType() == TokenType::EoF) {
+        break;
+      }
+      count++;
+    }
+    if (Profiler* profiler = Profiler::current()) {
+      profiler->count("tokens", count);
+    }
+  }
+  if (Profiler* profiler = Profiler::current()) {
+    profiler->count("source bytes", source.view().size());
+  }
+
+  // Parsing -- the parser pulls tokens from a fresh lexer as it goes, so the
+  // token list is never materialized; only large files lexed on several
+  // threads are turned into one first.
+  if (options.emit_ast) {
+    std::cout << "\n--- Parsing ---\n";
+  }
 
   try {
+    Lexer lexer(source.view());
+    LexedSource lexed;
+    bool lex_parallel = options.jobs != 1 && source.view().size() >= PARALLEL_LEX_BYTES;
+    if (lex_parallel) {
+      ProfileScope scope("parallel lex");
+      ThreadPool pool(options.jobs);
+      lexed = Lexer::lexParallel(source.view(), pool);
+    }
+    TokenStream tokens = lex_parallel ? TokenStream(lexed.tokens, lexed.lines) : TokenStream(lexer);
     Parser parser(tokens);
-    parser.parse();
-    std::cout << "\nParsing completed successfully!\n";
-    std::cout << "\n--- AST ---\n";
-    std::cout << parser.getTree().toString() << std::endl;
+    {
+      ProfileScope scope("lex and parse");
+      if (options.all_errors) {
+        const std::vector<Diagnostic>& diagnostics = parser.parseRecovering();
+        for (const Diagnostic& diagnostic : diagnostics) {
+          std::cerr << "Parsing error: " << diagnostic.message << "\n";
+        }
+        if (!diagnostics.empty()) {
+          return 1;
+        }
+      } else {
+        parser.parse();
+      }
+    }
+    const VhdlFile& tree = parser.getTree();
+    if (Profiler* profiler = Profiler::current()) {
+      profiler->count("AST allocations", tree.allocationCount());
+      profiler->count("AST bytes", tree.bytesUsed());
+      profiler->setCount("names interned", NameTable::global().size());
+    }
+    if (options.emit_ast) {
+      ProfileScope scope("print AST");
+      std::cout << "\nParsing completed successfully!\n";
+      std::cout << "\n--- AST ---\n";
+      tree.dump(std::cout);
+      std::cout << '\n';
+    }
+    if (options.simulate) {
+      return runSimulation(parser.getTree(), options);
+    }
+  } catch (const LexError& e) {
+    std::cout << e.what() << '\n';
+    return -1;
+  } catch (const std::exception& e) {
+    std::cerr << "Parsing error: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  // stdout is written in 64 KB blocks rather than through stdio line by line.
+  // std::cerr is tied to std::cout, so errors still appear after earlier output.
+  static char output_buffer[64 * 1024];
+  std::ios::sync_with_stdio(false);
+  std::cout.rdbuf()->pubsetbuf(output_buffer, sizeof(output_buffer));
+
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <input_file.vhd> [--sim TIME] [--drive NAME=VALUE[@TIME]]... [--native DIR] [--jobs N] [--mode auto|cycle|event]\n"
+              << "           [--wave FILE] [--trace PATTERN]... [--stimulus|--batch FILE] [--responses FILE]\n"
+              << "           [--emit tokens,ast,results|none] [--errors first|all] [--profile table|FILE]\n"
+              << "       " << argv[0] << " --project <directory|file_list> [--jobs N] [--cache DIR] [--errors first|all]\n"
+              << "           [--profile table|FILE]\n"
+              << "       " << argv[0] << " --waveform <file> [TIME]\n"
+              << "       " << argv[0] << " --serve\n";
+    return 1;
+  }
+
+  if (std::string(argv[1]) == "--project") {
+    if (argc < 3) {
+      std::cerr << "Error: --project needs a directory or file list\n";
+      return 1;
+    }
+    size_t jobs = 0;
+    std::string cache_dir;
+    std::string profile;
+    bool all_errors = false;
+    try {
+      for (int i = 3; i < argc; i += 2) {
+        std::string option = argv[i];
+        if (i + 1 == argc) {
+          throw std::runtime_error("option " + option + " needs a value");
+        }
+        if (option == "--errors") {
+          if (!parseErrors(argv[i + 1], all_errors)) {
+            throw std::runtime_error("--errors expects first or all");
+          }
+        } else if (option == "--jobs") {
+          jobs = parseJobs(argv[i + 1]);
+        } else if (option == "--cache") {
+          cache_dir = argv[i + 1];
+        } else if (option == "--profile") {
+          profile = argv[i + 1];
+        } else {
+          throw std::runtime_error("unknown option " + option);
+        }
+      }
+    } catch (const std::exception& e) {
+      std::cerr << "Error: " << e.what() << "\n";
+      return 1;
+    }
+    return runProject(argv[2], jobs, cache_dir, profile, all_errors);
+  }
+
+  if (std::string(argv[1]) == "--serve") {
+    return runServer();
+  }
+
+  if (std::string(argv[1]) == "--waveform") {
+    if (argc < 3) {
+      std::cerr << "Error: --waveform needs a file\n";
+      return 1;
+    }
+    return readWaveform(argv[2], argc > 3 ? argv[3] : nullptr);
+  }
+
+  SimulationOptions options;
+  try {
+    for (int i = 2; i < argc; i += 2) {
+      std::string option = argv[i];
+      if (i + 1 == argc) {
+        throw std::runtime_error("option " + option + " needs a value");
+      }
+      std::string argument = argv[i + 1];
+      if (option == "--sim") {
+        options.simulate = true;
+        options.until = static_cast<SimTime>(parseTime(argument));
+      } else if (option == "--drive") {
+        size_t equals = argument.find('=');
+        size_t at = argument.find('@');
+        if (equals == std::string::npos) {
+          throw std::runtime_error("--drive expects NAME=VALUE[@TIME]");
+        }
+        DriveOption drive;
+        drive.name  = argument.substr(0, equals);
+        drive.value = argument.substr(equals + 1, at == std::string::npos ? std::string::npos : at - equals - 1);
+        drive.time  = at == std::string::npos ? 0 : static_cast<SimTime>(parseTime(argument.substr(at + 1)));
+        options.drives.push_back(drive);
+      } else if (option == "--native") {
+        options.native_dir = argument;
+      } else if (option == "--jobs") {
+        options.jobs = parseJobs(argument);
+      } else if (option == "--mode") {
+        if (argument != "auto" && argument != "cycle" && argument != "event") {
+          throw std::runtime_error("--mode expects auto, cycle or event");
+        }
+        options.mode = argument;
+      } else if (option == "--wave") {
+        options.wave_path = argument;
+      } else if (option == "--trace") {
+        options.trace_patterns.push_back(argument);
+      } else if (option == "--stimulus" || option == "--batch") {
+        options.simulate = true;
+        options.stimulus_path = argument;
+        options.batch = option == "--batch";
+      } else if (option == "--responses") {
+        options.responses_path = argument;
+      } else if (option == "--profile") {
+        options.profile = argument;
+      } else if (option == "--emit") {
+        parseEmit(options, argument);
+      } else if (option == "--errors") {
+        if (!parseErrors(argument, options.all_errors)) {
+          throw std::runtime_error("--errors expects first or all");
+        }
+      } else {
+        throw std::runtime_error("unknown option " + option);
+      }
+    }
+    // The streams bring their own inputs, and there is no single run to trace
+    if (!options.stimulus_path.empty() && (!options.drives.empty() || !options.wave_path.empty())) {
+      throw std::runtime_error(std::string(options.drives.empty() ? "--wave" : "--drive") + " cannot be used with " +
+                               (options.batch ? "--batch" : "--stimulus"));
+    }
   } catch (const std::exception& e) {
-    std::cerr << "Parsing error: " << e.what() << std::endl;
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+  }
+
+  std::unique_ptr<Profiler> profiler;
+  if (!options.profile.empty()) {
+    profiler.reset(new Profiler);
+    Profiler::install(profiler.get());
+  }
+  int status = runFile(argv[1], options);
+  Profiler::install(nullptr);
+  if (profiler && !reportProfile(*profiler, options.profile)) {
     return 1;
   }
-}
\ No newline at end of file
+  return status;
+}
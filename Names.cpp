@@ -0,0 +1,97 @@
+#include "Names.h"
+#include "Lexicon.h"
+#include <cstring>
+
+NameTable& NameTable::global() {
+  static NameTable table;
+  return table;
+}
+
+NameTable::NameTable() {
+  // Index 0 of every shard is unused so that no real name encodes to NO_NAME.
+  for (Shard& shard : shards) {
+    shard.spellings.push_back(std::string_view());
+  }
+}
+
+// Lowercase `text` into `stack` when it fits, otherwise into `heap`.
+static std::string_view fold(std::string_view text, char* stack, size_t stack_size, std::string& heap) {
+  char* out = stack;
+  if (text.size() > stack_size) {
+    heap.resize(text.size());
+    out = heap.data();
+  }
+  for (size_t i = 0; i < text.size(); i++) {
+    out[i] = lowerAscii(text[i]);
+  }
+  return std::string_view(out, text.size());
+}
+
+NameId NameTable::intern(std::string_view text) {
+  char stack[128];
+  std::string heap;
+  std::string_view lowered = fold(text, stack, sizeof(stack), heap);
+
+  size_t index = std::hash<std::string_view>()(lowered) & (SHARDS - 1);
+  Shard& shard = shards[index];
+
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.ids.find(lowered);
+  if (it != shard.ids.end()) {
+    return it->second;
+  }
+  std::string_view stored = shard.store(lowered);
+  NameId id = static_cast<NameId>((shard.spellings.size() << SHARD_BITS) | index);
+  shard.spellings.push_back(stored);
+  shard.ids.emplace(stored, id);
+  return id;
+}
+
+NameId NameTable::find(std::string_view text) const {
+  char stack[128];
+  std::string heap;
+  std::string_view lowered = fold(text, stack, sizeof(stack), heap);
+
+  const Shard& shard = shards[std::hash<std::string_view>()(lowered) & (SHARDS - 1)];
+
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.ids.find(lowered);
+  return it != shard.ids.end() ? it->second : NO_NAME;
+}
+
+std::string_view NameTable::spelling(NameId id) const {
+  const Shard& shard = shards[id & (SHARDS - 1)];
+  size_t index = id >> SHARD_BITS;
+
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  return index < shard.spellings.size() ? shard.spellings[index] : std::string_view();
+}
+
+size_t NameTable::size() const {
+  size_t total = 0;
+  for (const Shard& shard : shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    total += shard.spellings.size() - 1;
+  }
+  return total;
+}
+
+std::string_view NameTable::Shard::store(std::string_view lowered) {
+  if (lowered.size() > BLOCK_SIZE / 4) {
+    // Oversized spellings get a block of their own, kept behind the block
+    // currently being filled so block_used keeps referring to that one.
+    auto block = std::make_unique<char[]>(lowered.size());
+    std::memcpy(block.get(), lowered.data(), lowered.size());
+    std::string_view stored(block.get(), lowered.size());
+    blocks.insert(blocks.empty() ? blocks.end() : blocks.end() - 1, std::move(block));
+    return stored;
+  }
+  if (block_used + lowered.size() > BLOCK_SIZE) {
+    blocks.push_back(std::make_unique<char[]>(BLOCK_SIZE));
+    block_used = 0;
+  }
+  char* dest = blocks.back().get() + block_used;
+  std::memcpy(dest, lowered.data(), lowered.size());
+  block_used += lowered.size();
+  return std::string_view(dest, lowered.size());
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Interned, case-folded identifier spelling. NO_NAME (0) stands for "absent";
+// every real id is non-zero.
+using NameId = uint32_t;
+static constexpr NameId NO_NAME = 0;
+
+// Process-wide intern table shared by the lexer, the parser and the AST. Each
+// distinct lowercased spelling is stored exactly once, so name comparisons
+// anywhere downstream are integer compares.
+//
+// The table is split into shards picked by the spelling's hash so that files
+// lexed on different threads rarely contend for the same lock. The low
+// SHARD_BITS of an id select the shard, the rest index into it.
+class NameTable {
+public:
+  static NameTable& global();
+
+  NameTable();
+  NameTable(const NameTable&) = delete;
+  NameTable& operator=(const NameTable&) = delete;
+
+  // Lowercases `text` and returns its id, adding it on first sight.
+  NameId intern(std::string_view text);
+
+  // Returns NO_NAME if the lowercased `text` has never been interned.
+  NameId find(std::string_view text) const;
+
+  std::string_view spelling(NameId id) const;
+  std::string str(NameId id) const {
+    return std::string(spelling(id));
+  }
+
+  size_t size() const;
+
+private:
+  static constexpr size_t SHARD_BITS = 4;
+  static constexpr size_t SHARDS     = size_t(1) << SHARD_BITS;
+  static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+  struct Shard {
+    mutable std::mutex mutex;
+    std::unordered_map<std::string_view, NameId> ids;
+    std::vector<std::string_view> spellings;
+
+    // Character storage; blocks never move, so the views above stay valid.
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t block_used = BLOCK_SIZE;
+
+    std::string_view store(std::string_view lowered);
+  };
+
+  Shard shards[SHARDS];
+};
@@ -0,0 +1,585 @@
+#include "Native.h"
+#include <dlfcn.h>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include "Bytecode.h"
+#include "DesignCache.h"
+
+namespace fs = std::filesystem;
+
+// ---------------------------------------------------------------------------
+// Runtime support compiled into every module. It must agree with
+// VhdlNativeKernel in Native.h and with the semantics in Value.cpp.
+
+static const char* const PREAMBLE = R"(// Generated by vhdl_sim. Do not edit.
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+extern "C" {
+struct VhdlNativeKernel {
+  const int64_t* const*  scalars;
+  const uint64_t* const* words;
+  void* kernel;
+  void (*schedule)(void* kernel, uint32_t signal, uint32_t flags, int64_t delay,
+                   int64_t scalar, const uint64_t* words);
+  void (*fail)(void* kernel, const char* message);
+};
+}
+
+namespace {
+
+template <size_t N>
+struct Bits {
+  static constexpr size_t WORDS = (N + 63) / 64;
+  uint64_t w[WORDS] = {};
+
+  static Bits load(const uint64_t* src) {
+    Bits r;
+    for (size_t i = 0; i < WORDS; i++) r.w[i] = src[i];
+    return r;
+  }
+  static Bits filled(bool bit) {
+    Bits r;
+    if (bit) {
+      for (size_t i = 0; i < WORDS; i++) r.w[i] = ~uint64_t(0);
+      r.clearTail();
+    }
+    return r;
+  }
+  void clearTail() {
+    if (N % 64) w[WORDS - 1] &= (uint64_t(1) << (N % 64)) - 1;
+  }
+  bool get(size_t i) const {
+    return (w[i / 64] >> (i % 64)) & 1;
+  }
+};
+
+template <size_t N> Bits<N> operator&(Bits<N> a, const Bits<N>& b) {
+  for (size_t i = 0; i < Bits<N>::WORDS; i++) a.w[i] &= b.w[i];
+  return a;
+}
+template <size_t N> Bits<N> operator|(Bits<N> a, const Bits<N>& b) {
+  for (size_t i = 0; i < Bits<N>::WORDS; i++) a.w[i] |= b.w[i];
+  return a;
+}
+template <size_t N> Bits<N> operator^(Bits<N> a, const Bits<N>& b) {
+  for (size_t i = 0; i < Bits<N>::WORDS; i++) a.w[i] ^= b.w[i];
+  return a;
+}
+template <size_t N> Bits<N> operator~(Bits<N> a) {
+  for (size_t i = 0; i < Bits<N>::WORDS; i++) a.w[i] = ~a.w[i];
+  a.clearTail();
+  return a;
+}
+
+// Element by element from the left, a proper prefix first.
+template <size_t N, size_t M> int vhdl_compare(const Bits<N>& a, const Bits<M>& b) {
+  if constexpr (N == M) {
+    for (size_t i = Bits<N>::WORDS; i-- > 0;) {
+      if (a.w[i] != b.w[i]) return a.w[i] < b.w[i] ? -1 : 1;
+    }
+    return 0;
+  } else {
+    size_t common = N < M ? N : M;
+    for (size_t i = 0; i < common; i++) {
+      bool x = a.get(N - 1 - i), y = b.get(M - 1 - i);
+      if (x != y) return x ? 1 : -1;
+    }
+    return N < M ? -1 : 1;
+  }
+}
+
+inline Bits<1> vhdl_bit(int64_t bit) {
+  Bits<1> r;
+  r.w[0] = bit != 0;
+  return r;
+}
+
+template <size_t N, size_t M> Bits<N + M> vhdl_concat(const Bits<N>& high, const Bits<M>& low) {
+  Bits<N + M> r;
+  for (size_t i = 0; i < Bits<M>::WORDS; i++) r.w[i] = low.w[i];
+  size_t offset = M / 64, shift = M % 64;
+  for (size_t i = 0; i < Bits<N>::WORDS; i++) {
+    r.w[offset + i] |= high.w[i] << shift;
+    if (shift && offset + i + 1 < Bits<N + M>::WORDS) r.w[offset + i + 1] = high.w[i] >> (64 - shift);
+  }
+  return r;
+}
+
+template <size_t N> Bits<N> vhdl_shl(const Bits<N>& a, uint64_t n, bool fill) {
+  if (n >= N) return Bits<N>::filled(fill);
+  Bits<N> r;
+  size_t ws = n / 64, bs = n % 64;
+  for (size_t i = Bits<N>::WORDS; i-- > ws;) {
+    uint64_t v = a.w[i - ws] << bs;
+    if (bs && i > ws) v |= a.w[i - ws - 1] >> (64 - bs);
+    r.w[i] = v;
+  }
+  if (fill) {
+    for (size_t i = 0; i < n; i++) r.w[i / 64] |= uint64_t(1) << (i % 64);
+  }
+  r.clearTail();
+  return r;
+}
+
+template <size_t N> Bits<N> vhdl_shr(const Bits<N>& a, uint64_t n, bool fill) {
+  if (n >= N) return Bits<N>::filled(fill);
+  Bits<N> r;
+  size_t ws = n / 64, bs = n % 64;
+  for (size_t i = 0; i + ws < Bits<N>::WORDS; i++) {
+    uint64_t v = a.w[i + ws] >> bs;
+    if (bs && i + ws + 1 < Bits<N>::WORDS) v |= a.w[i + ws + 1] << (64 - bs);
+    r.w[i] = v;
+  }
+  if (fill) {
+    for (size_t i = N - n; i < N; i++) r.w[i / 64] |= uint64_t(1) << (i % 64);
+  }
+  return r;
+}
+
+template <size_t N> Bits<N> vhdl_rol(const Bits<N>& a, uint64_t n) {
+  n %= N;
+  if (n == 0) return a;
+  return vhdl_shl(a, n, false) | vhdl_shr(a, N - n, false);
+}
+
+// kind: 0 sll, 1 srl, 2 sla, 3 sra, 4 rol, 5 ror; a negative amount shifts the other way
+template <size_t N> Bits<N> vhdl_shift(const Bits<N>& a, int kind, int64_t amount) {
+  if (amount < 0) {
+    kind ^= 1;
+    amount = -amount;
+  }
+  uint64_t n = static_cast<uint64_t>(amount);
+  switch (kind) {
+    case 0:  return vhdl_shl(a, n, false);
+    case 1:  return vhdl_shr(a, n, false);
+    case 2:  return vhdl_shl(a, n, a.get(0));
+    case 3:  return vhdl_shr(a, n, a.get(N - 1));
+    case 4:  return vhdl_rol(a, n);
+    default: return vhdl_rol(a, N - n % N);
+  }
+}
+
+// Integer operators fail rather than wrap past 64 bits; same messages as overflowError()
+inline int64_t vhdl_add(const VhdlNativeKernel& k, int64_t a, int64_t b) {
+  int64_t r;
+  if (__builtin_add_overflow(a, b, &r)) { k.fail(k.kernel, "result of operator '+' is out of range"); return 0; }
+  return r;
+}
+inline int64_t vhdl_sub(const VhdlNativeKernel& k, int64_t a, int64_t b) {
+  int64_t r;
+  if (__builtin_sub_overflow(a, b, &r)) { k.fail(k.kernel, "result of operator '-' is out of range"); return 0; }
+  return r;
+}
+inline int64_t vhdl_mul(const VhdlNativeKernel& k, int64_t a, int64_t b) {
+  int64_t r;
+  if (__builtin_mul_overflow(a, b, &r)) { k.fail(k.kernel, "result of operator '*' is out of range"); return 0; }
+  return r;
+}
+inline int64_t vhdl_neg(const VhdlNativeKernel& k, int64_t a) {
+  if (a == INT64_MIN) { k.fail(k.kernel, "result of operator '-' is out of range"); return 0; }
+  return -a;
+}
+inline int64_t vhdl_abs(const VhdlNativeKernel& k, int64_t a) {
+  if (a == INT64_MIN) { k.fail(k.kernel, "result of operator 'abs' is out of range"); return 0; }
+  return a < 0 ? -a : a;
+}
+inline int64_t vhdl_div(const VhdlNativeKernel& k, int64_t a, int64_t b) {
+  if (b == 0) { k.fail(k.kernel, "division by zero"); return 0; }
+  if (a == INT64_MIN && b == -1) { k.fail(k.kernel, "result of operator '/' is out of range"); return 0; }
+  return a / b;
+}
+inline int64_t vhdl_rem(const VhdlNativeKernel& k, int64_t a, int64_t b) {
+  if (b == 0) { k.fail(k.kernel, "division by zero"); return 0; }
+  return b == -1 ? 0 : a % b;
+}
+inline int64_t vhdl_mod(const VhdlNativeKernel& k, int64_t a, int64_t b) {
+  if (b == 0) { k.fail(k.kernel, "division by zero"); return 0; }
+  int64_t m = b == -1 ? 0 : a % b;
+  return (m != 0 && ((m < 0) != (b < 0))) ? m + b : m;
+}
+inline int64_t vhdl_pow(const VhdlNativeKernel& k, int64_t a, int64_t b) {
+  if (b < 0) { k.fail(k.kernel, "negative exponent"); return 0; }
+  int64_t r = 1;
+  while (b > 0) {
+    bool overflow = (b & 1) && __builtin_mul_overflow(r, a, &r);
+    b >>= 1;
+    if (overflow || (b > 0 && __builtin_mul_overflow(a, a, &a))) {
+      k.fail(k.kernel, "result of operator '**' is out of range");
+      return 0;
+    }
+  }
+  return r;
+}
+// `what` completes the message: " is out of range for 'x' of type natural"
+inline void vhdl_check_range(const VhdlNativeKernel& k, int64_t v, int64_t low, int64_t high, const char* what) {
+  if (v >= low && v <= high) return;
+  char message[256];
+  std::snprintf(message, sizeof(message), "value %lld%s", static_cast<long long>(v), what);
+  k.fail(k.kernel, message);
+}
+
+)";
+
+// ---------------------------------------------------------------------------
+// Code generation
+
+namespace {
+
+class Generator {
+public:
+  explicit Generator(const Design& design) : design(design) {}
+
+  std::string generate() {
+    for (const ProcessInfo& process : design.processes) {
+      programs.push_back(compileProcess(design, process));
+    }
+
+    out += PREAMBLE;
+    out += "struct State {\n";
+    for (size_t p = 0; p < design.processes.size(); p++) {
+      const ProcessInfo& process = design.processes[p];
+      for (size_t v = 0; v < process.variables.size(); v++) {
+        const Value& initial = process.variables[v].initial;
+        out += "  " + typeText(initial) + " " + variableName(p, v) + " = " + literal(initial) + ";\n";
+      }
+    }
+    out += "};\n\n";
+
+    for (size_t p = 0; p < programs.size(); p++) {
+      generateProcess(p);
+    }
+
+    out += "} // namespace\n\nextern \"C\" {\n";
+    out += "uint32_t vhdl_abi_version() { return " + std::to_string(NativeModule::ABI_VERSION) + "; }\n";
+    out += "void* vhdl_create() { return new State(); }\n";
+    out += "void vhdl_destroy(void* state) { delete static_cast<State*>(state); }\n";
+    out += "void vhdl_run(void* state, uint32_t process, const VhdlNativeKernel* k) {\n";
+    out += "  State& s = *static_cast<State*>(state);\n  switch (process) {\n";
+    for (size_t p = 0; p < programs.size(); p++) {
+      out += "    case " + std::to_string(p) + ": process_" + std::to_string(p) + "(s, *k); break;\n";
+    }
+    out += "  }\n}\n}\n";
+    return std::move(out);
+  }
+
+private:
+  const Design& design;
+  std::vector<Program> programs;
+  std::string out;
+
+  // Current process
+  size_t process_index = 0;
+  const Program* program = nullptr;
+
+  static std::string variableName(size_t process, size_t variable) {
+    return "p" + std::to_string(process) + "_v" + std::to_string(variable);
+  }
+
+  static std::string typeText(const Value& sample) {
+    if (sample.kind == TypeKind::BitVector) {
+      return "Bits<" + std::to_string(sample.bits.width()) + ">";
+    }
+    return "int64_t";
+  }
+
+  static std::string literal(const Value& value) {
+    if (value.kind != TypeKind::BitVector) {
+      if (value.scalar == INT64_MIN) {
+        return "INT64_MIN";
+      }
+      return "INT64_C(" + std::to_string(value.scalar) + ")";
+    }
+    std::string text = typeText(value) + "{{";
+    for (size_t i = 0; i < value.bits.wordCount(); i++) {
+      char word[32];
+      std::snprintf(word, sizeof(word), "%s0x%llxull", i ? ", " : "", static_cast<unsigned long long>(value.bits.words()[i]));
+      text += word;
+    }
+    return text + "}}";
+  }
+
+  // A value of the operand's type
+  const Value& sample(uint32_t ref) const {
+    uint32_t index = ref & OPERAND_INDEX_MASK;
+    switch (static_cast<Space>(ref >> 30)) {
+      case Space::Register: return program->registers[index];
+      case Space::Variable: return design.processes[process_index].variables[index].initial;
+      case Space::Signal:   return design.signals[index].initial;
+      default:              return program->constants[index];
+    }
+  }
+
+  bool isVector(uint32_t ref) const {
+    return sample(ref).kind == TypeKind::BitVector;
+  }
+
+  std::string operand(uint32_t ref) const {
+    uint32_t index = ref & OPERAND_INDEX_MASK;
+    switch (static_cast<Space>(ref >> 30)) {
+      case Space::Register:
+        return "r" + std::to_string(index);
+      case Space::Variable:
+        return "s." + variableName(process_index, index);
+      case Space::Signal:
+        if (isVector(ref)) {
+          return typeText(sample(ref)) + "::load(k.words[" + std::to_string(index) + "])";
+        }
+        return "(*k.scalars[" + std::to_string(index) + "])";
+      default:
+        return literal(program->constants[index]);
+    }
+  }
+
+  // A bit operand of `&` is widened to Bits<1>
+  std::string vectorOperand(uint32_t ref) const {
+    return isVector(ref) ? operand(ref) : "vhdl_bit(" + operand(ref) + ")";
+  }
+
+  static const char* logicSymbol(Operator op) {
+    switch (op) {
+      case Operator::And: case Operator::Nand: return " & ";
+      case Operator::Or:  case Operator::Nor:  return " | ";
+      default:                                 return " ^ ";
+    }
+  }
+
+  static bool inverted(Operator op) {
+    return op == Operator::Nand || op == Operator::Nor || op == Operator::Xnor;
+  }
+
+  static const char* compareSymbol(Operator op) {
+    switch (op) {
+      case Operator::Equal:     return " == ";
+      case Operator::NotEqual:  return " != ";
+      case Operator::Less:      return " < ";
+      case Operator::LessEqual: return " <= ";
+      case Operator::Greater:   return " > ";
+      default:                  return " >= ";
+    }
+  }
+
+  static int shiftKind(Operator op) {
+    switch (op) {
+      case Operator::Sll: return 0;
+      case Operator::Srl: return 1;
+      case Operator::Sla: return 2;
+      case Operator::Sra: return 3;
+      case Operator::Rol: return 4;
+      default:            return 5;
+    }
+  }
+
+  std::string arithmetic(Operator op, const std::string& a, const std::string& b) const {
+    switch (op) {
+      case Operator::Multiply: return "vhdl_mul(k, " + a + ", " + b + ")";
+      case Operator::Divide:   return "vhdl_div(k, " + a + ", " + b + ")";
+      case Operator::Rem:      return "vhdl_rem(k, " + a + ", " + b + ")";
+      case Operator::Mod:      return "vhdl_mod(k, " + a + ", " + b + ")";
+      default:                 return "vhdl_pow(k, " + a + ", " + b + ")";
+    }
+  }
+
+  std::string binary(const Instruction& instruction) const {
+    Operator op = instruction.sub;
+    std::string b = operand(instruction.b), c = operand(instruction.c);
+    if (isRelational(op)) {
+      return "vhdl_compare(" + b + ", " + c + ")" + compareSymbol(op) + "0";
+    }
+    if (op == Operator::Concat) {
+      return "vhdl_concat(" + vectorOperand(instruction.b) + ", " + vectorOperand(instruction.c) + ")";
+    }
+    if (op == Operator::Sll || op == Operator::Srl || op == Operator::Sla ||
+        op == Operator::Sra || op == Operator::Rol || op == Operator::Ror) {
+      return "vhdl_shift(" + b + ", " + std::to_string(shiftKind(op)) + ", " + c + ")";
+    }
+    std::string result = "(" + b + logicSymbol(op) + c + ")";
+    return inverted(op) ? "~" + result : result;
+  }
+
+  static bool isRelational(Operator op) {
+    return op == Operator::Equal || op == Operator::NotEqual || op == Operator::Less ||
+           op == Operator::LessEqual || op == Operator::Greater || op == Operator::GreaterEqual;
+  }
+
+  void generateProcess(size_t p) {
+    process_index = p;
+    program = &programs[p];
+    const std::vector<Instruction>& code = program->code;
+
+    std::vector<bool> targets(code.size() + 1, false);
+    for (const Instruction& instruction : code) {
+      if (instruction.op == OpCode::Jump || instruction.op == OpCode::JumpIfFalse) {
+        targets[instruction.a] = true;
+      }
+    }
+
+    out += "static void process_" + std::to_string(p) + "(State& s, const VhdlNativeKernel& k) {\n";
+    out += "  (void)s;\n  (void)k;\n";
+    for (size_t r = 0; r < program->registers.size(); r++) {
+      out += "  " + typeText(program->registers[r]) + " r" + std::to_string(r) + ";\n";
+    }
+
+    for (size_t i = 0; i < code.size(); i++) {
+      if (targets[i]) {
+        out += "L" + std::to_string(i) + ":;\n";
+      }
+      out += "  " + statement(code[i]) + "\n";
+    }
+    out += "}\n\n";
+  }
+
+  std::string statement(const Instruction& instruction) const {
+    std::string a = instruction.op == OpCode::Jump || instruction.op == OpCode::JumpIfFalse ||
+                    instruction.op == OpCode::Schedule || instruction.op == OpCode::CheckRange ||
+                    instruction.op == OpCode::Halt
+                  ? std::string() : operand(instruction.a);
+    Operator op = instruction.sub;
+
+    switch (instruction.op) {
+      case OpCode::Copy:
+        return a + " = " + operand(instruction.b) + ";";
+      case OpCode::NotScalar:
+        return a + " = !" + operand(instruction.b) + ";";
+      case OpCode::LogicScalar: {
+        std::string value = "(" + operand(instruction.b) + logicSymbol(op) + operand(instruction.c) + ")";
+        return a + " = " + (inverted(op) ? "!" + value : value) + ";";
+      }
+      case OpCode::CompareScalar:
+        return a + " = " + operand(instruction.b) + compareSymbol(op) + operand(instruction.c) + ";";
+      case OpCode::Add:
+        return a + " = vhdl_add(k, " + operand(instruction.b) + ", " + operand(instruction.c) + ");";
+      case OpCode::Subtract:
+        return a + " = vhdl_sub(k, " + operand(instruction.b) + ", " + operand(instruction.c) + ");";
+      case OpCode::Arith:
+        return a + " = " + arithmetic(op, operand(instruction.b), operand(instruction.c)) + ";";
+      case OpCode::Negate:
+        return a + " = vhdl_neg(k, " + operand(instruction.b) + ");";
+      case OpCode::Absolute:
+        return a + " = vhdl_abs(k, " + operand(instruction.b) + ");";
+      case OpCode::Unary:
+        return a + " = ~" + operand(instruction.b) + ";";
+      case OpCode::Binary:
+        return a + " = " + binary(instruction) + ";";
+      case OpCode::Fill:
+        return a + " = Bits<" + std::to_string(instruction.c) + ">::filled(" + operand(instruction.b) + " != 0);";
+      case OpCode::CheckRange: {
+        // Same message as rangeError()
+        const RangeCheck& range = program->ranges[instruction.c];
+        std::string what = " is out of range for '" + NameTable::global().str(range.target) + "' of type " +
+                           range.type.toString();
+        return "vhdl_check_range(k, " + operand(instruction.b) + ", INT64_C(" + std::to_string(range.type.left) +
+               "), INT64_C(" + std::to_string(range.type.right) + "), \"" + what + "\");";
+      }
+      case OpCode::Jump:
+        return "goto L" + std::to_string(instruction.a) + ";";
+      case OpCode::JumpIfFalse:
+        return "if (!" + operand(instruction.b) + ") goto L" + std::to_string(instruction.a) + ";";
+      case OpCode::Schedule: {
+        std::string call = "k.schedule(k.kernel, " + std::to_string(instruction.a) + ", " +
+                           std::to_string(instruction.flags) + ", " +
+                           (instruction.c == NO_OPERAND ? "0" : operand(instruction.c)) + ", ";
+        if (isVector(instruction.b)) {
+          return "{ " + typeText(sample(instruction.b)) + " t = " + operand(instruction.b) + "; " +
+                 call + "0, t.w); }";
+        }
+        return call + operand(instruction.b) + ", nullptr);";
+      }
+      case OpCode::Halt:
+        return "return;";
+    }
+    return ";";
+  }
+};
+
+} // namespace
+
+std::string generateNativeSource(const Design& design) {
+  return Generator(design).generate();
+}
+
+// ---------------------------------------------------------------------------
+// Build and load
+
+static std::string shellQuoted(const std::string& text) {
+  std::string result = "'";
+  for (char c : text) {
+    result += c == '\'' ? std::string("'\\''") : std::string(1, c);
+  }
+  return result + "'";
+}
+
+std::unique_ptr<NativeModule> NativeModule::build(const Design& design, const std::string& directory) {
+  const char* compiler = std::getenv("CXX");
+  std::string command = std::string(compiler && *compiler ? compiler : "c++") +
+                        " -std=c++17 -O2 -shared -fPIC -w";
+  std::string source = generateNativeSource(design);
+
+  // The key covers the compiler command too, so switching compilers rebuilds
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(
+                DesignCache::hashSource(command + "\n" + source)));
+  std::error_code ec;
+  fs::create_directories(directory, ec);
+  std::string library = (fs::path(directory) / (std::string(name) + ".so")).string();
+
+  std::unique_ptr<NativeModule> module(new NativeModule());
+  module->cached = fs::exists(library, ec);
+  if (!module->cached) {
+    // Build beside the final name and rename, like DesignCache::store
+    std::string suffix = ".tmp" + std::to_string(std::random_device()());
+    std::string source_path = (fs::path(directory) / (std::string(name) + ".cpp")).string();
+    std::string temp = library + suffix;
+    {
+      std::ofstream stream(source_path + suffix, std::ios::trunc);
+      stream << source;
+      if (!stream.good()) {
+        throw std::runtime_error("cannot write " + source_path);
+      }
+    }
+    fs::rename(source_path + suffix, source_path, ec);
+    if (std::system((command + " -o " + shellQuoted(temp) + " " + shellQuoted(source_path)).c_str()) != 0) {
+      fs::remove(temp, ec);
+      throw std::runtime_error("native build failed: " + command + " " + source_path);
+    }
+    fs::rename(temp, library, ec);
+    if (ec) {
+      fs::remove(temp, ec);
+      throw std::runtime_error("cannot install " + library);
+    }
+  }
+
+  module->handle = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (!module->handle) {
+    throw std::runtime_error(std::string("cannot load native module: ") + dlerror());
+  }
+  auto abi_version = reinterpret_cast<uint32_t (*)()>(dlsym(module->handle, "vhdl_abi_version"));
+  module->create_state  = reinterpret_cast<void* (*)()>(dlsym(module->handle, "vhdl_create"));
+  module->destroy_state = reinterpret_cast<void (*)(void*)>(dlsym(module->handle, "vhdl_destroy"));
+  module->run_process   = reinterpret_cast<void (*)(void*, uint32_t, const VhdlNativeKernel*)>(
+                            dlsym(module->handle, "vhdl_run"));
+  if (!abi_version || !module->create_state || !module->destroy_state || !module->run_process ||
+      abi_version() != ABI_VERSION) {
+    throw std::runtime_error("incompatible native module " + library);
+  }
+  return module;
+}
+
+NativeModule::~NativeModule() {
+  if (handle) {
+    dlclose(handle);
+  }
+}
+
+void* NativeModule::createState() const {
+  return create_state();
+}
+
+void NativeModule::destroyState(void* state) const {
+  destroy_state(state);
+}
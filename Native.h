@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "Elaborate.h"
+
+// Native simulation backend: every process of an elaborated design becomes a
+// C++ function, the source is built into a shared object with the system
+// compiler, and the simulator calls into it through the C interface below.
+//
+// Code is generated from the processes' bytecode (Bytecode.h), so it is
+// already type-checked and constant-folded. bit_vector widths become template
+// arguments (`Bits<N>`), registers become locals the compiler can keep in
+// machine registers, and jumps become gotos inside one function per process.
+// Variables live in a state object owned by the module.
+
+extern "C" {
+
+// What a native process sees of the kernel. Signal values are read in place
+// through pointers into the simulator's value array; assignments and runtime
+// errors go back through the callbacks (`fail` does not return).
+struct VhdlNativeKernel {
+  const int64_t* const*  scalars;  // per signal: its scalar (bit, boolean, integer)
+  const uint64_t* const* words;    // per signal: its packed bit_vector words
+  void* kernel;
+  void (*schedule)(void* kernel, uint32_t signal, uint32_t flags, int64_t delay,
+                   int64_t scalar, const uint64_t* words);
+  void (*fail)(void* kernel, const char* message);
+};
+
+}
+
+// Returns the C++ source of the native module for `design`.
+// Throws std::runtime_error on type errors in process bodies.
+std::string generateNativeSource(const Design& design);
+
+// A loaded native module.
+class NativeModule {
+public:
+  // Generates the design's source and loads the shared object built from it,
+  // compiling it first unless `directory` already holds a build of the same
+  // source. The compiler is $CXX, or `c++`. Throws std::runtime_error when
+  // the build or the load fails.
+  static std::unique_ptr<NativeModule> build(const Design& design, const std::string& directory);
+
+  ~NativeModule();
+  NativeModule(const NativeModule&) = delete;
+  NativeModule& operator=(const NativeModule&) = delete;
+
+  // Variables of every process, at their initial values.
+  void* createState() const;
+  void destroyState(void* state) const;
+
+  void run(void* state, uint32_t process, const VhdlNativeKernel& kernel) const {
+    run_process(state, process, &kernel);
+  }
+
+  // True when the shared object came from the cache instead of a fresh build.
+  bool fromCache() const {
+    return cached;
+  }
+
+  static constexpr uint32_t ABI_VERSION = 1;
+
+private:
+  NativeModule() = default;
+
+  void* handle = nullptr;
+  bool  cached = false;
+  void* (*create_state)() = nullptr;
+  void  (*destroy_state)(void*) = nullptr;
+  void  (*run_process)(void*, uint32_t, const VhdlNativeKernel*) = nullptr;
+};
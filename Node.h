@@ -1,191 +1,307 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <iostream>
+#include <sstream>
 #include <memory>
 #include <stdexcept>
 #include "Token.h"
-#include "BlockDeclarativeItem.h"
+#include "Names.h"
+#include "Arena.h"
 
+// AST nodes live in the Arena of the design unit they belong to and are never
+// destroyed one by one, so they must not own resources: children are raw
+// pointers or Spans into the same arena, and names are interned NameIds.
 class Node {
 public:
-  virtual ~Node() = default;
-  virtual std::string toString() const = 0;
-};
+  // Writes the node and its children straight to `out`, so dumping a large
+  // tree never builds it up as one string.
+  virtual void dump(std::ostream& out) const = 0;
 
+  std::string toString() const {
+    std::ostringstream out;
+    dump(out);
+    return out.str();
+  }
+
+protected:
+  // Non-virtual so nodes stay trivially destructible; nothing deletes through a Node*.
+  ~Node() = default;
+
+  static std::string_view nameString(NameId id) {
+    return NameTable::global().spelling(id);
+  }
+
+  static std::string_view keywordString(Keyword keyword) {
+    return keywordSpelling(keyword);
+  }
+
+  template <class T>
+  static void dumpOrNull(std::ostream& out, const T* node) {
+    if (node) {
+      node->dump(out);
+    } else {
+      out << "null";
+    }
+  }
+};
 
 class InterfaceType : public Node {
 public:
-  std::string identifier;
-  std::string upper;
-  std::string direction;
-  std::string lower;
+  NameId  identifier = NO_NAME;
+  NameId  upper      = NO_NAME;
+  Keyword direction  = Keyword::None;
+  NameId  lower      = NO_NAME;
 
-  void setIdentifier(const std::string& id) {
+  void setIdentifier(NameId id) {
     this->identifier = id;
   }
 
-  void setUpper(const std::string& upper) {
+  void setUpper(NameId upper) {
     this->upper = upper;
   }
 
-  void setDirection(const std::string& direction) {
+  void setDirection(Keyword direction) {
     this->direction = direction;
   }
 
-  void setLower(const std::string& lower) {
+  void setLower(NameId lower) {
     this->lower = lower;
   }
 
-  std::string toString() const override {
-    if (!direction.empty() && !upper.empty() && !lower.empty()) {
-      return identifier + "(" + upper + " " + direction + " " + lower + ")";
+  void dump(std::ostream& out) const override {
+    out << nameString(identifier);
+    if (direction != Keyword::None && upper != NO_NAME && lower != NO_NAME) {
+      out << "(" << nameString(upper) << " " << keywordString(direction) << " " << nameString(lower) << ")";
     }
-    return identifier;
   }
 };
 
 
+// Declarations, expressions and statements derive from Node and refer to
+// InterfaceType, so they can only be pulled in once both are complete.
+#include "Expression.h"
+#include "BlockDeclarativeItem.h"
+#include "Statement.h"
+
+
 class InterfaceElement : public Node {
 public:
-  std::string identifier;
-  std::string mode;   
-  std::unique_ptr<class InterfaceType> type;
+  NameId  identifier = NO_NAME;
+  Keyword mode       = Keyword::None;
+  InterfaceType* type = nullptr;
 
-  void setIdentifier(const std::string& id) {
+  void setIdentifier(NameId id) {
     this->identifier = id;
   }
 
-  void setMode(const std::string& mode) {
+  void setMode(Keyword mode) {
     this->mode = mode;
   }
 
-  void setType(std::unique_ptr<class InterfaceType> type) {
-    this->type = std::move(type);
+  void setType(InterfaceType* type) {
+    this->type = type;
   }
 
-  std::string toString() const override {
-    return "InterfaceElement(" + identifier + ", " + mode + ")\n" + 
-           (type ? type->toString() : "null");
+  void dump(std::ostream& out) const override {
+    out << "InterfaceElement(" << nameString(identifier) << ", " << keywordString(mode) << ")\n";
+    dumpOrNull(out, type);
   }
 };
 
 
 class InterfaceList : public Node {
 public:
-  std::vector<std::unique_ptr<class InterfaceElement>> elems;
+  Span<InterfaceElement> elems;
 
-  void pushElement(std::unique_ptr<class InterfaceElement> elem) {
-    elems.push_back(std::move(elem));
+  void setElements(Span<InterfaceElement> elems) {
+    this->elems = elems;
   }
 
-  std::string toString() const override {
-    std::string result = "InterfaceList[" + std::to_string(elems.size()) + " elements]\n";
+  void dump(std::ostream& out) const override {
+    out << "InterfaceList[" << elems.size() << " elements]\n";
     for (const auto& elem : elems) {
-      result += elem->toString() + "\n";
+      elem.dump(out);
+      out << "\n";
     }
-    return result;
   }
 };
 
 
 class EntityHeader : public Node {
 public:
-  std::unique_ptr<class InterfaceList> port_list;
-  std::unique_ptr<class InterfaceList> generic_list;
+  InterfaceList* port_list    = nullptr;
+  InterfaceList* generic_list = nullptr;
 
-  void setPortList(std::unique_ptr<class InterfaceList> port_list) {
-    this->port_list = std::move(port_list);
+  void setPortList(InterfaceList* port_list) {
+    this->port_list = port_list;
   }
 
-  std::string toString() const {
-    return std::string("EntityHeader\n") + 
-           (port_list ? port_list->toString() : "null") + "\n" + 
-           (generic_list ? generic_list->toString() : "null");
+  void dump(std::ostream& out) const override {
+    out << "EntityHeader\n";
+    dumpOrNull(out, port_list);
+    out << "\n";
+    dumpOrNull(out, generic_list);
   }
 };
 
 
 class EntityDeclaration : public Node {
 public:
-  std::string identifier;
-  std::string simple_name;
-  std::unique_ptr<class EntityHeader> entity_header;
+  NameId identifier  = NO_NAME;
+  NameId simple_name = NO_NAME;
+  EntityHeader* entity_header = nullptr;
 
-  void setIdentifier(const std::string& id) {
+  void setIdentifier(NameId id) {
     this->identifier = id;
   }
 
-  void setSimpleName(const std::string& name) {
+  void setSimpleName(NameId name) {
     this->simple_name = name;
   }
 
-  void setEntityHeader(std::unique_ptr<class EntityHeader> header) {
-    this->entity_header = std::move(header);
+  void setEntityHeader(EntityHeader* header) {
+    this->entity_header = header;
   }
 
-  std::string toString() const {
-    return "EntityDeclaration(" + identifier + ")" + "\n" + entity_header->toString();
+  void dump(std::ostream& out) const override {
+    out << "EntityDeclaration(" << nameString(identifier) << ")\n";
+    entity_header->dump(out);
   }
 };
 
-class ArchitectureDeclaration : public Node {
+class ArchitectureDeclarativePart : public Node {
 public:
-  std::string identifier;
-  std::string simple_name;
-  std::unique_ptr<class EntityHeader> archtct_decl_part;
-  std::unique_ptr<class EntityHeader> entity_header;
+  Span<BlockDeclarativeItem*> items;
+
+  void setItems(Span<BlockDeclarativeItem*> items) {
+    this->items = items;
+  }
+
+  void dump(std::ostream& out) const override {
+    out << "ArchitectureDeclarativePart\n";
+    for (const auto& item : items) {
+      item->dump(out);
+      out << "\n";
+    }
+  }
+};
 
-  void setIdentifier(const std::string& id) {
+
+class ArchitectureDeclaration : public Node {
+public:
+  NameId identifier  = NO_NAME;
+  NameId entity_name = NO_NAME;
+  NameId simple_name = NO_NAME;
+  ArchitectureDeclarativePart* archtct_decl_part = nullptr;
+  EntityHeader* entity_header = nullptr;
+  Span<ConcurrentStatement*> statements;
+
+  void setIdentifier(NameId id) {
     this->identifier = id;
   }
 
-  void setSimpleName(const std::string& name) {
+  void setSimpleName(NameId name) {
     this->simple_name = name;
   }
 
-  std::string toString() const override {
-    return "ArchitectureDeclaration(" + identifier + ", " + simple_name + ")";
+  void setEntityName(NameId name) {
+    this->entity_name = name;
   }
-};
 
-class ArchitectureDeclarativePart : public Node {
-public:
-  std::vector<std::unique_ptr<BlockDeclarativeItem>> items;
+  void setDeclarativePart(ArchitectureDeclarativePart* part) {
+    this->archtct_decl_part = part;
+  }
 
-  void additem(std::unique_ptr<BlockDeclarativeItem> item) {
-    items.push_back(std::move(item));
+  void setStatements(Span<ConcurrentStatement*> statements) {
+    this->statements = statements;
   }
 
-  std::string toString() const override {
-    std::string result = "ArchitectureDeclarativePart\n";
-    for (const auto& item : items) {
-      result += item->toString() + "\n";
+  void dump(std::ostream& out) const override {
+    out << "ArchitectureDeclaration(" << nameString(identifier) << ", " << nameString(simple_name) << ")\n";
+    if (archtct_decl_part) {
+      archtct_decl_part->dump(out);
+    }
+    for (const ConcurrentStatement* statement : statements) {
+      statement->dump(out);
+      out << "\n";
     }
-    return result;
   }
 };
 
 
+// A design unit and the arena its whole tree is allocated from, so the unit
+// is released in one step.
+template <class Declaration>
+struct DesignUnit {
+  Declaration* declaration = nullptr;
+  Arena arena;
+};
+
+// Root of a parsed file, holding its design units in source order.
 class VhdlFile : public Node {
 public:
-  std::string identifier;
-  std::unique_ptr<class EntityDeclaration> entity;
-  std::unique_ptr<class ArchitectureDeclaration> archtc;
+  NameId identifier = NO_NAME;
+  std::vector<DesignUnit<EntityDeclaration>> entities;
+  std::vector<DesignUnit<ArchitectureDeclaration>> architectures;
 
-  void setIdentifier(const std::string& id) {
+  VhdlFile() = default;
+  VhdlFile(VhdlFile&&) = default;
+  VhdlFile& operator=(VhdlFile&&) = default;
+  ~VhdlFile() = default;
+
+  void setIdentifier(NameId id) {
     this->identifier = id;
   }
 
-  void setEntity(std::unique_ptr<class EntityDeclaration> entity) {
-    this->entity = std::move(entity);
+  // Moving a unit keeps its arena blocks, so the tree stays where it is
+  void addEntity(DesignUnit<EntityDeclaration>&& unit) {
+    entities.push_back(std::move(unit));
   }
 
-  void setArchtc(std::unique_ptr<class ArchitectureDeclaration> archtc) {
-    this->archtc = std::move(archtc);
+  void addArchtc(DesignUnit<ArchitectureDeclaration>&& unit) {
+    architectures.push_back(std::move(unit));
   }
 
-  std::string toString() const {
-    return "VhdlFile(" + identifier + ")" + "\n" + entity->toString();
+  const EntityDeclaration* findEntity(NameId name) const {
+    for (const auto& unit : entities) {
+      if (unit.declaration->identifier == name) {
+        return unit.declaration;
+      }
+    }
+    return nullptr;
+  }
+
+  // Totals over the arenas of every unit
+  size_t allocationCount() const {
+    size_t count = 0;
+    for (const auto& unit : entities) count += unit.arena.allocationCount();
+    for (const auto& unit : architectures) count += unit.arena.allocationCount();
+    return count;
+  }
+
+  size_t bytesUsed() const {
+    size_t bytes = 0;
+    for (const auto& unit : entities) bytes += unit.arena.bytesUsed();
+    for (const auto& unit : architectures) bytes += unit.arena.bytesUsed();
+    return bytes;
+  }
+
+  void dump(std::ostream& out) const override {
+    out << "VhdlFile(" << nameString(identifier) << ")\n";
+    if (entities.empty()) {
+      out << "null";
+    }
+    for (size_t i = 0; i < entities.size(); i++) {
+      if (i > 0) {
+        out << "\n";
+      }
+      entities[i].declaration->dump(out);
+    }
+    for (const auto& unit : architectures) {
+      out << "\n";
+      unit.declaration->dump(out);
+    }
   }
 };
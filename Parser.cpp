@@ -1,23 +1,14 @@
 #include "Parser.h"
 
-Parser::Parser(const std::vector<Token>& tokens) {;
-  this->tokens = tokens;
-  this->current = 0;
+Parser::Parser(TokenStream& tokens) : tokens(tokens) {
 }
 
-Token Parser::peek() const{
-  if (current >= tokens.size()) {
-    return Token(TokenType::EoF, "", 0, 0);
-  }
-  return tokens[current];
+const Token& Parser::peek() {
+  return panicking ? end_of_input : tokens.peek();
 }
 
 Token Parser::advance() {
-  while (current + 1 < tokens.size() && tokens[current + 1].getTokenType() == TokenType::EoL) {
-    current++;
-  }
-
-  return tokens[current++];
+  return panicking ? end_of_input : tokens.advance();
 }
 
 bool Parser::match(TokenType type) {
@@ -28,47 +19,127 @@ bool Parser::match(TokenType type) {
   return false;
 }
 
-bool Parser::matchKeyword (const std::string& value) {
-  if (check(TokenType::Keyword) && peek().getValue() == value) {
+bool Parser::matchKeyword (Keyword keyword) {
+  if (checkKeyword(keyword)) {
     advance();
     return true;
   }
   return false;
 }
 
-bool Parser::matchSymbol (const std::string& value) {
-  if (check(TokenType::Symbol) && peek().getValue() == value) {
+bool Parser::matchSymbol (Symbol symbol) {
+  if (checkSymbol(symbol)) {
     advance();
     return true;
   }
   return false;
 }
 
-bool  Parser::check(TokenType type) const {
+bool Parser::matchOperator(Operator op) {
+  if (checkOperator(op)) {
+    advance();
+    return true;
+  }
+  return false;
+}
+
+bool  Parser::check(TokenType type) {
   return peek().getTokenType() == type;
 }
 
+bool Parser::checkKeyword(Keyword keyword) {
+  return peek().getTokenType() == TokenType::Keyword && peek().getKeyword() == keyword;
+}
+
+bool Parser::checkSymbol(Symbol symbol) {
+  return peek().getTokenType() == TokenType::Symbol && peek().getSymbol() == symbol;
+}
+
+// Word operators such as "or" and "mod" lex as keywords but still carry their operator id
+bool Parser::checkOperator(Operator op) {
+  TokenType type = peek().getTokenType();
+  return (type == TokenType::Operator || type == TokenType::Keyword) && peek().getOperator() == op;
+}
+
+ParseError Parser::errorHere(const std::string& message, const std::string& detail) {
+  SourceLocation location = tokens.locate(peek());
+  return ParseError(message + " at line " + std::to_string(location.line) + ":" + std::to_string(location.col) + detail,
+                    location.line, location.col);
+}
+
+void Parser::fail(const std::string& message, const std::string& detail) {
+  if (!recovering) {
+    throw errorHere(message, detail);
+  }
+  if (!panicking) {
+    ParseError error = errorHere(message, detail);
+    diagnostics.push_back(Diagnostic{error.line, error.col, error.what()});
+    panicking = true;
+  }
+}
+
+// Skips past the next ';', or up to the next 'end'
+void Parser::synchronize() {
+  panicking = false;
+  while (!check(TokenType::EoF) && !checkKeyword(Keyword::End)) {
+    if (advance().getSymbol() == Symbol::Semicolon) {
+      return;
+    }
+  }
+}
+
+// In a sequence of statements: skips past the next ';' or `past`, or up to
+// the next 'end', 'elsif' or 'else', which belong to the enclosing statement
+void Parser::synchronizeStatement(Keyword past) {
+  panicking = false;
+  while (!check(TokenType::EoF) && !checkKeyword(Keyword::End) &&
+         !checkKeyword(Keyword::Elsif) && !checkKeyword(Keyword::Else)) {
+    Token token = advance();
+    if (token.getSymbol() == Symbol::Semicolon || (past != Keyword::None && token.getKeyword() == past)) {
+      return;
+    }
+  }
+}
+
+// Skips to the next design unit: 'entity' or 'architecture', but not after 'end'
+void Parser::synchronizeUnit() {
+  panicking = false;
+  bool after_end = false;
+  while (!check(TokenType::EoF)) {
+    if (!after_end && (checkKeyword(Keyword::Entity) || checkKeyword(Keyword::Architecture))) {
+      return;
+    }
+    after_end = checkKeyword(Keyword::End);
+    advance();
+  }
+}
+
 void Parser::expect(TokenType type, const std::string& error_message) {
   if (!match(type)) {
-    throw std::runtime_error(error_message + " at line " + 
-          std::to_string(peek().getLine()) + ":" + std::to_string(peek().getCol()) + " instead got : " + peek().getValue());
+    fail(error_message, " instead got : " + peek().getValue());
+  }
+}
+
+void Parser::expectKeyword(Keyword keyword, const std::string& error_message) {
+  if (!checkKeyword(keyword)) {
+    fail(error_message, " - got '" + peek().getValue() + "'");
+    return;
   }
+  advance();
 }
 
-void Parser::expectKeyword(const std::string& value, const std::string& error_message) {
-  if (peek().getTokenType() != TokenType::Keyword || peek().getValue() != value) {
-    throw std::runtime_error(error_message + " at line " +
-          std::to_string(peek().getLine()) + ":" + std::to_string(peek().getCol()) +
-          " - got '" + peek().getValue() + "'");
+void Parser::expectSymbol(Symbol symbol, const std::string &error_message) {
+  if (!checkSymbol(symbol)) {
+    fail(error_message, " - got '" + peek().getValue() + "'");
+    return;
   }
   advance();
 }
 
-void Parser::expectSymbol(const std::string &value, const std::string &error_message) {
-  if (peek().getTokenType() != TokenType::Symbol || peek().getValue() != value) {
-    throw std::runtime_error(error_message + " at line " +
-          std::to_string(peek().getLine()) + ":" + std::to_string(peek().getCol()) +
-          " - got '" + peek().getValue() + "'");
+void Parser::expectOperator(Operator op, const std::string &error_message) {
+  if (!checkOperator(op)) {
+    fail(error_message, " - got '" + peek().getValue() + "'");
+    return;
   }
   advance();
 }
@@ -78,41 +149,60 @@ VhdlFile& Parser::getTree() {
 }
 
 void Parser::parse() {
-  current = 0;
-  auto tree = parse_vhdl_file();
-  root = std::move(*tree);
+  root = VhdlFile();
+  parse_vhdl_file();
 }
 
-std::unique_ptr<class VhdlFile> Parser::parse_vhdl_file() {
-  auto file = std::make_unique<VhdlFile>();
+const std::vector<Diagnostic>& Parser::parseRecovering() {
+  root = VhdlFile();
+  diagnostics.clear();
+  recovering = true;
+  panicking = false;
+  try {
+    parse_vhdl_file();
+  } catch (const LexError& e) {
+    diagnostics.push_back(Diagnostic{e.line, e.col, e.what()});
+  }
+  recovering = false;
+  panicking = false;
+  return diagnostics;
+}
+
+void Parser::parse_vhdl_file() {
   while (peek().getTokenType() != TokenType::EoF) {
-    if (peek().getValue() == "entity") {
-      auto entity_decl = parse_entity_declaration();
-      file->setEntity(std::move(entity_decl));
+    if (checkKeyword(Keyword::Entity)) {
+      DesignUnit<EntityDeclaration> unit;
+      arena = &unit.arena;
+      unit.declaration = parse_entity_declaration();
+      root.addEntity(std::move(unit));
     } else 
-    if (peek().getValue() == "architecture") {
-      auto archtc_decl = parse_architecture_declaration();
-      file->setArchtc(std::move(archtc_decl));
+    if (checkKeyword(Keyword::Architecture)) {
+      DesignUnit<ArchitectureDeclaration> unit;
+      arena = &unit.arena;
+      unit.declaration = parse_architecture_declaration();
+      root.addArchtc(std::move(unit));
     } else {
       // other -- ignore for now
       advance();
     }
+    if (panicking) {
+      synchronizeUnit();
+    }
   }
-  return file;
 }
 
-std::unique_ptr<class EntityDeclaration> Parser::parse_entity_declaration() {
-  auto entity_decl = std::make_unique<EntityDeclaration>();
+EntityDeclaration* Parser::parse_entity_declaration() {
+  auto entity_decl = arena->make<EntityDeclaration>();
 
   // entity
-  expectKeyword("entity", "Expected 'entity' keyword");
+  expectKeyword(Keyword::Entity, "Expected 'entity' keyword");
 
   // <identifier>
-  entity_decl->setIdentifier(peek().getValue());
+  entity_decl->setIdentifier(peek().getName());
   expect(TokenType::Identifier, "Expected entity name");
 
   // is
-  expectKeyword("is", "Expected 'is' keyword");
+  expectKeyword(Keyword::Is, "Expected 'is' keyword");
 
   // <entity_header>
   entity_decl->setEntityHeader(parse_entity_header());
@@ -121,158 +211,618 @@ std::unique_ptr<class EntityDeclaration> Parser::parse_entity_declaration() {
   // [ begin <entity_statement_part> ] -- add later
 
   // end
-  expectKeyword("end", "Expected 'end' keyword");
+  expectKeyword(Keyword::End, "Expected 'end' keyword");
 
   // [ entity ]
-  matchKeyword("entity");
+  matchKeyword(Keyword::Entity);
   
   // [ <entity_simple_name> ]
   if (check(TokenType::Identifier)) {
-    entity_decl->setSimpleName(peek().getValue());
+    entity_decl->setSimpleName(peek().getName());
     advance();
   }
   
   // ;
-  expectSymbol(";", "Expected ';' symbol");
+  expectSymbol(Symbol::Semicolon, "Expected ';' symbol");
 
   return entity_decl;
 }
 
 
-std::unique_ptr<class ArchitectureDeclaration> Parser::parse_architecture_declaration() {
-  auto archtc_decl = std::make_unique<ArchitectureDeclaration>();
+ArchitectureDeclaration* Parser::parse_architecture_declaration() {
+  auto archtc_decl = arena->make<ArchitectureDeclaration>();
 
   // architecture
-  expectKeyword("architecture", "Expected 'architecture' keyword");
+  expectKeyword(Keyword::Architecture, "Expected 'architecture' keyword");
 
   // <identifier>
-  archtc_decl->setIdentifier(peek().getValue());
+  archtc_decl->setIdentifier(peek().getName());
   expect(TokenType::Identifier, "Expected architecture name");
 
-    // is
-  expectKeyword("is", "Expected 'is' keyword");
+  // of
+  expectKeyword(Keyword::Of, "Expected 'of' keyword");
+
+  // <entity_name>
+  archtc_decl->setEntityName(peek().getName());
+  expect(TokenType::Identifier, "Expected entity name");
+
+  // is
+  expectKeyword(Keyword::Is, "Expected 'is' keyword");
+
+  // <architecture_declarative_part>
+  archtc_decl->setDeclarativePart(parse_architecture_declarative_part());
+
+  // begin
+  expectKeyword(Keyword::Begin, "Expected 'begin' keyword");
+  if (panicking) {
+    synchronizeStatement(Keyword::Begin);
+  }
+
+  // <architecture_statement_part>
+  archtc_decl->setStatements(parse_architecture_statement_part());
+
+  // end
+  expectKeyword(Keyword::End, "Expected 'end' keyword");
+
+  // [ architecture ]
+  matchKeyword(Keyword::Architecture);
+
+  // [ <architecture_simple_name> ]
+  if (check(TokenType::Identifier)) {
+    archtc_decl->setSimpleName(peek().getName());
+    advance();
+  }
+
+  // ;
+  expectSymbol(Symbol::Semicolon, "Expected ';' symbol");
 
   return archtc_decl;
 }
 
 
-std::unique_ptr<class EntityHeader> Parser::parse_entity_header() {
-  auto entity_head = std::make_unique<EntityHeader>();
+EntityHeader* Parser::parse_entity_header() {
+  auto entity_head = arena->make<EntityHeader>();
 
   // [ <formal_generic_clause> ]
-  if (check(TokenType::Keyword) && peek().getValue() == "generic") {
+  if (checkKeyword(Keyword::Generic)) {
     // generic
     advance();
 
     // ( 
-    expectSymbol("(", "Expected '(' symbol");
+    expectSymbol(Symbol::LeftParen, "Expected '(' symbol");
 
     // <generic_list> -- add later
 
   }
   
   // [ <formal_port_clause> ]
-  if (check(TokenType::Keyword) && peek().getValue() == "port") {
+  if (checkKeyword(Keyword::Port)) {
     // port
     advance();
 
     // ( 
-    expectSymbol("(", "Expected '(' symbol");
+    expectSymbol(Symbol::LeftParen, "Expected '(' symbol");
 
     // <Port_list>
     entity_head->setPortList(parse_interface_list());
 
     // )
-    expectSymbol(")", "Expected ')' after port list");
+    expectSymbol(Symbol::RightParen, "Expected ')' after port list");
 
     // ;
-    expectSymbol(";", "Expected ';' after port clause");
+    expectSymbol(Symbol::Semicolon, "Expected ';' after port clause");
   }
 
-  if(peek().getTokenType() == TokenType::EoL) {advance();}
   return entity_head;
 }
 
 
-std::unique_ptr<InterfaceList> Parser::parse_interface_list() {
-  auto intr_list = std::make_unique<InterfaceList>();
+InterfaceList* Parser::parse_interface_list() {
+  auto intr_list = arena->make<InterfaceList>();
+  std::vector<InterfaceElement> elems;
 
   bool expect_more = true;
-  while (expect_more && !(check(TokenType::Symbol) && peek().getValue() == ")")) {
-    intr_list->pushElement(parse_interface_element());
+  while (expect_more && !checkSymbol(Symbol::RightParen)) {
+    elems.push_back(parse_interface_element());
 
-    if (check(TokenType::Symbol) && peek().getValue() == ";") {
+    if (checkSymbol(Symbol::Semicolon)) {
       advance();
 
       // Check if this is a trailing semicolon (i.e., next is ")")
-      if (check(TokenType::Symbol) && peek().getValue() == ")") {
+      if (checkSymbol(Symbol::RightParen)) {
         expect_more = false; // we're done
       }
     } else {
       expect_more = false;
     }
   }
-  
+
+  // Elements are stored contiguously in the arena
+  intr_list->setElements(arena->copy(elems));
   return intr_list;
 }
 
-std::unique_ptr<class InterfaceElement> Parser::parse_interface_element() {
-  auto elem = std::make_unique<InterfaceElement>();
+InterfaceElement Parser::parse_interface_element() {
+  InterfaceElement elem;
 
   // [ variable ], [ signal ], [ constant ]
   if (check(TokenType::Keyword)) {
-    std::string tk_str = peek().getValue();
-    if (tk_str == "constant" || tk_str == "signal" || tk_str == "variable") 
+    Keyword kw = peek().getKeyword();
+    if (kw == Keyword::Constant || kw == Keyword::Signal || kw == Keyword::Variable) 
       advance();
   }
 
   // <identifier_list>
-  elem->setIdentifier(peek().getValue());
+  elem.setIdentifier(peek().getName());
   expect(TokenType::Identifier, "Expected identifier for interface element");
 
   // :
-  expectSymbol(":", "Expected ':' symbol");
+  expectSymbol(Symbol::Colon, "Expected ':' symbol");
 
   // [ <mode> ]
   if (check(TokenType::Keyword)) {
-    std::string tk_str = peek().getValue();
-    if (tk_str == "in" || tk_str == "out" || tk_str == "inout"|| tk_str == "buffer"|| tk_str == "linkage") { 
-      elem->setMode(peek().getValue());
+    Keyword kw = peek().getKeyword();
+    if (kw == Keyword::In || kw == Keyword::Out || kw == Keyword::Inout || kw == Keyword::Buffer || kw == Keyword::Linkage) { 
+      elem.setMode(kw);
       advance();
     }
   }
-  elem->setType(parse_interface_type());
+  elem.setType(parse_interface_type());
 
   return elem;
 }
 
 
-std::unique_ptr<class InterfaceType> Parser::parse_interface_type() {
-  auto intr_type = std::make_unique<InterfaceType>();
+InterfaceType* Parser::parse_interface_type() {
+  auto intr_type = arena->make<InterfaceType>();
 
-  std::string str = peek().getValue();
-  intr_type->setIdentifier(str);
+  static const NameId bit_vector = NameTable::global().intern("bit_vector");
+
+  NameId type_name = peek().getName();
+  intr_type->setIdentifier(type_name);
   expect(TokenType::Identifier, "Expected type name");
 
-  if (str == "bit_vector") {
+  if (type_name == bit_vector) {
     // (
-    expectSymbol("(", "Expected '(' symbol");
+    expectSymbol(Symbol::LeftParen, "Expected '(' symbol");
             
     // Upper bound
-    intr_type->setUpper(peek().getValue());
+    intr_type->setUpper(peek().getName());
     expect(TokenType::Literal, "Expected upper bound");
             
     // downto, to
-    intr_type->setDirection(peek().getValue());
+    intr_type->setDirection(peek().getKeyword());
     expect(TokenType::Keyword, "Expected 'downto' or 'to'");
             
     // Lower bound
-    intr_type->setLower(peek().getValue());
+    intr_type->setLower(peek().getName());
     expect(TokenType::Literal, "Expected lower bound");
             
     // )
-    expectSymbol(")", "Expected ')' symbol");
+    expectSymbol(Symbol::RightParen, "Expected ')' symbol");
   } 
 
   return intr_type;
-}
\ No newline at end of file
+}
+
+ArchitectureDeclarativePart* Parser::parse_architecture_declarative_part() {
+  auto decl_part = arena->make<ArchitectureDeclarativePart>();
+  std::vector<BlockDeclarativeItem*> items;
+
+  // { <block_declarative_item> }
+  while (checkKeyword(Keyword::Signal) || checkKeyword(Keyword::Constant)) {
+    parse_object_declaration(items);
+    if (panicking) {
+      synchronize();
+    }
+  }
+
+  decl_part->setItems(arena->copy(items));
+  return decl_part;
+}
+
+
+void Parser::parse_object_declaration(std::vector<BlockDeclarativeItem*>& items) {
+  // signal, constant, variable
+  Keyword kind = peek().getKeyword();
+  advance();
+
+  // <identifier_list> -- one declaration per identifier
+  size_t first = items.size();
+  do {
+    BlockDeclarativeItem* item;
+    if (kind == Keyword::Signal) {
+      item = arena->make<SignalDeclaration>();
+    } else if (kind == Keyword::Constant) {
+      item = arena->make<ConstantDeclaration>();
+    } else {
+      item = arena->make<VariableDeclaration>();
+    }
+    item->setName(peek().getName());
+    expect(TokenType::Identifier, "Expected object name");
+    items.push_back(item);
+  } while (matchSymbol(Symbol::Comma));
+
+  // :
+  expectSymbol(Symbol::Colon, "Expected ':' symbol");
+
+  // <subtype_indication>
+  InterfaceType* type = parse_interface_type();
+
+  // [ := <expression> ]
+  Expression* value = nullptr;
+  if (matchOperator(Operator::Assign)) {
+    value = parse_expression();
+  }
+
+  // ;
+  expectSymbol(Symbol::Semicolon, "Expected ';' after declaration");
+
+  for (size_t i = first; i < items.size(); i++) {
+    items[i]->setType(type);
+    items[i]->setValue(value);
+  }
+}
+
+
+Span<ConcurrentStatement*> Parser::parse_architecture_statement_part() {
+  std::vector<ConcurrentStatement*> statements;
+
+  // { <concurrent_statement> }
+  while (!checkKeyword(Keyword::End) && !check(TokenType::EoF)) {
+    if (ConcurrentStatement* statement = parse_concurrent_statement()) {
+      statements.push_back(statement);
+    }
+    if (panicking) {
+      synchronize();
+    }
+  }
+
+  return arena->copy(statements);
+}
+
+
+ConcurrentStatement* Parser::parse_concurrent_statement() {
+  // [ <label> : ]
+  NameId label = NO_NAME;
+  if (check(TokenType::Identifier) && tokens.peek(1).getSymbol() == Symbol::Colon) {
+    label = peek().getName();
+    advance();
+    advance();
+  }
+
+  ConcurrentStatement* statement;
+  if (checkKeyword(Keyword::Process) || checkKeyword(Keyword::Postponed)) {
+    statement = parse_process_statement();
+  } else if (check(TokenType::Identifier)) {
+    // <target> <= <waveform> ;
+    auto assignment = arena->make<ConcurrentSignalAssignment>();
+    NameId target = peek().getName();
+    advance();
+    expectOperator(Operator::LessEqual, "Expected '<=' in concurrent signal assignment");
+    assignment->setAssignment(parse_signal_assignment(target));
+    statement = assignment;
+  } else {
+    fail("Unsupported concurrent statement", " - got '" + peek().getValue() + "'");
+    return nullptr;
+  }
+
+  statement->setLabel(label);
+  return statement;
+}
+
+
+ProcessStatement* Parser::parse_process_statement() {
+  auto process = arena->make<ProcessStatement>();
+
+  // [ postponed ] process
+  matchKeyword(Keyword::Postponed);
+  expectKeyword(Keyword::Process, "Expected 'process' keyword");
+
+  // [ ( <sensitivity_list> ) ]
+  if (matchSymbol(Symbol::LeftParen)) {
+    std::vector<NameId> sensitivity;
+    do {
+      sensitivity.push_back(peek().getName());
+      expect(TokenType::Identifier, "Expected signal name in sensitivity list");
+    } while (matchSymbol(Symbol::Comma));
+    expectSymbol(Symbol::RightParen, "Expected ')' after sensitivity list");
+    process->setSensitivity(arena->copy(sensitivity));
+  }
+
+  // [ is ]
+  matchKeyword(Keyword::Is);
+
+  // <process_declarative_part>
+  std::vector<BlockDeclarativeItem*> declarations;
+  while (checkKeyword(Keyword::Variable) || checkKeyword(Keyword::Constant)) {
+    parse_object_declaration(declarations);
+    if (panicking) {
+      synchronize();
+    }
+  }
+  process->setDeclarations(arena->copy(declarations));
+
+  // begin <process_statement_part>
+  expectKeyword(Keyword::Begin, "Expected 'begin' keyword");
+  if (panicking) {
+    synchronizeStatement(Keyword::Begin);
+  }
+  process->setBody(parse_sequence_of_statements());
+
+  // end [ postponed ] process [ <label> ] ;
+  expectKeyword(Keyword::End, "Expected 'end' keyword");
+  matchKeyword(Keyword::Postponed);
+  expectKeyword(Keyword::Process, "Expected 'process' keyword");
+  match(TokenType::Identifier);
+  expectSymbol(Symbol::Semicolon, "Expected ';' after process");
+  if (panicking) {
+    synchronize();
+  }
+
+  return process;
+}
+
+
+Span<SequentialStatement*> Parser::parse_sequence_of_statements() {
+  std::vector<SequentialStatement*> statements;
+
+  while (!checkKeyword(Keyword::End) && !checkKeyword(Keyword::Elsif) &&
+         !checkKeyword(Keyword::Else) && !check(TokenType::EoF)) {
+    if (SequentialStatement* statement = parse_sequential_statement()) {
+      statements.push_back(statement);
+    }
+    if (panicking) {
+      synchronizeStatement();
+    }
+  }
+
+  return arena->copy(statements);
+}
+
+
+SequentialStatement* Parser::parse_sequential_statement() {
+  if (checkKeyword(Keyword::If)) {
+    return parse_if_statement();
+  }
+
+  if (matchKeyword(Keyword::Null)) {
+    expectSymbol(Symbol::Semicolon, "Expected ';' after null");
+    return arena->make<NullStatement>();
+  }
+
+  if (check(TokenType::Identifier)) {
+    NameId target = peek().getName();
+    advance();
+
+    // <target> <= <waveform> ;
+    if (matchOperator(Operator::LessEqual)) {
+      return parse_signal_assignment(target);
+    }
+
+    // <target> := <expression> ;
+    expectOperator(Operator::Assign, "Expected '<=' or ':=' after assignment target");
+    auto assignment = arena->make<VariableAssignment>();
+    assignment->setTarget(target);
+    assignment->setValue(parse_expression());
+    expectSymbol(Symbol::Semicolon, "Expected ';' after assignment");
+    return assignment;
+  }
+
+  fail("Unsupported sequential statement", " - got '" + peek().getValue() + "'");
+  return nullptr;
+}
+
+
+IfStatement* Parser::parse_if_statement() {
+  auto if_stmt = arena->make<IfStatement>();
+  std::vector<IfBranch> branches;
+
+  // if <condition> then <sequence_of_statements>
+  expectKeyword(Keyword::If, "Expected 'if' keyword");
+  do {
+    IfBranch branch;
+    branch.setCondition(parse_expression());
+    expectKeyword(Keyword::Then, "Expected 'then' keyword");
+    if (panicking) {
+      // Carry on with the branch after a bad condition
+      synchronizeStatement(Keyword::Then);
+    }
+    branch.setBody(parse_sequence_of_statements());
+    branches.push_back(branch);
+
+  // { elsif <condition> then <sequence_of_statements> }
+  } while (matchKeyword(Keyword::Elsif));
+
+  // [ else <sequence_of_statements> ]
+  if (matchKeyword(Keyword::Else)) {
+    IfBranch branch;
+    branch.setBody(parse_sequence_of_statements());
+    branches.push_back(branch);
+  }
+
+  // end if ;
+  expectKeyword(Keyword::End, "Expected 'end' keyword");
+  expectKeyword(Keyword::If, "Expected 'if' keyword");
+  expectSymbol(Symbol::Semicolon, "Expected ';' after if statement");
+  if (panicking) {
+    synchronize();
+  }
+
+  if_stmt->setBranches(arena->copy(branches));
+  return if_stmt;
+}
+
+
+// Parses what follows `<target> <=`, up to and including the ';'.
+SignalAssignment* Parser::parse_signal_assignment(NameId target) {
+  auto assignment = arena->make<SignalAssignment>();
+  assignment->setTarget(target);
+
+  // [ transport | inertial ]
+  if (matchKeyword(Keyword::Transport)) {
+    assignment->setTransport(true);
+  } else {
+    matchKeyword(Keyword::Inertial);
+  }
+
+  // <waveform> ;
+  assignment->setWaveform(parse_waveform());
+  expectSymbol(Symbol::Semicolon, "Expected ';' after signal assignment");
+
+  return assignment;
+}
+
+
+Span<WaveformElement> Parser::parse_waveform() {
+  std::vector<WaveformElement> elements;
+
+  // <waveform_element> { , <waveform_element> }
+  do {
+    WaveformElement element;
+    element.setValue(parse_expression());
+    if (matchKeyword(Keyword::After)) {
+      element.setAfter(parse_expression());
+    }
+    elements.push_back(element);
+  } while (matchSymbol(Symbol::Comma));
+
+  return arena->copy(elements);
+}
+
+
+// Precedence levels of the binary operators, loosest first
+enum : int { LOGICAL = 1, RELATIONAL, SHIFT, ADDING, MULTIPLYING };
+
+// Level of a binary operator; 0 if `op` is not one.
+static int precedence(Operator op) {
+  switch (op) {
+    case Operator::And: case Operator::Or: case Operator::Xor:
+    case Operator::Nand: case Operator::Nor: case Operator::Xnor:
+      return LOGICAL;
+    case Operator::Equal: case Operator::NotEqual: case Operator::Less:
+    case Operator::LessEqual: case Operator::Greater: case Operator::GreaterEqual:
+      return RELATIONAL;
+    case Operator::Sll: case Operator::Srl: case Operator::Sla:
+    case Operator::Sra: case Operator::Rol: case Operator::Ror:
+      return SHIFT;
+    case Operator::Plus: case Operator::Minus: case Operator::Concat:
+      return ADDING;
+    case Operator::Multiply: case Operator::Divide: case Operator::Mod: case Operator::Rem:
+      return MULTIPLYING;
+    default:
+      return 0;
+  }
+}
+
+
+// Parses a full expression into the scratch run and copies it to the arena
+// in one piece. Returns its root, or null after a recovered syntax error.
+Expression* Parser::parse_expression() {
+  expression_nodes.clear();
+  parse_operators(LOGICAL);
+  if (panicking) {
+    return nullptr;
+  }
+  Span<Expression> run = arena->copy(expression_nodes);
+  return &run[run.size() - 1];
+}
+
+// Appends `node` to the run, unless a syntax error has left its operands
+// missing.
+void Parser::emit(const Expression& node) {
+  if (!panicking) {
+    expression_nodes.push_back(node);
+  }
+}
+
+// Size of the subtree ending at the current end of the run
+uint32_t Parser::last_size() const {
+  return panicking ? 0 : expression_nodes.back().size;
+}
+
+// Precedence climbing over the binary operators binding at least as tightly
+// as `min_level`. The right operand of an operator takes only tighter ones,
+// so whatever follows it binds no tighter than the operator itself: logical,
+// adding and multiplying operators associate to the left, and a relational
+// or shift operator takes no second one of its level, so `a = b = c` is left
+// for the caller to reject as the grammar does. A sign applies to the whole
+// term after it.
+void Parser::parse_operators(int min_level) {
+  size_t start = expression_nodes.size();
+  if (min_level <= ADDING && (checkOperator(Operator::Plus) || checkOperator(Operator::Minus))) {
+    Operator sign = advance().getOperator();
+    parse_operators(MULTIPLYING);
+    emit(Expression::unary(sign, last_size()));
+  } else {
+    parse_factor();
+  }
+
+  int max_level = MULTIPLYING;
+  while (true) {
+    int level = precedence(peek().getOperator());
+    if (level < min_level || level > max_level) {
+      return;
+    }
+    Operator op = advance().getOperator();
+    uint32_t left_size = panicking ? 0 : static_cast<uint32_t>(expression_nodes.size() - start);
+    parse_operators(level + 1);
+    emit(Expression::binary(op, left_size, last_size()));
+    max_level = level == RELATIONAL || level == SHIFT ? level - 1 : level;
+  }
+}
+
+// <primary> [ ** <primary> ] | abs <primary> | not <primary>
+void Parser::parse_factor() {
+  if (checkOperator(Operator::Not) || checkOperator(Operator::Abs)) {
+    Operator op = advance().getOperator();
+    parse_primary();
+    emit(Expression::unary(op, last_size()));
+    return;
+  }
+
+  parse_primary();
+  if (matchOperator(Operator::Power)) {
+    uint32_t left_size = last_size();
+    parse_primary();
+    emit(Expression::binary(Operator::Power, left_size, last_size()));
+  }
+}
+
+void Parser::parse_primary() {
+  // <name>
+  if (check(TokenType::Identifier)) {
+    emit(Expression::name(peek().getName()));
+    advance();
+    return;
+  }
+
+  // <literal>, or a physical literal such as `5 ns`
+  if (check(TokenType::Literal)) {
+    NameId text = peek().getName();
+    NameId unit = NO_NAME;
+    bool numeric = asciiDigit(peek().getText()[0]);
+    advance();
+    if (numeric && check(TokenType::Identifier)) {
+      unit = peek().getName();
+      advance();
+    }
+    emit(Expression::literal(text, unit));
+    return;
+  }
+
+  // ( others => <expression> ) | ( <expression> )
+  if (matchSymbol(Symbol::LeftParen)) {
+    if (matchKeyword(Keyword::Others)) {
+      expectOperator(Operator::Arrow, "Expected '=>' after 'others'");
+      parse_operators(LOGICAL);
+      emit(Expression::aggregate(last_size()));
+    } else {
+      parse_operators(LOGICAL);
+    }
+    expectSymbol(Symbol::RightParen, "Expected ')' symbol");
+    return;
+  }
+
+  fail("Expected expression", " - got '" + peek().getValue() + "'");
+}
@@ -5,46 +5,97 @@
 #include <memory>
 #include <stdexcept>
 #include "Token.h"
+#include "TokenStream.h"
 #include "Node.h"
+#include "Expression.h"
 
+// A syntax error, with the position of the token the parser stopped at.
+class ParseError : public std::runtime_error {
+public:
+  ParseError(const std::string& message, int line, int col)
+    : std::runtime_error(message), line(line), col(col) {}
+
+  int line;
+  int col;
+};
+
+// A syntax or lexing error reported by a recovering parse.
+struct Diagnostic {
+  int line = 0;  // 1-based
+  int col  = 0;  // 0-based, as in tokens
+  std::string message;
+};
 
 class Parser {
 public:
-  Parser(const std::vector<Token>& tokens);
+  // The parser pulls tokens from `tokens` as it needs them.
+  explicit Parser(TokenStream& tokens);
+
+  // Throws ParseError at the first syntax error (LexError at a lexing one).
   void parse(); 
 
+  // Parses the whole input without throwing on errors. Each syntax error is
+  // recorded, the parser skips to the next ';' or 'end' and carries on, and
+  // the tree keeps whatever was parsed, with null where a part was missing.
+  // A lexing error ends the input. Returns the errors in input order; the
+  // tree is complete only if there are none.
+  const std::vector<Diagnostic>& parseRecovering();
+
   VhdlFile& getTree();
 
 private:
-  std::vector<Token> tokens;
-  size_t current;
+  TokenStream& tokens;
+
+  // Arena of the design unit currently being parsed
+  Arena* arena = nullptr;
 
   VhdlFile root;
 
+  // Recovering mode. From an error until the parser resynchronizes, peek()
+  // reports end of input, so every rule returns at once -- as if an
+  // exception were unwinding -- up to the innermost construct that skips
+  // ahead and clears `panicking`: a declaration or statement list, an `if`
+  // condition, or the `end ... ;` closing a statement.
+  bool recovering = false;
+  bool panicking  = false;
+  std::vector<Diagnostic> diagnostics;
+  const Token end_of_input;
 
   // Utility functions
-  Token peek() const;
+  const Token& peek();
   Token advance();
   bool match(TokenType type);
-  bool matchKeyword(const std::string &value);
-  bool matchSymbol(const std::string &value);
-  bool check(TokenType type) const;
+  bool matchKeyword(Keyword keyword);
+  bool matchSymbol(Symbol symbol);
+  bool matchOperator(Operator op);
+  bool check(TokenType type);
+  bool checkKeyword(Keyword keyword);
+  bool checkSymbol(Symbol symbol);
+  bool checkOperator(Operator op);
   void expect(TokenType type, const std::string& error_message);
-  void expectKeyword(const std::string &value, const std::string &error_message);
-  void expectSymbol(const std::string &value, const std::string &error_message);
+  void expectKeyword(Keyword keyword, const std::string &error_message);
+  void expectSymbol(Symbol symbol, const std::string &error_message);
+  void expectOperator(Operator op, const std::string &error_message);
+  // `message` at the position of the current token, followed by `detail`
+  ParseError errorHere(const std::string& message, const std::string& detail);
+  // Throws errorHere(), or records it when recovering
+  void fail(const std::string& message, const std::string& detail);
+  void synchronize();
+  void synchronizeStatement(Keyword past = Keyword::None);
+  void synchronizeUnit();
 
   // Recursive-descent parsing functions
-  std::unique_ptr<class VhdlFile> parse_vhdl_file();
-  std::unique_ptr<class EntityDeclaration> parse_entity_declaration();
-  std::unique_ptr<class EntityHeader> parse_entity_header();
-  std::unique_ptr<class InterfaceList> parse_interface_list();
-  std::unique_ptr<class ArchitectureDeclaration>parse_architecture_declaration();
+  void parse_vhdl_file();
+  EntityDeclaration* parse_entity_declaration();
+  EntityHeader* parse_entity_header();
+  InterfaceList* parse_interface_list();
+  ArchitectureDeclaration* parse_architecture_declaration();
   void parse_entity_declarative_part();
   void parse_entity_statement_part();
   void parse_entity_statement();
 
   // Interface related functions
-  std::unique_ptr<class InterfaceElement> parse_interface_element();
+  InterfaceElement parse_interface_element();
   void parse_interface_declaration();
   void parse_interface_object_declaration();
   void parse_interface_constant_declaration();
@@ -62,9 +113,30 @@ private:
   void parse_array_mode_view_indication();
 
   // Type and expression related functions
-  std::unique_ptr<class InterfaceType> parse_interface_type();
+  InterfaceType* parse_interface_type();
   void parse_subtype_indication();
   void parse_static_conditional_expression();
   void parse_signal_mode_indication();
   void parse_identifier_list();
+
+  // Architecture body related functions
+  ArchitectureDeclarativePart* parse_architecture_declarative_part();
+  void parse_object_declaration(std::vector<BlockDeclarativeItem*>& items);
+  Span<ConcurrentStatement*> parse_architecture_statement_part();
+  ConcurrentStatement* parse_concurrent_statement();
+  ProcessStatement* parse_process_statement();
+  Span<SequentialStatement*> parse_sequence_of_statements();
+  SequentialStatement* parse_sequential_statement();
+  IfStatement* parse_if_statement();
+  SignalAssignment* parse_signal_assignment(NameId target);
+  Span<WaveformElement> parse_waveform();
+
+  // Expressions: precedence climbing into a postfix run of nodes
+  std::vector<Expression> expression_nodes;  // the run being parsed
+  Expression* parse_expression();
+  void parse_operators(int min_level);
+  void parse_factor();
+  void parse_primary();
+  void emit(const Expression& node);
+  uint32_t last_size() const;
 };
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "Profile.h"
+#include <algorithm>
+#include <iomanip>
+
+Profiler* Profiler::installed = nullptr;
+
+Profiler::Profiler() : origin(Clock::now()) {}
+
+void Profiler::addSpan(const char* name, Clock::time_point start, Clock::time_point end) {
+  std::lock_guard<std::mutex> lock(mutex);
+  uint32_t thread = threads.emplace(std::this_thread::get_id(), static_cast<uint32_t>(threads.size())).first->second;
+  spans.push_back(Span{name, thread, static_cast<uint64_t>(std::chrono::nanoseconds(start - origin).count()),
+                       static_cast<uint64_t>(std::chrono::nanoseconds(end - start).count())});
+}
+
+uint64_t& Profiler::counter(const std::string& name) {
+  for (auto& entry : counters) {
+    if (entry.first == name) {
+      return entry.second;
+    }
+  }
+  counters.emplace_back(name, 0);
+  return counters.back().second;
+}
+
+void Profiler::count(const std::string& name, uint64_t amount) {
+  std::lock_guard<std::mutex> lock(mutex);
+  counter(name) += amount;
+}
+
+void Profiler::setCount(const std::string& name, uint64_t value) {
+  std::lock_guard<std::mutex> lock(mutex);
+  counter(name) = value;
+}
+
+void Profiler::addProcess(std::string name, uint64_t runs, uint64_t nanoseconds) {
+  std::lock_guard<std::mutex> lock(mutex);
+  processes.push_back(ProcessTime{std::move(name), runs, nanoseconds});
+}
+
+void Profiler::writeSummary(std::ostream& out) const {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::ios_base::fmtflags flags = out.flags();
+  std::streamsize precision = out.precision();
+  out << std::fixed;
+
+  // Phases by name, in order of first appearance
+  struct Total {
+    const char* name;
+    uint64_t calls;
+    uint64_t nanoseconds;
+  };
+  std::vector<Total> totals;
+  for (const Span& span : spans) {
+    auto it = std::find_if(totals.begin(), totals.end(),
+                           [&span](const Total& total) { return std::string(total.name) == span.name; });
+    if (it == totals.end()) {
+      totals.push_back(Total{span.name, 0, 0});
+      it = totals.end() - 1;
+    }
+    it->calls++;
+    it->nanoseconds += span.duration_ns;
+  }
+  out << std::left << std::setw(28) << "phase" << std::right << std::setw(10) << "calls" << std::setw(14) << "total ms" << "\n";
+  for (const Total& total : totals) {
+    out << std::left << std::setw(28) << total.name << std::right << std::setw(10) << total.calls
+        << std::setw(14) << std::setprecision(3) << total.nanoseconds / 1e6 << "\n";
+  }
+
+  if (!counters.empty()) {
+    out << "\n" << std::left << std::setw(28) << "counter" << std::right << std::setw(24) << "value" << "\n";
+    for (const auto& entry : counters) {
+      out << std::left << std::setw(28) << entry.first << std::right << std::setw(24) << entry.second << "\n";
+    }
+  }
+
+  if (!processes.empty()) {
+    std::vector<const ProcessTime*> slowest;
+    uint64_t all = 0;
+    for (const ProcessTime& process : processes) {
+      slowest.push_back(&process);
+      all += process.nanoseconds;
+    }
+    std::stable_sort(slowest.begin(), slowest.end(), [](const ProcessTime* a, const ProcessTime* b) {
+      return a->nanoseconds > b->nanoseconds;
+    });
+    if (slowest.size() > SUMMARY_PROCESSES) {
+      slowest.resize(SUMMARY_PROCESSES);
+    }
+    out << "\n" << std::left << std::setw(40) << "process" << std::right << std::setw(12) << "runs"
+        << std::setw(14) << "total ms" << std::setw(12) << "ns/run" << std::setw(9) << "share" << "\n";
+    for (const ProcessTime* process : slowest) {
+      out << std::left << std::setw(40) << process->name << std::right << std::setw(12) << process->runs
+          << std::setw(14) << std::setprecision(3) << process->nanoseconds / 1e6
+          << std::setw(12) << std::setprecision(0) << (process->runs ? double(process->nanoseconds) / process->runs : 0.0)
+          << std::setw(8) << std::setprecision(1) << (all ? 100.0 * process->nanoseconds / all : 0.0) << "%\n";
+    }
+    if (processes.size() > slowest.size()) {
+      out << "(" << processes.size() - slowest.size() << " more processes)\n";
+    }
+  }
+
+  out.flags(flags);
+  out.precision(precision);
+}
+
+static std::string jsonString(const std::string& text) {
+  std::string quoted = "\"";
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+      quoted += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      const char* hex = "0123456789abcdef";
+      quoted += "\\u00";
+      quoted += hex[(c >> 4) & 0xF];
+      quoted += hex[c & 0xF];
+    } else {
+      quoted += c;
+    }
+  }
+  return quoted + "\"";
+}
+
+void Profiler::writeChromeTrace(std::ostream& out) const {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::ios_base::fmtflags flags = out.flags();
+  std::streamsize precision = out.precision();
+  out << std::fixed << std::setprecision(3);
+
+  // Timestamps are in microseconds
+  uint64_t end_ns = 0;
+  out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+  out << "  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"vhdl_sim\"}}";
+  for (const Span& span : spans) {
+    out << ",\n  {\"name\": " << jsonString(span.name) << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << span.thread
+        << ", \"ts\": " << span.start_ns / 1e3 << ", \"dur\": " << span.duration_ns / 1e3 << "}";
+    end_ns = std::max(end_ns, span.start_ns + span.duration_ns);
+  }
+  for (const auto& entry : counters) {
+    out << ",\n  {\"name\": " << jsonString(entry.first) << ", \"ph\": \"C\", \"pid\": 1, \"tid\": 0, \"ts\": "
+        << end_ns / 1e3 << ", \"args\": {\"value\": " << entry.second << "}}";
+  }
+  if (!processes.empty()) {
+    out << ",\n  {\"name\": \"process totals\", \"ph\": \"i\", \"s\": \"g\", \"pid\": 1, \"tid\": 0, \"ts\": "
+        << end_ns / 1e3 << ", \"args\": {";
+    for (size_t i = 0; i < processes.size(); i++) {
+      out << (i ? ", " : "") << jsonString(processes[i].name) << ": {\"runs\": " << processes[i].runs
+          << ", \"total_us\": " << processes[i].nanoseconds / 1e3 << "}";
+    }
+    out << "}}";
+  }
+  out << "\n]}\n";
+
+  out.flags(flags);
+  out.precision(precision);
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Built-in profiling: timed phases and named counters, collected by the
+// installed Profiler and reported as a summary table or as a Chrome trace
+// (chrome://tracing, Perfetto).
+//
+// ProfileScope times a phase around a block. With no profiler installed it
+// costs one load and a branch, so scopes stay in the code permanently; they
+// belong around phases and files, not inside per-event loops. Hot counters
+// (events, delta cycles, per-process runs) are kept by their owners and
+// handed over with count() and addProcess() once a phase is over.
+class Profiler {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  Profiler();
+
+  // The profiler phases and counters report to, or null when profiling is off.
+  static Profiler* current() {
+    return installed;
+  }
+
+  // Makes `profiler` (or null) current. Not synchronized: install before any
+  // profiled work starts and uninstall after it has finished.
+  static void install(Profiler* profiler) {
+    installed = profiler;
+  }
+
+  // Records a phase that ran on the calling thread. Thread-safe.
+  void addSpan(const char* name, Clock::time_point start, Clock::time_point end);
+
+  // Adds `amount` to a counter, which is created on first use. Thread-safe.
+  void count(const std::string& name, uint64_t amount);
+
+  // Sets a counter that records a maximum or a size rather than a sum.
+  void setCount(const std::string& name, uint64_t value);
+
+  // Time spent evaluating one process of the design.
+  void addProcess(std::string name, uint64_t runs, uint64_t nanoseconds);
+
+  // Phases totalled by name, counters, and the processes that took longest.
+  void writeSummary(std::ostream& out) const;
+
+  // Trace Event Format: one complete event per phase, counters as counter
+  // events at the end of the run, and process totals in the arguments of a
+  // final instant event.
+  void writeChromeTrace(std::ostream& out) const;
+
+  // Processes listed in the summary.
+  static constexpr size_t SUMMARY_PROCESSES = 20;
+
+private:
+  struct Span {
+    const char* name;
+    uint32_t    thread;     // small index in order of first appearance
+    uint64_t    start_ns;   // since the profiler was created
+    uint64_t    duration_ns;
+  };
+
+  struct ProcessTime {
+    std::string name;
+    uint64_t    runs;
+    uint64_t    nanoseconds;
+  };
+
+  static Profiler* installed;
+
+  Clock::time_point origin;
+  mutable std::mutex mutex;
+  std::vector<Span> spans;
+  std::unordered_map<std::thread::id, uint32_t> threads;
+  std::vector<std::pair<std::string, uint64_t>> counters;  // in order of creation
+  std::vector<ProcessTime> processes;
+
+  uint64_t& counter(const std::string& name);
+};
+
+// Times the enclosing block as a phase of the current profiler, if any.
+class ProfileScope {
+public:
+  explicit ProfileScope(const char* name) : profiler(Profiler::current()), name(name) {
+    if (profiler) {
+      start = Profiler::Clock::now();
+    }
+  }
+
+  ~ProfileScope() {
+    if (profiler) {
+      profiler->addSpan(name, start, Profiler::Clock::now());
+    }
+  }
+
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+  Profiler* profiler;
+  const char* name;
+  Profiler::Clock::time_point start;
+};
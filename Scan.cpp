@@ -0,0 +1,236 @@
+#include "Scan.h"
+#include <atomic>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define VHDL_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+// ---------------------------------------------------------------------------
+// Scalar backend: one byte per step.
+
+static size_t scalarIdentifier(const char* data, size_t pos, size_t end) {
+  while (pos < end && (asciiAlnum(data[pos]) || data[pos] == '_')) pos++;
+  return pos;
+}
+
+static size_t scalarBlanks(const char* data, size_t pos, size_t end) {
+  while (pos < end && (data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\r')) pos++;
+  return pos;
+}
+
+static size_t scalarToNewline(const char* data, size_t pos, size_t end) {
+  while (pos < end && data[pos] != '\n') pos++;
+  return pos;
+}
+
+static size_t scalarToQuote(const char* data, size_t pos, size_t end) {
+  while (pos < end && data[pos] != '"') pos++;
+  return pos;
+}
+
+#ifdef VHDL_SCAN_X86
+
+// ---------------------------------------------------------------------------
+// SSE2 backend: 16 bytes per step. Bytes >= 0x80 compare as negative, so the
+// signed range checks below never accept them.
+
+static inline __m128i sse2InRange(__m128i x, char lo, char hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8(static_cast<char>(lo - 1))),
+                       _mm_cmplt_epi8(x, _mm_set1_epi8(static_cast<char>(hi + 1))));
+}
+
+// Bit i is set when byte i ends the run.
+static inline unsigned sse2IdentifierStops(__m128i x) {
+  __m128i lower = _mm_or_si128(x, _mm_set1_epi8(0x20));
+  __m128i alpha = sse2InRange(lower, 'a', 'z');
+  __m128i digit = sse2InRange(x, '0', '9');
+  __m128i under = _mm_cmpeq_epi8(x, _mm_set1_epi8('_'));
+  __m128i ident = _mm_or_si128(alpha, _mm_or_si128(digit, under));
+  return ~static_cast<unsigned>(_mm_movemask_epi8(ident)) & 0xFFFFu;
+}
+
+static inline unsigned sse2BlankStops(__m128i x) {
+  __m128i blank = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')),
+                  _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\t')),
+                               _mm_cmpeq_epi8(x, _mm_set1_epi8('\r'))));
+  return ~static_cast<unsigned>(_mm_movemask_epi8(blank)) & 0xFFFFu;
+}
+
+static size_t sse2Identifier(const char* data, size_t pos, size_t end) {
+  // Most identifiers are short; only switch to vectors once the run is long.
+  for (size_t stop = pos + 8; pos < end && pos < stop; pos++) {
+    if (!(asciiAlnum(data[pos]) || data[pos] == '_')) return pos;
+  }
+  while (pos + 16 <= end) {
+    unsigned stops = sse2IdentifierStops(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos)));
+    if (stops) return pos + static_cast<size_t>(__builtin_ctz(stops));
+    pos += 16;
+  }
+  return scalarIdentifier(data, pos, end);
+}
+
+static size_t sse2Blanks(const char* data, size_t pos, size_t end) {
+  while (pos + 16 <= end) {
+    unsigned stops = sse2BlankStops(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos)));
+    if (stops) return pos + static_cast<size_t>(__builtin_ctz(stops));
+    pos += 16;
+  }
+  return scalarBlanks(data, pos, end);
+}
+
+static inline size_t sse2FindByte(const char* data, size_t pos, size_t end, char byte) {
+  __m128i needle = _mm_set1_epi8(byte);
+  while (pos + 16 <= end) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+    unsigned hits = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, needle)));
+    if (hits) return pos + static_cast<size_t>(__builtin_ctz(hits));
+    pos += 16;
+  }
+  while (pos < end && data[pos] != byte) pos++;
+  return pos;
+}
+
+static size_t sse2ToNewline(const char* data, size_t pos, size_t end) {
+  return sse2FindByte(data, pos, end, '\n');
+}
+
+static size_t sse2ToQuote(const char* data, size_t pos, size_t end) {
+  return sse2FindByte(data, pos, end, '"');
+}
+
+// ---------------------------------------------------------------------------
+// AVX2 backend: 32 bytes per step, compiled for AVX2 only in these functions
+// so the rest of the program keeps running on CPUs without it.
+
+#define VHDL_AVX2 __attribute__((target("avx2")))
+
+VHDL_AVX2 static inline __m256i avx2InRange(__m256i x, char lo, char hi) {
+  return _mm256_and_si256(_mm256_cmpgt_epi8(x, _mm256_set1_epi8(static_cast<char>(lo - 1))),
+                          _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(hi + 1)), x));
+}
+
+VHDL_AVX2 static size_t avx2Identifier(const char* data, size_t pos, size_t end) {
+  for (size_t stop = pos + 8; pos < end && pos < stop; pos++) {
+    if (!(asciiAlnum(data[pos]) || data[pos] == '_')) return pos;
+  }
+  while (pos + 32 <= end) {
+    __m256i x     = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+    __m256i lower = _mm256_or_si256(x, _mm256_set1_epi8(0x20));
+    __m256i ident = _mm256_or_si256(avx2InRange(lower, 'a', 'z'),
+                    _mm256_or_si256(avx2InRange(x, '0', '9'),
+                                    _mm256_cmpeq_epi8(x, _mm256_set1_epi8('_'))));
+    unsigned stops = ~static_cast<unsigned>(_mm256_movemask_epi8(ident));
+    if (stops) return pos + static_cast<size_t>(__builtin_ctz(stops));
+    pos += 32;
+  }
+  return sse2Identifier(data, pos, end);
+}
+
+VHDL_AVX2 static size_t avx2Blanks(const char* data, size_t pos, size_t end) {
+  while (pos + 32 <= end) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+    __m256i blank = _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\t')),
+                                    _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\r'))));
+    unsigned stops = ~static_cast<unsigned>(_mm256_movemask_epi8(blank));
+    if (stops) return pos + static_cast<size_t>(__builtin_ctz(stops));
+    pos += 32;
+  }
+  return sse2Blanks(data, pos, end);
+}
+
+VHDL_AVX2 static inline size_t avx2FindByte(const char* data, size_t pos, size_t end, char byte) {
+  __m256i needle = _mm256_set1_epi8(byte);
+  while (pos + 32 <= end) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+    unsigned hits = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, needle)));
+    if (hits) return pos + static_cast<size_t>(__builtin_ctz(hits));
+    pos += 32;
+  }
+  return sse2FindByte(data, pos, end, byte);
+}
+
+VHDL_AVX2 static size_t avx2ToNewline(const char* data, size_t pos, size_t end) {
+  return avx2FindByte(data, pos, end, '\n');
+}
+
+VHDL_AVX2 static size_t avx2ToQuote(const char* data, size_t pos, size_t end) {
+  return avx2FindByte(data, pos, end, '"');
+}
+
+#endif // VHDL_SCAN_X86
+
+// ---------------------------------------------------------------------------
+// Dispatch
+
+static const ScanKernels SCALAR_KERNELS = {
+  ScanBackend::Scalar, scalarIdentifier, scalarBlanks, scalarToNewline, scalarToQuote,
+};
+
+#ifdef VHDL_SCAN_X86
+static const ScanKernels SSE2_KERNELS = {
+  ScanBackend::SSE2, sse2Identifier, sse2Blanks, sse2ToNewline, sse2ToQuote,
+};
+
+static const ScanKernels AVX2_KERNELS = {
+  ScanBackend::AVX2, avx2Identifier, avx2Blanks, avx2ToNewline, avx2ToQuote,
+};
+#endif
+
+static const ScanKernels* kernelsFor(ScanBackend backend) {
+  switch (backend) {
+#ifdef VHDL_SCAN_X86
+    case ScanBackend::AVX2: return &AVX2_KERNELS;
+    case ScanBackend::SSE2: return &SSE2_KERNELS;
+#endif
+    default:                return &SCALAR_KERNELS;
+  }
+}
+
+static const ScanKernels* detectKernels() {
+#ifdef VHDL_SCAN_X86
+  if (scanBackendSupported(ScanBackend::AVX2)) return &AVX2_KERNELS;
+  if (scanBackendSupported(ScanBackend::SSE2)) return &SSE2_KERNELS;
+#endif
+  return &SCALAR_KERNELS;
+}
+
+static std::atomic<const ScanKernels*> active_kernels{nullptr};
+
+const ScanKernels& scanKernels() {
+  const ScanKernels* kernels = active_kernels.load(std::memory_order_acquire);
+  if (!kernels) {
+    kernels = detectKernels();
+    active_kernels.store(kernels, std::memory_order_release);
+  }
+  return *kernels;
+}
+
+bool scanBackendSupported(ScanBackend backend) {
+  switch (backend) {
+    case ScanBackend::Scalar: return true;
+#ifdef VHDL_SCAN_X86
+    case ScanBackend::SSE2:   return __builtin_cpu_supports("sse2");
+    case ScanBackend::AVX2:   return __builtin_cpu_supports("avx2");
+#endif
+    default:                  return false;
+  }
+}
+
+bool setScanBackend(ScanBackend backend) {
+  if (!scanBackendSupported(backend)) {
+    return false;
+  }
+  active_kernels.store(kernelsFor(backend), std::memory_order_release);
+  return true;
+}
+
+const char* scanBackendName(ScanBackend backend) {
+  switch (backend) {
+    case ScanBackend::Scalar: return "scalar";
+    case ScanBackend::SSE2:   return "sse2";
+    case ScanBackend::AVX2:   return "avx2";
+    default:                  return "unknown";
+  }
+}
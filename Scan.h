@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+
+// Byte-run scanners used by the lexer. Each kernel returns the index of the
+// first byte in [pos, end) that does not belong to the run (or `end`). The
+// vector backends look at 16 (SSE2) or 32 (AVX2) bytes per step and fall back
+// to the scalar loop for the tail, so they never read past `end`.
+
+enum class ScanBackend {
+  Scalar, SSE2, AVX2,
+};
+
+struct ScanKernels {
+  ScanBackend backend;
+  // [A-Za-z0-9_]*
+  size_t (*identifier)(const char* data, size_t pos, size_t end);
+  // [ \t\r]*
+  size_t (*blanks)(const char* data, size_t pos, size_t end);
+  // up to the next '\n' (comment bodies)
+  size_t (*toNewline)(const char* data, size_t pos, size_t end);
+  // up to the next '"' (string literal bodies)
+  size_t (*toQuote)(const char* data, size_t pos, size_t end);
+};
+
+// Kernels for the best backend the CPU supports, chosen on first use.
+const ScanKernels& scanKernels();
+
+// Forces a backend (used by the benchmark); returns false if the CPU or the
+// build does not support it, leaving the current selection untouched.
+bool setScanBackend(ScanBackend backend);
+bool scanBackendSupported(ScanBackend backend);
+const char* scanBackendName(ScanBackend backend);
+
+// Locale-independent ASCII classification.
+inline bool asciiAlpha(char c) {
+  return static_cast<unsigned char>((c | 0x20) - 'a') < 26;
+}
+
+inline bool asciiDigit(char c) {
+  return static_cast<unsigned char>(c - '0') < 10;
+}
+
+inline bool asciiAlnum(char c) {
+  return asciiAlpha(c) || asciiDigit(c);
+}
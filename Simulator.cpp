@@ -0,0 +1,397 @@
+#include "Simulator.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+Simulator::Simulator(const Design& design, const NativeModule* native, ThreadPool* pool)
+  : design(design), native(native), pool(pool) {
+  for (const SignalInfo& signal : design.signals) {
+    values.push_back(signal.initial);
+  }
+  next_values = values;
+  last_events.assign(values.size(), NO_EVENT);
+  signal_flags.assign(values.size(), 0);
+  drivers.resize(values.size());
+
+  variables.resize(design.processes.size());
+  registers.resize(design.processes.size());
+  for (size_t p = 0; p < design.processes.size(); p++) {
+    programs.push_back(compileProcess(design, design.processes[p]));
+    registers[p] = programs[p].registers;
+    for (const VariableInfo& variable : design.processes[p].variables) {
+      variables[p].push_back(variable.initial);
+    }
+  }
+  runnable_flags.assign(design.processes.size(), 0);
+  outputs.resize(1);
+
+  if (native) {
+    native_state = native->createState();
+    for (Value& value : values) {
+      native_scalars.push_back(&value.scalar);
+      native_words.push_back(value.bits.words());
+    }
+    native_kernel.scalars  = native_scalars.data();
+    native_kernel.words    = native_words.data();
+    native_kernel.kernel   = nullptr;  // set per run to the run's ProcessOutput
+    native_kernel.schedule = nativeSchedule;
+    native_kernel.fail     = nativeFail;
+  }
+}
+
+Simulator::~Simulator() {
+  if (native_state) {
+    native->destroyState(native_state);
+  }
+}
+
+void Simulator::nativeSchedule(void* kernel, uint32_t signal, uint32_t flags, int64_t delay,
+                               int64_t scalar, const uint64_t* words) {
+  ProcessOutput& output = *static_cast<ProcessOutput*>(kernel);
+  const Value& initial = output.simulator->values[signal];
+  Value value;
+  value.kind = initial.kind;
+  if (words) {
+    value.bits = BitVector(initial.bits.width());
+    std::memcpy(value.bits.words(), words, value.bits.wordCount() * sizeof(uint64_t));
+  } else {
+    value.scalar = scalar;
+  }
+  output.scheduled.push_back(ScheduledValue{signal, static_cast<uint8_t>(flags), delay, std::move(value)});
+}
+
+void Simulator::nativeFail(void*, const char* message) {
+  throw std::runtime_error(message);
+}
+
+void Simulator::drive(uint32_t signal, const Value& value, SimTime time) {
+  const SignalInfo& info = design.signals[signal];
+  if (info.driver >= 0) {
+    throw std::runtime_error("'" + NameTable::global().str(info.name) + "' is driven by a process");
+  }
+  if (time < current_time) {
+    throw std::runtime_error("cannot drive '" + NameTable::global().str(info.name) + "' in the past");
+  }
+  checkAssignable(info.type, value, info.name);
+  schedule(signal, value, time, true, true);
+}
+
+void Simulator::schedule(uint32_t signal, Value value, SimTime time, bool preempt, bool transport) {
+  std::deque<Transaction>& driver = drivers[signal];
+
+  if (preempt) {
+    // A new first waveform element replaces everything projected at or after its time
+    while (!driver.empty() && driver.back().time >= time) {
+      driver.pop_back();
+    }
+    // Inertial delay also rejects earlier pending pulses, except the run of
+    // transactions just before it that already carry the new value
+    if (!transport) {
+      size_t keep = driver.size();
+      while (keep > 0 && driver[keep - 1].value == value) {
+        keep--;
+      }
+      driver.erase(driver.begin(), driver.begin() + static_cast<std::ptrdiff_t>(keep));
+    }
+  }
+  driver.push_back(Transaction{time, std::move(value)});
+  statistics.transactions++;
+
+  if (time == current_time) {
+    next_delta.push_back(signal);
+  } else {
+    wheel.schedule(time, signal);
+    statistics.peak_pending = std::max<uint64_t>(statistics.peak_pending, wheel.size());
+  }
+}
+
+void Simulator::useCyclePlan(const CyclePlan& plan) {
+  if (!plan.usable || initialized) {
+    throw std::runtime_error("cycle-based mode needs a usable plan before the first run");
+  }
+  cycle_plan = &plan;
+  dirty.assign(design.processes.size(), 0);
+}
+
+void Simulator::trace(WaveformWriter& writer) {
+  if (initialized) {
+    throw std::runtime_error("tracing has to start before the first run");
+  }
+  waveform = &writer;
+}
+
+void Simulator::profileProcesses() {
+  if (initialized) {
+    throw std::runtime_error("profiling has to start before the first run");
+  }
+  profiles.assign(design.processes.size(), ProcessProfile{});
+}
+
+void Simulator::initialize() {
+  // Every process runs once
+  initialized = true;
+  batch.clear();
+  for (uint32_t p = 0; p < design.processes.size(); p++) {
+    batch.push_back(p);
+  }
+  runBatch(batch);
+  for (size_t i = 0; i < batch.size(); i++) {
+    if (cycle_plan) {
+      commitOutput(outputs[i]);
+    } else {
+      applyOutput(outputs[i]);
+    }
+  }
+}
+
+void Simulator::run(SimTime until) {
+  if (cycle_plan) {
+    runCycles(until);
+    return;
+  }
+  if (!initialized) {
+    initialize();
+  }
+
+  uint64_t deltas_now = 0;
+  while (true) {
+    due.clear();
+    if (!next_delta.empty()) {
+      due.swap(next_delta);
+      statistics.delta_cycles++;
+      statistics.max_deltas = std::max(statistics.max_deltas, ++deltas_now);
+      if (deltas_now > MAX_DELTAS) {
+        throw std::runtime_error("delta cycle limit exceeded at " + formatTime(current_time) +
+                                 "; the design does not settle");
+      }
+    } else if (wheel.next(until, due)) {
+      current_time = wheel.now();
+      deltas_now = 0;
+    } else {
+      break;
+    }
+
+    updateSignals();
+    executeProcesses();
+  }
+
+  current_time = std::max(current_time, until);
+}
+
+// Two sweeps over the signals listed for this cycle. The first takes the
+// matured transactions off each driver, leaving the driving value in
+// next_values; the second commits the values that changed and wakes the
+// processes sensitive to them.
+void Simulator::updateSignals() {
+  for (uint32_t signal : due) {
+    uint8_t& flags = signal_flags[signal];
+    if (flags & SIGNAL_DUE) {
+      continue;  // listed more than once this cycle
+    }
+    flags |= SIGNAL_DUE;
+
+    std::deque<Transaction>& driver = drivers[signal];
+    size_t applied = 0;
+    while (applied < driver.size() && driver[applied].time <= current_time) {
+      applied++;
+    }
+    if (applied > 0) {
+      next_values[signal] = std::move(driver[applied - 1].value);
+      flags |= SIGNAL_ACTIVE;
+      driver.erase(driver.begin(), driver.begin() + static_cast<std::ptrdiff_t>(applied));
+    }
+  }
+
+  for (uint32_t signal : due) {
+    uint8_t flags = signal_flags[signal];
+    signal_flags[signal] = 0;  // later listings of the signal are skipped
+    if (!(flags & SIGNAL_ACTIVE) || next_values[signal] == values[signal]) {
+      continue;
+    }
+    values[signal] = next_values[signal];  // a copy reuses the storage the native tables point at
+    last_events[signal] = current_time;
+    statistics.events++;
+    traceChange(signal);
+    for (uint32_t process : design.fanout(signal)) {
+      if (!runnable_flags[process]) {
+        runnable_flags[process] = 1;
+        runnable.push_back(process);
+      }
+    }
+  }
+}
+
+void Simulator::executeProcesses() {
+  // Declaration order, so runs are reproducible
+  std::sort(runnable.begin(), runnable.end());
+  for (uint32_t process : runnable) {
+    runnable_flags[process] = 0;
+  }
+  runBatch(runnable);
+  for (size_t i = 0; i < runnable.size(); i++) {
+    applyOutput(outputs[i]);
+  }
+  runnable.clear();
+}
+
+// Runs `processes`, on the pool when there are enough of them, leaving the
+// assignments of processes[i] in outputs[i].
+void Simulator::runBatch(const std::vector<uint32_t>& processes) {
+  if (outputs.size() < processes.size()) {
+    outputs.resize(processes.size());
+  }
+  if (!pool || processes.size() < PARALLEL_MIN_PROCESSES) {
+    for (size_t i = 0; i < processes.size(); i++) {
+      runProcess(processes[i], outputs[i]);
+    }
+    return;
+  }
+
+  pool->parallelFor(processes.size(), [this, &processes](size_t i) {
+    try {
+      runProcess(processes[i], outputs[i]);
+    } catch (...) {
+      outputs[i].error = std::current_exception();
+    }
+  });
+  // The first failing process wins, as it would serially
+  for (size_t i = 0; i < processes.size(); i++) {
+    if (outputs[i].error) {
+      std::rethrow_exception(outputs[i].error);
+    }
+  }
+}
+
+// Runs one process body. Only reads shared state, so runs of different
+// processes may overlap; each also updates only its own profile.
+void Simulator::runProcess(uint32_t process, ProcessOutput& output) {
+  if (profiles.empty()) {
+    evaluate(process, output);
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  evaluate(process, output);
+  profiles[process].runs++;
+  profiles[process].nanoseconds += static_cast<uint64_t>(
+      std::chrono::nanoseconds(std::chrono::steady_clock::now() - start).count());
+}
+
+void Simulator::evaluate(uint32_t process, ProcessOutput& output) {
+  output.simulator = this;
+  if (native) {
+    VhdlNativeKernel kernel = native_kernel;
+    kernel.kernel = &output;
+    native->run(native_state, process, kernel);
+  } else {
+    ProcessFrame frame{values.data(), variables[process].data(), registers[process].data()};
+    runProgram(programs[process], frame, output.scheduled);
+  }
+}
+
+void Simulator::applyOutput(ProcessOutput& output) {
+  statistics.process_runs++;
+  SimTime previous = 0;
+  for (ScheduledValue& assignment : output.scheduled) {
+    const SignalInfo& info = design.signals[assignment.signal];
+    if (assignment.delay < 0) {
+      throw std::runtime_error("'after' needs a non-negative time in assignment to '" +
+                               NameTable::global().str(info.name) + "'");
+    }
+    SimTime delay = static_cast<SimTime>(assignment.delay);
+    bool first = assignment.flags & SCHEDULE_FIRST;
+    if (!first && delay <= previous) {
+      throw std::runtime_error("waveform times must increase in assignment to '" +
+                               NameTable::global().str(info.name) + "'");
+    }
+    previous = delay;
+    schedule(assignment.signal, std::move(assignment.value), current_time + delay,
+             first, assignment.flags & SCHEDULE_TRANSPORT);
+  }
+  output.scheduled.clear();
+}
+
+// ---------------------------------------------------------------------------
+// Cycle-based mode. Only inputs have drivers and go through the timing wheel;
+// process assignments are all zero-delay and are committed straight into the
+// signal values.
+
+void Simulator::runCycles(SimTime until) {
+  if (!initialized) {
+    initialize();
+  }
+
+  while (true) {
+    due.clear();
+    if (!next_delta.empty()) {
+      due.swap(next_delta);  // inputs driven at the current time
+    } else {
+      settleCombinational();
+      if (!wheel.next(until, due)) {
+        break;
+      }
+      current_time = wheel.now();
+    }
+    statistics.cycles++;
+
+    // Apply the input changes. Woken sequential processes run now, against
+    // the values from before the change settles; combinational ones wait.
+    updateSignals();
+    std::sort(runnable.begin(), runnable.end());
+    batch.clear();
+    for (uint32_t process : runnable) {
+      runnable_flags[process] = 0;
+      if (cycle_plan->roles[process] == ProcessRole::Sequential) {
+        batch.push_back(process);
+      } else {
+        dirty[process] = 1;
+      }
+    }
+    runnable.clear();
+
+    runBatch(batch);
+    for (size_t i = 0; i < batch.size(); i++) {
+      commitOutput(outputs[i]);
+    }
+  }
+
+  current_time = std::max(current_time, until);
+}
+
+// Evaluates every combinational process whose inputs changed, once, in level
+// order. Processes of one level never read each other's outputs.
+void Simulator::settleCombinational() {
+  const CyclePlan& plan = *cycle_plan;
+  for (size_t level = 0; level < plan.levels(); level++) {
+    batch.clear();
+    for (uint32_t i = plan.level_starts[level]; i < plan.level_starts[level + 1]; i++) {
+      uint32_t process = plan.order[i];
+      if (dirty[process]) {
+        dirty[process] = 0;
+        batch.push_back(process);
+      }
+    }
+    runBatch(batch);
+    for (size_t i = 0; i < batch.size(); i++) {
+      commitOutput(outputs[i]);
+    }
+  }
+}
+
+void Simulator::commitOutput(ProcessOutput& output) {
+  statistics.process_runs++;
+  for (const ScheduledValue& assignment : output.scheduled) {
+    statistics.transactions++;
+    Value& current = values[assignment.signal];
+    if (assignment.value != current) {
+      current = assignment.value;  // a copy reuses the storage the native tables point at
+      last_events[assignment.signal] = current_time;
+      statistics.events++;
+      traceChange(assignment.signal);
+      for (uint32_t process : design.fanout(assignment.signal)) {
+        dirty[process] = 1;
+      }
+    }
+  }
+  output.scheduled.clear();
+}
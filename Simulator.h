@@ -0,0 +1,196 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <vector>
+#include "Bytecode.h"
+#include "Elaborate.h"
+#include "Levelize.h"
+#include "Native.h"
+#include "ThreadPool.h"
+#include "TimingWheel.h"
+#include "Value.h"
+#include "Waveform.h"
+
+struct SimulationStats {
+  uint64_t transactions = 0;  // values scheduled on drivers
+  uint64_t events       = 0;  // signal value changes
+  uint64_t delta_cycles = 0;
+  uint64_t process_runs = 0;
+  uint64_t cycles       = 0;  // input changes simulated in cycle-based mode
+  uint64_t max_deltas   = 0;  // longest run of delta cycles at one time
+  uint64_t peak_pending = 0;  // most future transactions waiting in the timing wheel
+};
+
+// Evaluations of one process, when the simulator profiles them.
+struct ProcessProfile {
+  uint64_t runs        = 0;
+  uint64_t nanoseconds = 0;
+};
+
+// Event-driven simulation kernel for an elaborated design.
+//
+// Each cycle has an update phase, which applies every driver transaction due
+// at the current time and records the signals whose value changed, and an
+// execute phase, which runs every process sensitive to one of those signals.
+// Assignments made by processes are never visible until the next update, so
+// the processes of one cycle may run in any order. Zero-delay assignments
+// start another delta cycle at the same time; delayed ones go into a timing
+// wheel that yields the next time with pending transactions. Process bodies
+// are compiled to bytecode (see Bytecode.h) when the simulator is created,
+// or run as native code from a NativeModule built for the same design.
+//
+// Because of that deferral, a large set of runnable processes can be spread
+// over a thread pool: each task collects its process's assignments in its own
+// buffer, and the buffers are applied in process order afterwards, so results
+// are identical to a single-threaded run.
+//
+// Synchronous designs can instead run cycle-based from a CyclePlan: no delta
+// cycles, and combinational logic evaluated once per input change.
+class Simulator {
+public:
+  // Throws std::runtime_error for type errors in process bodies. `native` and
+  // `pool`, when given, must outlive the simulator.
+  explicit Simulator(const Design& design, const NativeModule* native = nullptr, ThreadPool* pool = nullptr);
+  ~Simulator();
+
+  Simulator(const Simulator&) = delete;
+  Simulator& operator=(const Simulator&) = delete;
+
+  // Switches to cycle-based simulation with a usable plan for the same
+  // design (see Levelize.h); `plan` must outlive the simulator. Only valid
+  // before the first run().
+  void useCyclePlan(const CyclePlan& plan);
+
+  // Reports every value change of the signals `writer` traces, from the
+  // first run() on. `writer` must outlive the simulator.
+  void trace(WaveformWriter& writer);
+
+  // Times every evaluation of every process from the first run() on. This
+  // reads the clock twice per evaluation, so it is off by default.
+  void profileProcesses();
+
+  // Per process; empty unless profileProcesses() was called.
+  const std::vector<ProcessProfile>& processProfiles() const {
+    return profiles;
+  }
+
+  // Schedules `value` on an undriven signal (an input port) at `time`, which
+  // must not be earlier than now().
+  void drive(uint32_t signal, const Value& value, SimTime time);
+
+  // Initializes the design on the first call, then runs cycles until nothing
+  // is pending at or before `until`. Afterwards now() is `until`.
+  void run(SimTime until);
+
+  SimTime now() const {
+    return current_time;
+  }
+
+  const Value& value(uint32_t signal) const {
+    return values[signal];
+  }
+
+  // Time of the last change of `signal`, or NO_EVENT if it has kept its initial value.
+  SimTime lastEvent(uint32_t signal) const {
+    return last_events[signal];
+  }
+
+  static constexpr SimTime NO_EVENT = ~SimTime(0);
+
+  const SimulationStats& stats() const {
+    return statistics;
+  }
+
+  // Delta cycles allowed at one time before the design is declared to oscillate.
+  static constexpr uint64_t MAX_DELTAS = 10000;
+
+  // Fewer runnable processes than this run on the calling thread.
+  static constexpr size_t PARALLEL_MIN_PROCESSES = 64;
+
+private:
+  struct Transaction {
+    SimTime time;
+    Value   value;
+  };
+
+  // Assignments of one process run, applied once the run is over.
+  struct ProcessOutput {
+    Simulator* simulator = nullptr;
+    std::vector<ScheduledValue> scheduled;
+    std::exception_ptr error;
+  };
+
+  // signal_flags bits, all cleared at the end of each update phase
+  enum : uint8_t {
+    SIGNAL_DUE    = 1,  // already seen in the current update set
+    SIGNAL_ACTIVE = 2,  // a transaction matured; next_values holds the driving value
+  };
+
+  const Design& design;
+
+  // Signal state as one dense array per field, indexed by signal id, so that
+  // the update phase sweeps contiguous memory. The processes sensitive to a
+  // signal come from the design's fan-out table.
+  std::vector<Value> values;                     // current value
+  std::vector<Value> next_values;                // driving value, while updating
+  std::vector<SimTime> last_events;              // time of the last change
+  std::vector<uint8_t> signal_flags;
+  std::vector<std::deque<Transaction>> drivers;  // projected waveform, ordered by time
+
+  std::vector<Program> programs;                 // process -> compiled body
+  std::vector<std::vector<Value>> variables;     // process -> variable values
+  std::vector<std::vector<Value>> registers;     // process -> bytecode registers
+  std::vector<ProcessOutput> outputs;            // one per runnable process of a cycle
+
+  // Native backend. The pointer tables address `values` in place: the array
+  // is never resized, and assigning a value of the same width reuses its storage.
+  const NativeModule* native = nullptr;
+  void* native_state = nullptr;
+  std::vector<const int64_t*>  native_scalars;
+  std::vector<const uint64_t*> native_words;
+  VhdlNativeKernel native_kernel{};
+
+  ThreadPool* pool = nullptr;
+  std::vector<uint32_t> batch;
+
+  // Cycle-based mode
+  const CyclePlan* cycle_plan = nullptr;
+  std::vector<uint8_t> dirty;                    // combinational processes to evaluate
+
+  WaveformWriter* waveform = nullptr;
+  std::vector<ProcessProfile> profiles;          // process -> evaluations, when profiling
+
+  std::vector<uint8_t>  runnable_flags;
+  std::vector<uint32_t> runnable;
+  std::vector<uint32_t> next_delta;              // signals with transactions due now
+  std::vector<uint32_t> due;
+
+  TimingWheel wheel;
+  SimTime current_time = 0;
+  bool initialized = false;
+  SimulationStats statistics;
+
+  void updateSignals();
+  void executeProcesses();
+  void initialize();
+  void runBatch(const std::vector<uint32_t>& processes);
+  void runProcess(uint32_t process, ProcessOutput& output);
+  void evaluate(uint32_t process, ProcessOutput& output);
+  void applyOutput(ProcessOutput& output);
+
+  void runCycles(SimTime until);
+  void settleCombinational();
+  void commitOutput(ProcessOutput& output);
+  void schedule(uint32_t signal, Value value, SimTime time, bool preempt, bool transport);
+
+  void traceChange(uint32_t signal) {
+    if (waveform && waveform->traces(signal)) {
+      waveform->record(current_time, signal, values[signal]);
+    }
+  }
+
+  static void nativeSchedule(void* kernel, uint32_t signal, uint32_t flags, int64_t delay,
+                             int64_t scalar, const uint64_t* words);
+  static void nativeFail(void* kernel, const char* message);
+};
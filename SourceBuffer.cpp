@@ -0,0 +1,132 @@
+#include "SourceBuffer.h"
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+SourceBuffer::~SourceBuffer() {
+  close();
+}
+
+SourceBuffer::SourceBuffer(SourceBuffer&& other) noexcept {
+  moveFrom(other);
+}
+
+SourceBuffer& SourceBuffer::operator=(SourceBuffer&& other) noexcept {
+  if (this != &other) {
+    close();
+    moveFrom(other);
+  }
+  return *this;
+}
+
+void SourceBuffer::moveFrom(SourceBuffer& other) {
+  this->length   = other.length;
+  this->is_open  = other.is_open;
+  this->mapped   = other.mapped;
+  this->fallback = std::move(other.fallback);
+  this->data     = this->mapped ? other.data : this->fallback.data();
+#ifdef _WIN32
+  this->file_handle    = other.file_handle;
+  this->mapping_handle = other.mapping_handle;
+  other.file_handle    = nullptr;
+  other.mapping_handle = nullptr;
+#endif
+  other.data    = nullptr;
+  other.length  = 0;
+  other.is_open = false;
+  other.mapped  = false;
+}
+
+bool SourceBuffer::open(const std::string& path) {
+  close();
+
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+    CloseHandle(file);
+    return readFallback(path);
+  }
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+  if (!view) {
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
+    return readFallback(path);
+  }
+  this->file_handle    = file;
+  this->mapping_handle = mapping;
+  this->data   = static_cast<const char*>(view);
+  this->length = static_cast<size_t>(file_size.QuadPart);
+#else
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+    ::close(fd);
+    return readFallback(path);
+  }
+  void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (view == MAP_FAILED) {
+    return readFallback(path);
+  }
+  // The lexer walks the file front to back exactly once.
+  madvise(view, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+  this->data   = static_cast<const char*>(view);
+  this->length = static_cast<size_t>(st.st_size);
+#endif
+
+  this->mapped  = true;
+  this->is_open = true;
+  return true;
+}
+
+bool SourceBuffer::readFallback(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+  std::ostringstream buffer;
+  buffer << file.rdbuf();
+  this->fallback = buffer.str();
+  this->data     = this->fallback.data();
+  this->length   = this->fallback.size();
+  this->mapped   = false;
+  this->is_open  = true;
+  return true;
+}
+
+void SourceBuffer::close() {
+  if (this->mapped) {
+#ifdef _WIN32
+    UnmapViewOfFile(this->data);
+    CloseHandle(this->mapping_handle);
+    CloseHandle(this->file_handle);
+    this->mapping_handle = nullptr;
+    this->file_handle    = nullptr;
+#else
+    munmap(const_cast<char*>(this->data), this->length);
+#endif
+  }
+  this->fallback.clear();
+  this->data    = nullptr;
+  this->length  = 0;
+  this->mapped  = false;
+  this->is_open = false;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+// Read-only contents of a source file. The file is memory-mapped where the
+// platform allows it, so the lexer can hand out tokens that point straight
+// into the buffer without copying the input.
+class SourceBuffer {
+public:
+  SourceBuffer() = default;
+  ~SourceBuffer();
+
+  SourceBuffer(const SourceBuffer&) = delete;
+  SourceBuffer& operator=(const SourceBuffer&) = delete;
+  SourceBuffer(SourceBuffer&& other) noexcept;
+  SourceBuffer& operator=(SourceBuffer&& other) noexcept;
+
+  bool open(const std::string& path);
+  void close();
+
+  bool isOpen() const {
+    return this->is_open;
+  }
+
+  std::string_view view() const {
+    return std::string_view(this->data, this->length);
+  }
+
+  size_t size() const {
+    return this->length;
+  }
+
+private:
+  const char* data = nullptr;
+  size_t length = 0;
+  bool is_open = false;
+  bool mapped = false;
+
+  // Used when the file cannot be mapped (e.g. pipes or empty files).
+  std::string fallback;
+
+#ifdef _WIN32
+  void* file_handle = nullptr;
+  void* mapping_handle = nullptr;
+#endif
+
+  bool readFallback(const std::string& path);
+  void moveFrom(SourceBuffer& other);
+};
@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. The capacity is rounded up to a power of two. Head and tail live on
+// separate cache lines so the two sides do not false-share.
+template <class T>
+class SpscQueue {
+public:
+  explicit SpscQueue(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+      size *= 2;
+    }
+    slots.reset(new T[size]);
+    mask = size - 1;
+  }
+
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  // Producer side. Returns false when the queue is full.
+  bool push(T item) {
+    size_t tail = tail_index.load(std::memory_order_relaxed);
+    if (tail - head_index.load(std::memory_order_acquire) > mask) {
+      return false;
+    }
+    slots[tail & mask] = std::move(item);
+    tail_index.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns false when the queue is empty.
+  bool pop(T& item) {
+    size_t head = head_index.load(std::memory_order_relaxed);
+    if (head == tail_index.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = std::move(slots[head & mask]);
+    head_index.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const {
+    return head_index.load(std::memory_order_acquire) == tail_index.load(std::memory_order_acquire);
+  }
+
+private:
+  std::unique_ptr<T[]> slots;
+  size_t mask = 0;
+  alignas(64) std::atomic<size_t> head_index{0};
+  alignas(64) std::atomic<size_t> tail_index{0};
+};
@@ -0,0 +1,250 @@
+#pragma once
+#include "Node.h"
+#include "Expression.h"
+#include "BlockDeclarativeItem.h"
+
+/*
+sequential_statement ::=
+  signal_assignment_statement
+| variable_assignment_statement
+| if_statement
+| null_statement
+
+concurrent_statement ::=
+  process_statement
+| concurrent_signal_assignment_statement
+
+waveform ::= waveform_element { , waveform_element }
+waveform_element ::= value_expression [ after time_expression ]
+*/
+
+
+enum class StatementKind : uint8_t {
+  SignalAssignment, VariableAssignment, If, Null,
+};
+
+
+class SequentialStatement : public Node {
+public:
+  StatementKind kind;
+
+protected:
+  explicit SequentialStatement(StatementKind kind) : kind(kind) {}
+  ~SequentialStatement() = default;
+};
+
+
+class WaveformElement : public Node {
+public:
+  Expression* value = nullptr;
+  Expression* after = nullptr;
+
+  void setValue(Expression* value) {
+    this->value = value;
+  }
+
+  void setAfter(Expression* after) {
+    this->after = after;
+  }
+
+  void dump(std::ostream& out) const override {
+    dumpOrNull(out, value);
+    if (after) {
+      out << " after ";
+      after->dump(out);
+    }
+  }
+};
+
+
+class SignalAssignment : public SequentialStatement {
+public:
+  NameId target  = NO_NAME;
+  bool transport = false;
+  Span<WaveformElement> waveform;
+
+  SignalAssignment() : SequentialStatement(StatementKind::SignalAssignment) {}
+
+  void setTarget(NameId target) {
+    this->target = target;
+  }
+
+  void setTransport(bool transport) {
+    this->transport = transport;
+  }
+
+  void setWaveform(Span<WaveformElement> waveform) {
+    this->waveform = waveform;
+  }
+
+  void dump(std::ostream& out) const override {
+    out << "SignalAssignment(" << nameString(target) << " <= " << (transport ? "transport " : "");
+    for (size_t i = 0; i < waveform.size(); i++) {
+      out << (i ? ", " : "");
+      waveform[i].dump(out);
+    }
+    out << ")";
+  }
+};
+
+
+class VariableAssignment : public SequentialStatement {
+public:
+  NameId target = NO_NAME;
+  Expression* value = nullptr;
+
+  VariableAssignment() : SequentialStatement(StatementKind::VariableAssignment) {}
+
+  void setTarget(NameId target) {
+    this->target = target;
+  }
+
+  void setValue(Expression* value) {
+    this->value = value;
+  }
+
+  void dump(std::ostream& out) const override {
+    out << "VariableAssignment(" << nameString(target) << " := ";
+    dumpOrNull(out, value);
+    out << ")";
+  }
+};
+
+
+// One `if`/`elsif`/`else` arm; the `else` arm has no condition.
+class IfBranch : public Node {
+public:
+  Expression* condition = nullptr;
+  Span<SequentialStatement*> body;
+
+  void setCondition(Expression* condition) {
+    this->condition = condition;
+  }
+
+  void setBody(Span<SequentialStatement*> body) {
+    this->body = body;
+  }
+
+  void dump(std::ostream& out) const override {
+    if (condition) {
+      out << "when ";
+      condition->dump(out);
+      out << "\n";
+    } else {
+      out << "else\n";
+    }
+    for (const SequentialStatement* statement : body) {
+      out << "  ";
+      statement->dump(out);
+      out << "\n";
+    }
+  }
+};
+
+
+class IfStatement : public SequentialStatement {
+public:
+  Span<IfBranch> branches;
+
+  IfStatement() : SequentialStatement(StatementKind::If) {}
+
+  void setBranches(Span<IfBranch> branches) {
+    this->branches = branches;
+  }
+
+  void dump(std::ostream& out) const override {
+    out << "IfStatement\n";
+    for (const IfBranch& branch : branches) {
+      branch.dump(out);
+    }
+    out << "end if";
+  }
+};
+
+
+class NullStatement : public SequentialStatement {
+public:
+  NullStatement() : SequentialStatement(StatementKind::Null) {}
+
+  void dump(std::ostream& out) const override {
+    out << "NullStatement";
+  }
+};
+
+
+enum class ConcurrentKind : uint8_t {
+  Process, SignalAssignment,
+};
+
+
+class ConcurrentStatement : public Node {
+public:
+  ConcurrentKind kind;
+  NameId label = NO_NAME;
+
+  void setLabel(NameId label) {
+    this->label = label;
+  }
+
+protected:
+  explicit ConcurrentStatement(ConcurrentKind kind) : kind(kind) {}
+  ~ConcurrentStatement() = default;
+};
+
+
+class ProcessStatement : public ConcurrentStatement {
+public:
+  Span<NameId> sensitivity;
+  Span<BlockDeclarativeItem*> declarations;
+  Span<SequentialStatement*> body;
+
+  ProcessStatement() : ConcurrentStatement(ConcurrentKind::Process) {}
+
+  void setSensitivity(Span<NameId> sensitivity) {
+    this->sensitivity = sensitivity;
+  }
+
+  void setDeclarations(Span<BlockDeclarativeItem*> declarations) {
+    this->declarations = declarations;
+  }
+
+  void setBody(Span<SequentialStatement*> body) {
+    this->body = body;
+  }
+
+  void dump(std::ostream& out) const override {
+    out << "ProcessStatement(";
+    for (size_t i = 0; i < sensitivity.size(); i++) {
+      out << (i ? ", " : "") << nameString(sensitivity[i]);
+    }
+    out << ")\n";
+    for (const BlockDeclarativeItem* item : declarations) {
+      item->dump(out);
+      out << "\n";
+    }
+    for (const SequentialStatement* statement : body) {
+      statement->dump(out);
+      out << "\n";
+    }
+    out << "end process";
+  }
+};
+
+
+// `target <= waveform;` outside a process: an implicit process that is
+// sensitive to every signal the waveform reads.
+class ConcurrentSignalAssignment : public ConcurrentStatement {
+public:
+  SignalAssignment* assignment = nullptr;
+
+  ConcurrentSignalAssignment() : ConcurrentStatement(ConcurrentKind::SignalAssignment) {}
+
+  void setAssignment(SignalAssignment* assignment) {
+    this->assignment = assignment;
+  }
+
+  void dump(std::ostream& out) const override {
+    out << "Concurrent";
+    assignment->dump(out);
+  }
+};
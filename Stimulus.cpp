@@ -0,0 +1,262 @@
+#include "Stimulus.h"
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include "SourceBuffer.h"
+
+static const char STIMULUS_MAGIC[8] = {'V', 'H', 'D', 'L', 'S', 'T', 'I', 'M'};
+static constexpr uint32_t STIMULUS_VERSION = 1;
+
+static std::string_view trimmed(std::string_view text) {
+  while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+  while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) text.remove_suffix(1);
+  return text;
+}
+
+static std::vector<std::string_view> splitCells(std::string_view line) {
+  std::vector<std::string_view> cells;
+  size_t start = 0;
+  while (true) {
+    size_t comma = line.find(',', start);
+    cells.push_back(trimmed(line.substr(start, comma == std::string_view::npos ? std::string_view::npos : comma - start)));
+    if (comma == std::string_view::npos) return cells;
+    start = comma + 1;
+  }
+}
+
+// Rows collected per stream while reading
+class StimulusBuilder {
+public:
+  explicit StimulusBuilder(const Design& design) : design(design) {}
+
+  // Resolves a column name to the signal it drives
+  uint32_t input(std::string_view name) {
+    int signal = design.findSignal(NameTable::global().intern(name));
+    if (signal < 0) {
+      throw std::runtime_error("no signal named '" + std::string(name) + "'");
+    }
+    if (design.signals[signal].driver >= 0) {
+      throw std::runtime_error("'" + std::string(name) + "' is driven by a process");
+    }
+    return static_cast<uint32_t>(signal);
+  }
+
+  StimulusStream& row(uint32_t id, SimTime time) {
+    StimulusStream& stream = streams[id];
+    stream.id = id;
+    if (!stream.times.empty() && time <= stream.times.back()) {
+      throw std::runtime_error("times must increase within stream " + std::to_string(id));
+    }
+    stream.times.push_back(time);
+    stream.row_ends.push_back(static_cast<uint32_t>(stream.drives.size()));
+    return stream;
+  }
+
+  void drive(StimulusStream& stream, uint32_t signal, Value value) {
+    checkAssignable(design.signals[signal].type, value, design.signals[signal].name);
+    stream.drives.push_back(StimulusDrive{signal, std::move(value)});
+    stream.row_ends.back()++;
+  }
+
+  Stimulus finish() {
+    Stimulus stimulus;
+    for (auto& entry : streams) {
+      stimulus.streams.push_back(std::move(entry.second));
+    }
+    return stimulus;
+  }
+
+  const Design& design;
+
+private:
+  std::map<uint32_t, StimulusStream> streams;
+};
+
+static Stimulus loadCsv(StimulusBuilder& builder, std::string_view text) {
+  const Design& design = builder.design;
+  std::vector<uint32_t> columns;  // signal per column
+  int time_column = -1, stream_column = -1;
+  bool header = true;
+  size_t line_number = 0;
+
+  for (size_t start = 0; start < text.size();) {
+    size_t end = text.find('\n', start);
+    std::string_view line = trimmed(text.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start));
+    start = end == std::string_view::npos ? text.size() : end + 1;
+    line_number++;
+    if (line.empty() || line.front() == '#') continue;
+
+    try {
+      std::vector<std::string_view> cells = splitCells(line);
+      if (header) {
+        header = false;
+        for (size_t c = 0; c < cells.size(); c++) {
+          if (cells[c] == "time") {
+            time_column = static_cast<int>(c);
+            columns.push_back(0);
+          } else if (cells[c] == "stream") {
+            stream_column = static_cast<int>(c);
+            columns.push_back(0);
+          } else {
+            columns.push_back(builder.input(cells[c]));
+          }
+        }
+        if (time_column < 0) {
+          throw std::runtime_error("the header has no 'time' column");
+        }
+        continue;
+      }
+
+      if (cells.size() != columns.size()) {
+        throw std::runtime_error(std::to_string(cells.size()) + " cells, the header has " + std::to_string(columns.size()));
+      }
+      uint32_t id = stream_column < 0 ? 0 : static_cast<uint32_t>(std::stoul(std::string(cells[stream_column])));
+      StimulusStream& stream = builder.row(id, static_cast<SimTime>(parseTime(cells[time_column])));
+      for (size_t c = 0; c < cells.size(); c++) {
+        if (static_cast<int>(c) == time_column || static_cast<int>(c) == stream_column || cells[c].empty()) {
+          continue;
+        }
+        builder.drive(stream, columns[c], parseValue(design.signals[columns[c]].type, cells[c]));
+      }
+    } catch (const std::exception& e) {
+      throw std::runtime_error("line " + std::to_string(line_number) + ": " + e.what());
+    }
+  }
+  return builder.finish();
+}
+
+static Stimulus loadBinary(StimulusBuilder& builder, std::string_view data) {
+  size_t pos = sizeof(STIMULUS_MAGIC);
+  auto read = [&data, &pos](void* target, size_t size) {
+    if (size > data.size() - pos) {
+      throw std::runtime_error("truncated stimulus file");
+    }
+    std::memcpy(target, data.data() + pos, size);
+    pos += size;
+  };
+  auto u32 = [&read]() { uint32_t value; read(&value, sizeof(value)); return value; };
+  auto u64 = [&read]() { uint64_t value; read(&value, sizeof(value)); return value; };
+  // A count of items taking at least `size` bytes each, checked against what
+  // is left before anything is allocated for them
+  auto count = [&data, &pos, &u32](size_t size) {
+    uint32_t value = u32();
+    if (value > (data.size() - pos) / size) {
+      throw std::runtime_error("truncated stimulus file");
+    }
+    return value;
+  };
+
+  if (u32() != STIMULUS_VERSION) {
+    throw std::runtime_error("unsupported stimulus file version");
+  }
+  std::vector<uint32_t> columns(count(sizeof(uint32_t)));
+  for (uint32_t& column : columns) {
+    std::string name(count(1), '\0');
+    read(&name[0], name.size());
+    column = builder.input(name);
+  }
+
+  for (size_t row = 1; pos < data.size(); row++) {
+    try {
+      uint32_t id = u32();
+      StimulusStream& stream = builder.row(id, u64());
+      for (uint32_t signal : columns) {
+        uint8_t present;
+        read(&present, 1);
+        if (!present) continue;
+        const ValueType& type = builder.design.signals[signal].type;
+        Value value = Value::defaultFor(type);
+        if (type.kind == TypeKind::BitVector) {
+          read(value.bits.words(), value.bits.wordCount() * sizeof(uint64_t));
+          if (type.width() % 64 != 0 && value.bits.words()[value.bits.wordCount() - 1] >> (type.width() % 64)) {
+            throw std::runtime_error("value wider than '" + NameTable::global().str(builder.design.signals[signal].name) + "'");
+          }
+        } else {
+          value.scalar = static_cast<int64_t>(u64());
+        }
+        builder.drive(stream, signal, std::move(value));
+      }
+    } catch (const std::exception& e) {
+      throw std::runtime_error("row " + std::to_string(row) + ": " + e.what());
+    }
+  }
+  return builder.finish();
+}
+
+Stimulus Stimulus::load(const Design& design, const std::string& path) {
+  SourceBuffer file;
+  if (!file.open(path)) {
+    throw std::runtime_error("cannot open stimulus file " + path);
+  }
+  StimulusBuilder builder(design);
+  std::string_view data = file.view();
+  try {
+    if (data.size() >= sizeof(STIMULUS_MAGIC) && std::memcmp(data.data(), STIMULUS_MAGIC, sizeof(STIMULUS_MAGIC)) == 0) {
+      return loadBinary(builder, data);
+    }
+    return loadCsv(builder, data);
+  } catch (const std::exception& e) {
+    throw std::runtime_error(path + ", " + e.what());
+  }
+}
+
+std::vector<uint32_t> outputPorts(const Design& design) {
+  std::vector<uint32_t> outputs;
+  for (uint32_t s = 0; s < design.signals.size(); s++) {
+    Keyword mode = design.signals[s].mode;
+    if (mode == Keyword::Out || mode == Keyword::Inout || mode == Keyword::Buffer) {
+      outputs.push_back(s);
+    }
+  }
+  return outputs;
+}
+
+StreamResponses simulateStream(Simulator& simulator, const StimulusStream& stream,
+                               const std::vector<uint32_t>& outputs) {
+  StreamResponses responses;
+  try {
+    for (size_t row = 0, drive = 0; row < stream.times.size(); row++) {
+      for (; drive < stream.row_ends[row]; drive++) {
+        simulator.drive(stream.drives[drive].signal, stream.drives[drive].value, stream.times[row]);
+      }
+    }
+    for (SimTime time : stream.times) {
+      simulator.run(time);
+      std::vector<Value>& sample = responses.samples.emplace_back();
+      for (uint32_t signal : outputs) {
+        sample.push_back(simulator.value(signal));
+      }
+    }
+  } catch (const std::exception& e) {
+    throw std::runtime_error("stream " + std::to_string(stream.id) + ": " + e.what());
+  }
+  return responses;
+}
+
+// 1, 1100, true, 42 -- the value without VHDL quotes
+static std::string csvValue(const Value& value) {
+  std::string text = value.toString();
+  if (text.size() >= 2 && (text.front() == '\'' || text.front() == '"')) {
+    return text.substr(1, text.size() - 2);
+  }
+  return text;
+}
+
+void writeResponses(std::ostream& out, const Design& design, const Stimulus& stimulus,
+                    const std::vector<uint32_t>& outputs, const std::vector<StreamResponses>& responses) {
+  out << "stream,time";
+  for (uint32_t signal : outputs) {
+    out << "," << NameTable::global().spelling(design.signals[signal].name);
+  }
+  out << "\n";
+  for (size_t s = 0; s < stimulus.streams.size(); s++) {
+    const StimulusStream& stream = stimulus.streams[s];
+    for (size_t row = 0; row < stream.times.size(); row++) {
+      out << stream.id << "," << formatTime(stream.times[row]);
+      for (const Value& value : responses[s].samples[row]) {
+        out << "," << csvValue(value);
+      }
+      out << "\n";
+    }
+  }
+}
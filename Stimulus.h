@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Elaborate.h"
+#include "Simulator.h"
+
+// Stimulus files: one or more independent streams of input values, each
+// simulated from the design's initial state. Every row of a stream drives
+// some inputs at one time, and the outputs are sampled at that time once the
+// design has settled.
+//
+// CSV: a header row names the columns -- `time` (required), `stream`
+// (optional, default 0) and the undriven signals to drive. Times are written
+// as for --sim (`10ns`, a bare number is in ns) and must increase within a
+// stream; an empty cell leaves its signal unchanged. Blank lines and lines
+// starting with '#' are skipped.
+//
+//   stream,time,a,b
+//   0,0ns,0,1
+//   1,0ns,1,1
+//
+// Binary, little-endian: "VHDLSTIM", u32 version, u32 column count, then per
+// column a u32 name length and the name; then rows to the end of the file:
+// u32 stream, u64 time in fs, and per column a u8 presence flag followed,
+// when set, by the value -- an i64 for scalars, (width + 63) / 64 u64 words
+// for a bit_vector.
+
+struct StimulusDrive {
+  uint32_t signal;
+  Value    value;
+};
+
+struct StimulusStream {
+  uint32_t id = 0;                  // stream number in the file
+  std::vector<SimTime>  times;      // per row, increasing
+  std::vector<uint32_t> row_ends;   // per row, end of its drives in `drives`
+  std::vector<StimulusDrive> drives;
+};
+
+class Stimulus {
+public:
+  // Reads a CSV or binary stimulus file for `design`. Throws
+  // std::runtime_error naming the line or row of any error.
+  static Stimulus load(const Design& design, const std::string& path);
+
+  std::vector<StimulusStream> streams;  // ordered by id
+};
+
+// Outputs sampled at each row of one stream: one value per output signal.
+struct StreamResponses {
+  std::vector<std::vector<Value>> samples;
+};
+
+// The design's out, inout and buffer ports, in declaration order.
+std::vector<uint32_t> outputPorts(const Design& design);
+
+// Runs `stream` on a simulator that has not run yet.
+StreamResponses simulateStream(Simulator& simulator, const StimulusStream& stream,
+                               const std::vector<uint32_t>& outputs);
+
+// Writes "stream,time,<outputs>" rows, one per stimulus row.
+void writeResponses(std::ostream& out, const Design& design, const Stimulus& stimulus,
+                    const std::vector<uint32_t>& outputs, const std::vector<StreamResponses>& responses);
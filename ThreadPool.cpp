@@ -0,0 +1,128 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+// Lets submit() and wait() find the calling worker's own queue.
+static thread_local const ThreadPool* current_pool = nullptr;
+static thread_local size_t current_index = 0;
+
+ThreadPool::ThreadPool(size_t threads) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (size_t i = 0; i < threads; i++) {
+    queues.push_back(std::make_unique<Queue>());
+  }
+  for (size_t i = 0; i < threads; i++) {
+    workers.emplace_back(&ThreadPool::workerLoop, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(idle_mutex);
+    stopping = true;
+  }
+  idle_cv.notify_all();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+  pending++;
+  size_t target = (current_pool == this) ? current_index : next_queue++ % queues.size();
+  // Counted before it is published, so a thief's decrement cannot come first
+  queued++;
+  {
+    std::lock_guard<std::mutex> lock(queues[target]->mutex);
+    queues[target]->tasks.push_back(std::move(task));
+  }
+  {
+    std::lock_guard<std::mutex> lock(idle_mutex);
+  }
+  idle_cv.notify_one();
+}
+
+bool ThreadPool::tryRun(size_t home) {
+  std::function<void()> task;
+  {
+    std::lock_guard<std::mutex> lock(queues[home]->mutex);
+    if (!queues[home]->tasks.empty()) {
+      task = std::move(queues[home]->tasks.back());
+      queues[home]->tasks.pop_back();
+    }
+  }
+  for (size_t k = 1; !task && k < queues.size(); k++) {
+    Queue& victim = *queues[(home + k) % queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+    }
+  }
+  if (!task) {
+    return false;
+  }
+
+  queued--;
+  task();
+  if (--pending == 0) {
+    std::lock_guard<std::mutex> lock(idle_mutex);
+    done_cv.notify_all();
+  }
+  return true;
+}
+
+void ThreadPool::workerLoop(size_t index) {
+  current_pool  = this;
+  current_index = index;
+  while (true) {
+    if (tryRun(index)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(idle_mutex);
+    idle_cv.wait(lock, [this] { return stopping || queued > 0; });
+    if (stopping && queued == 0) {
+      return;
+    }
+  }
+}
+
+void ThreadPool::wait() {
+  size_t home = (current_pool == this) ? current_index : 0;
+  while (pending > 0) {
+    if (tryRun(home)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(idle_mutex);
+    done_cv.wait(lock, [this] { return pending == 0 || queued > 0; });
+  }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body) {
+  if (count == 0) {
+    return;
+  }
+  size_t batches = std::min(count, workers.size() * 4);
+  size_t per_batch = (count + batches - 1) / batches;
+  std::atomic<size_t> remaining{0};
+
+  for (size_t lo = 0; lo < count; lo += per_batch) {
+    size_t hi = std::min(count, lo + per_batch);
+    remaining++;
+    submit([&body, &remaining, lo, hi] {
+      for (size_t i = lo; i < hi; i++) {
+        body(i);
+      }
+      remaining--;
+    });
+  }
+
+  // Help out instead of blocking, so parallelFor may also be used from inside a task.
+  size_t home = (current_pool == this) ? current_index : 0;
+  while (remaining > 0) {
+    if (!tryRun(home)) {
+      std::this_thread::yield();
+    }
+  }
+}
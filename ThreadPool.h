@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool. Every worker owns a deque: it pops its own work
+// from the back and, when that runs dry, steals from the front of the other
+// workers' deques. Tasks submitted from outside the pool are dealt round-robin.
+class ThreadPool {
+public:
+  // `threads` == 0 picks std::thread::hardware_concurrency().
+  explicit ThreadPool(size_t threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  void submit(std::function<void()> task);
+
+  // Blocks until every submitted task has finished. The calling thread runs
+  // queued tasks itself while it waits. Must not be called from a task.
+  void wait();
+
+  // Runs body(i) for i in [0, count), split into roughly even batches, and
+  // returns when all of them are done. Safe to call from inside a task.
+  void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+  size_t size() const {
+    return workers.size();
+  }
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+
+  std::mutex idle_mutex;
+  std::condition_variable idle_cv;
+  std::condition_variable done_cv;
+  std::atomic<size_t> pending{0};
+  std::atomic<size_t> queued{0};
+  std::atomic<size_t> next_queue{0};
+  bool stopping = false;
+
+  bool tryRun(size_t home);
+  void workerLoop(size_t index);
+};
@@ -0,0 +1,87 @@
+#include "TimingWheel.h"
+#include <algorithm>
+
+void TimingWheel::schedule(uint64_t time, uint32_t item) {
+  insert(Entry{time, item});
+  count++;
+}
+
+void TimingWheel::insert(const Entry& entry) {
+  uint64_t diff = entry.time ^ current;
+  int level = diff ? (63 - __builtin_clzll(diff)) / SLOT_BITS : 0;
+  int slot  = static_cast<int>(entry.time >> (level * SLOT_BITS)) & (SLOTS - 1);
+
+  Level& l = levels[level];
+  l.slots[slot].push_back(entry);
+  l.occupied[slot / 64] |= uint64_t(1) << (slot % 64);
+}
+
+// First busy slot at `level` with index >= `from`, or -1.
+int TimingWheel::findSlot(int level, int from) const {
+  const Level& l = levels[level];
+  for (int word = from / 64; word < SLOTS / 64; word++) {
+    uint64_t bits = l.occupied[word];
+    if (word == from / 64) {
+      bits &= ~uint64_t(0) << (from % 64);
+    }
+    if (bits) {
+      return word * 64 + __builtin_ctzll(bits);
+    }
+  }
+  return -1;
+}
+
+bool TimingWheel::next(uint64_t limit, std::vector<uint32_t>& items) {
+  if (count == 0) {
+    return false;
+  }
+
+  for (int level = 0; level < LEVELS; level++) {
+    int from = static_cast<int>(current >> (level * SLOT_BITS)) & (SLOTS - 1);
+    int slot = findSlot(level, from);
+    if (slot < 0) {
+      continue;
+    }
+
+    Level& l = levels[level];
+    std::vector<Entry>& entries = l.slots[slot];
+
+    if (level == 0) {
+      // Every entry in a level 0 slot is due at the same time
+      uint64_t time = (current & ~uint64_t(SLOTS - 1)) | static_cast<uint64_t>(slot);
+      if (time > limit) {
+        return false;
+      }
+      current = time;
+      for (const Entry& entry : entries) {
+        items.push_back(entry.item);
+      }
+      count -= entries.size();
+      entries.clear();
+      l.occupied[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+      return true;
+    }
+
+    // Move the wheel to the earliest time in this slot and spread the slot
+    // over the lower levels; then look again from level 0.
+    uint64_t earliest = entries.front().time;
+    for (const Entry& entry : entries) {
+      earliest = std::min(earliest, entry.time);
+    }
+    if (earliest > limit) {
+      return false;
+    }
+    current = earliest;
+
+    std::vector<Entry> cascade;
+    cascade.swap(entries);
+    l.occupied[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+    for (const Entry& entry : cascade) {
+      insert(entry);
+    }
+    cascade.clear();
+    entries.swap(cascade);  // keep the slot's capacity for reuse
+    level = -1;
+  }
+  return false;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Hierarchical timing wheel holding (time, item) pairs.
+//
+// There are 8 levels of 256 slots, one per byte of the 64-bit time. An entry
+// lives on the level of the highest byte in which its time differs from the
+// wheel's current time, in the slot named by that byte, so scheduling is O(1)
+// regardless of how far ahead the time is. Level 0 slots hold exactly one
+// time each; a higher-level slot is cascaded down into the lower levels only
+// when the wheel reaches it, so every entry moves at most 7 times. Occupancy
+// bitmaps let next() find the following busy slot without walking empty ones.
+class TimingWheel {
+public:
+  // `time` must not be earlier than now().
+  void schedule(uint64_t time, uint32_t item);
+
+  // Advances to the earliest scheduled time, if it is <= `limit`, and appends
+  // every item scheduled for that time to `items`. Returns false (and leaves
+  // the wheel untouched) when nothing is due by `limit`.
+  bool next(uint64_t limit, std::vector<uint32_t>& items);
+
+  uint64_t now() const {
+    return current;
+  }
+
+  size_t size() const {
+    return count;
+  }
+
+  bool empty() const {
+    return count == 0;
+  }
+
+private:
+  static constexpr int LEVELS    = 8;
+  static constexpr int SLOT_BITS = 8;
+  static constexpr int SLOTS     = 1 << SLOT_BITS;
+
+  struct Entry {
+    uint64_t time;
+    uint32_t item;
+  };
+
+  struct Level {
+    std::array<std::vector<Entry>, SLOTS> slots;
+    std::array<uint64_t, SLOTS / 64> occupied{};
+  };
+
+  std::array<Level, LEVELS> levels;
+  uint64_t current = 0;
+  size_t count = 0;
+
+  void insert(const Entry& entry);
+  int findSlot(int level, int from) const;
+};
@@ -1,22 +1,26 @@
 #pragma once
 #include <string>
-#include <unordered_set>
+#include <string_view>
 #include <algorithm>
+#include <cctype>
 #include <iomanip>   
 #include <sstream>   
+#include "Lexicon.h"
+#include "LineIndex.h"
+#include "Names.h"
+#include "Scan.h"
 
-enum class TokenType {
-  Identifier, Keyword, Literal, Operator, Symbol, EoF, EoL, Error,
+enum class TokenType : uint8_t {
+  Identifier, Keyword, Literal, Operator, Symbol, EoF, Error,
 };
 
-static std::string tokenTypeToString(TokenType type) {
+static std::string_view tokenTypeToString(TokenType type) {
   switch (type) {
     case TokenType::Keyword:   return "Keyword";
     case TokenType::Identifier:return "Identifier";
     case TokenType::Literal:   return "Literal";
     case TokenType::Operator:  return "Operator";
     case TokenType::Symbol:    return "Symbol";
-    case TokenType::EoL:       return "EoL";
     case TokenType::EoF:       return "EoF";
     case TokenType::Error:     return "Error";
     default:                   return "Unknown";
@@ -24,116 +28,145 @@ static std::string tokenTypeToString(TokenType type) {
 }
 
 
-static const std::unordered_set<std::string> IEEE_1076_VHDL_KEYWORDS = {
-  "access", "after", "alias", "all", "architecture", "array", "assert", "attribute",
-  "begin", "block", "body", "buffer", "bus", "case", "component", "configuration",
-  "constant", "disconnect", "downto", "else", "elsif", "end", "entity", "exit",
-  "file", "for", "function", "generate", "generic", "group", "guarded", "if",
-  "impure", "in", "inertial", "inout", "is", "label", "library", "linkage",
-  "literal", "loop", "map", "mod", "nand", "new", "next", "nor",            
-  "not", "null", "of", "on", "open", "or", "others", "out",
-  "package", "port", "postponed", "procedure", "process", "pure", "range", "record",
-  "reject", "rem", "report", "return", "rol", "ror", "select", "severity",
-  "signal", "shared", "sla", "sll", "sra", "srl", "subtype", "then",
-  "to", "transport", "type", "unaffected", "units", "until", "use", "variable",
-  "wait", "when", "while", "with", "xnor", "xor"
-};
-    
-static const std::unordered_set<std::string> IEEE_1076_VHDL_OPERATORS = {
-  "+", "-", "*", "/", "&", "=", "/=", "<", "<=", ">", ">=",
-  "=>", "**", ":=", "mod", "rem", "and", "or", "nand", "nor",
-  "xor", "xnor", "not", "rol", "ror", "sla", "sll", "sra", "srl",
-  "in", "not in", "abs", "??"
-};
-    
-static const std::unordered_set<std::string> IEEE_1076_VHDL_SYMBOLS = {
-  "(", ")", ",", ".", ":", ";", "'", "[", "]"
-};
-
+// A token is a view into the source buffer it was lexed from; the buffer must
+// outlive every token produced from it. The lowercased spelling is only built
+// when someone asks for it through getValue(). Tokens carry their byte offset
+// in the source; the lexer's LineIndex turns it into a line and column.
 class Token {
 public:
-  explicit Token(TokenType type, const std::string& str, int line, int col) {
-    this->type  = type;
-    this->value = str;
-    this->line  = line;
-    this->col   = col;
-    std::transform(this->value.begin(), this->value.end(), this->value.begin(), ::tolower);
-  }
-  explicit Token(const std::string& str, int line, int col){
-    this->value = str;
-    this->line  = line;
-    this->col   = col;
-    std::transform(this->value.begin(), this->value.end(), this->value.begin(), ::tolower);
+  Token() = default;
+  explicit Token(TokenType type, std::string_view text, size_t offset) {
+    this->type   = type;
+    this->text   = text;
+    this->offset = offset;
+  }
+  explicit Token(std::string_view text, size_t offset) {
+    this->text   = text;
+    this->offset = offset;
 
     // Determine token type
-    if (str.empty()) {
+    if (text.empty()) {
       type = TokenType::EoF;
-    } else if (str == "\n") {
-      type = TokenType::EoL;
-    } else if (isKeyword(str)) {
-      type = TokenType::Keyword;
-    } else if (isOperator(str)) {
-      type = TokenType::Operator;
-    } else if (isSymbol(str)) {
-      type = TokenType::Symbol;
-    } else if (isIdentifier(str)) {
+    } else if (const Reserved* reserved = lookupReserved(text)) {
+      this->keyword = reserved->keyword;
+      this->op      = reserved->op;
+      this->symbol  = reserved->symbol;
+      if (this->keyword != Keyword::None) {
+        type = TokenType::Keyword;
+      } else if (this->op != Operator::None) {
+        type = TokenType::Operator;
+      } else {
+        type = TokenType::Symbol;
+      }
+    } else if (isIdentifier(text)) {
       type = TokenType::Identifier;
     } else {
       type = TokenType::Literal;
     }
   }
 
-  static bool isKeyword(const std::string str) {
-    return IEEE_1076_VHDL_KEYWORDS.count(str);
+  static bool isKeyword(std::string_view str) {
+    const Reserved* reserved = lookupReserved(str);
+    return reserved && reserved->keyword != Keyword::None;
   }
   
-  static bool isOperator(const std::string str) {
-    return IEEE_1076_VHDL_OPERATORS.count(str);
+  static bool isOperator(std::string_view str) {
+    const Reserved* reserved = lookupReserved(str);
+    return reserved && reserved->op != Operator::None;
   }
 
-  static bool isSymbol(const std::string str) {
-    return IEEE_1076_VHDL_SYMBOLS.count(str);
+  static bool isSymbol(std::string_view str) {
+    const Reserved* reserved = lookupReserved(str);
+    return reserved && reserved->symbol != Symbol::None;
   }
 
-  static bool isIdentifier(const std::string str) {
-    if (str.empty() || !std::isalpha(str[0])) return false;
+  static bool isIdentifier(std::string_view str) {
+    if (str.empty() || !asciiAlpha(str[0])) return false;
     return std::all_of(str.begin(), str.end(), [](char c) {
-      return std::isalnum(c) || c == '_';
+      return asciiAlnum(c) || c == '_';
     });
   }
 
-  TokenType getTokenType() {
+  TokenType getTokenType() const {
     return this->type;
   }
 
-  int getCol() {
-    return this->col;
+  // Reserved-word ids; None unless the lexeme is in IEEE_1076_VHDL_RESERVED.
+  Keyword getKeyword() const {
+    return this->keyword;
+  }
+
+  Operator getOperator() const {
+    return this->op;
+  }
+
+  Symbol getSymbol() const {
+    return this->symbol;
+  }
+
+  // Interned spelling of identifiers and literals; NO_NAME for everything else.
+  NameId getName() const {
+    return this->name;
   }
 
-  int getLine() {
-    return this->line;
+  void setName(NameId name) {
+    this->name = name;
   }
 
-  std::string getValue() {
-    return this->value;
+  // Byte offset of the token in its source; for an Error token, of the
+  // character where lexing stopped.
+  size_t getOffset() const {
+    return this->offset;
+  }
+
+  void setOffset(size_t offset) {
+    this->offset = offset;
+  }
+
+  // Spelling exactly as it appears in the source buffer.
+  std::string_view getText() const {
+    return this->text;
+  }
+
+  // Lowercased spelling (VHDL is case-insensitive).
+  std::string getValue() const {
+    std::string value(this->text);
+    std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+    return value;
   }
 
   std::string toString() const {
-    return (this->value != "\n" ? this->value : "\\n");
+    return this->getValue();
   }
 
-  std::string toDebugString() const {
+  // `Keyword    "entity"  at 1:0`, written without temporaries. `location`
+  // is where the token starts, from the LineIndex of its source.
+  void writeDebug(std::ostream& out, SourceLocation location) const {
+    std::string_view kind = tokenTypeToString(type);
+    out << kind;
+    for (size_t pad = kind.size(); pad < 10; pad++) {
+      out.put(' ');
+    }
+    out << " \"";
+    for (char c : text) {
+      out.put(static_cast<char>(::tolower(static_cast<unsigned char>(c))));
+    }
+    out << "\"  at " << location.line << ":" << location.col;
+  }
+
+  std::string toDebugString(SourceLocation location) const {
     std::ostringstream oss;
-    oss << std::left << std::setw(10) << ((tokenTypeToString(type) == "\n") ? "\\n" : tokenTypeToString(type))
-        << " \"" << this->toString() << "\""
-        << "  at " << line << ":" << col;
+    writeDebug(oss, location);
     return oss.str();
   }
 
 
 private:
-  TokenType type;
-  std::string value;
-  int line;
-  int col;
-};
\ No newline at end of file
+  TokenType type = TokenType::EoF;
+  Keyword  keyword = Keyword::None;
+  Operator op      = Operator::None;
+  Symbol   symbol  = Symbol::None;
+  NameId   name    = NO_NAME;
+  std::string_view text;
+  size_t offset = 0;
+};
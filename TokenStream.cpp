@@ -0,0 +1,49 @@
+#include "TokenStream.h"
+#include "Lexer.h"
+
+TokenStream::TokenStream(Lexer& lexer) {
+  this->lexer = &lexer;
+}
+
+TokenStream::TokenStream(const std::vector<Token>& tokens, const LineIndex& lines) {
+  this->tokens = &tokens;
+  this->lines  = &lines;
+}
+
+SourceLocation TokenStream::locate(const Token& token) const {
+  return lexer ? lexer->locate(token) : lines->locate(token.getOffset());
+}
+
+Token TokenStream::pull() {
+  Token token = Token(TokenType::EoF, "", 0);
+  if (lexer) {
+    token = lexer->getNextToken();
+  } else if (next_index < tokens->size()) {
+    token = (*tokens)[next_index++];
+  }
+
+  if (token.getTokenType() == TokenType::Error) {
+    throw LexError(token, locate(token));
+  }
+  return token;
+}
+
+void TokenStream::fill(size_t needed) {
+  while (count < needed) {
+    ring[(head + count) & (LOOKAHEAD - 1)] = pull();
+    count++;
+  }
+}
+
+const Token& TokenStream::peek(size_t ahead) {
+  fill(ahead + 1);
+  return ring[(head + ahead) & (LOOKAHEAD - 1)];
+}
+
+Token TokenStream::advance() {
+  fill(1);
+  Token token = ring[head];
+  head = (head + 1) & (LOOKAHEAD - 1);
+  count--;
+  return token;
+}
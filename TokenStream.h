@@ -0,0 +1,55 @@
+#pragma once
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Token.h"
+
+class Lexer;
+
+// Raised when the lexer hands the stream an Error token.
+class LexError : public std::runtime_error {
+public:
+  LexError(const Token& token, SourceLocation location)
+    : std::runtime_error(token.getValue() + ", line: " + std::to_string(location.line) +
+                         " ," + std::to_string(location.col)),
+      line(location.line), col(location.col) {}
+
+  int line;
+  int col;
+};
+
+// Pull-based token source for the parser. Tokens are lexed on demand into a
+// small ring buffer, so only the lookahead window is ever held in memory and
+// parsing proceeds as the input is lexed. Tokens carry only their offset;
+// locate() turns it into a line and column when one is needed.
+class TokenStream {
+public:
+  explicit TokenStream(Lexer& lexer);
+
+  // Replays tokens that were already lexed into a vector; `lines` indexes
+  // the text their offsets refer to.
+  TokenStream(const std::vector<Token>& tokens, const LineIndex& lines);
+
+  // Token `ahead` positions past the current one (at most LOOKAHEAD - 1).
+  const Token& peek(size_t ahead = 0);
+  Token advance();
+
+  SourceLocation locate(const Token& token) const;
+
+  static constexpr size_t LOOKAHEAD = 8;
+
+private:
+  static_assert((LOOKAHEAD & (LOOKAHEAD - 1)) == 0, "ring size must be a power of two");
+
+  Lexer* lexer = nullptr;
+  const std::vector<Token>* tokens = nullptr;
+  const LineIndex* lines = nullptr;
+  size_t next_index = 0;
+
+  Token ring[LOOKAHEAD];
+  size_t head  = 0;
+  size_t count = 0;
+
+  Token pull();
+  void fill(size_t needed);
+};
@@ -0,0 +1,460 @@
+#include "Value.h"
+#include <charconv>
+#include <cstdlib>
+
+std::string typeName(TypeKind kind) {
+  switch (kind) {
+    case TypeKind::Bit:       return "bit";
+    case TypeKind::Boolean:   return "boolean";
+    case TypeKind::Integer:   return "integer";
+    case TypeKind::BitVector: return "bit_vector";
+  }
+  return "unknown";
+}
+
+std::string ValueType::toString() const {
+  if (kind == TypeKind::Integer && right == INTEGER_HIGH && (left == 0 || left == 1 || left == INTEGER_LOW)) {
+    return left == 0 ? "natural" : left == 1 ? "positive" : "integer";
+  }
+  if (kind == TypeKind::Integer) {
+    return "integer range " + std::to_string(left) + " to " + std::to_string(right);
+  }
+  if (kind != TypeKind::BitVector) {
+    return typeName(kind);
+  }
+  return "bit_vector(" + std::to_string(left) + (left >= right ? " downto " : " to ") + std::to_string(right) + ")";
+}
+
+static int64_t parseBound(NameId bound) {
+  std::string_view text = NameTable::global().spelling(bound);
+  if (text.empty()) {
+    throw std::runtime_error("missing bit_vector bound");
+  }
+  return parseLiteral(text, std::string_view()).scalar;
+}
+
+ValueType ValueType::fromInterfaceType(const InterfaceType& type) {
+  static const NameId bit        = NameTable::global().intern("bit");
+  static const NameId boolean    = NameTable::global().intern("boolean");
+  static const NameId integer    = NameTable::global().intern("integer");
+  static const NameId natural    = NameTable::global().intern("natural");
+  static const NameId positive   = NameTable::global().intern("positive");
+  static const NameId bit_vector = NameTable::global().intern("bit_vector");
+
+  ValueType result;
+  if (type.identifier == bit) {
+    result.kind = TypeKind::Bit;
+  } else if (type.identifier == boolean) {
+    result.kind = TypeKind::Boolean;
+  } else if (type.identifier == integer) {
+    result = ValueType::integer();
+  } else if (type.identifier == natural) {
+    result = ValueType::integer(0);
+  } else if (type.identifier == positive) {
+    result = ValueType::integer(1);
+  } else if (type.identifier == bit_vector) {
+    result.kind  = TypeKind::BitVector;
+    result.left  = parseBound(type.upper);
+    result.right = parseBound(type.lower);
+    if ((type.direction == Keyword::Downto) != (result.left >= result.right) && result.left != result.right) {
+      throw std::runtime_error("null range in " + type.toString());
+    }
+  } else {
+    throw std::runtime_error("unsupported type '" + NameTable::global().str(type.identifier) + "'");
+  }
+  return result;
+}
+
+Value Value::makeBit(bool bit) {
+  Value value;
+  value.kind   = TypeKind::Bit;
+  value.scalar = bit;
+  return value;
+}
+
+Value Value::makeBoolean(bool boolean) {
+  Value value;
+  value.kind   = TypeKind::Boolean;
+  value.scalar = boolean;
+  return value;
+}
+
+Value Value::makeInteger(int64_t integer) {
+  Value value;
+  value.kind   = TypeKind::Integer;
+  value.scalar = integer;
+  return value;
+}
+
+Value Value::makeVector(size_t width, bool fill) {
+  Value value;
+  value.kind = TypeKind::BitVector;
+  value.bits = BitVector(width, fill);
+  return value;
+}
+
+Value Value::defaultFor(const ValueType& type) {
+  switch (type.kind) {
+    case TypeKind::Bit:       return makeBit(false);
+    case TypeKind::Boolean:   return makeBoolean(false);
+    case TypeKind::Integer:   return makeInteger(type.left);
+    case TypeKind::BitVector: return makeVector(type.width(), false);
+  }
+  return Value();
+}
+
+std::string Value::toString() const {
+  switch (kind) {
+    case TypeKind::Bit:     return scalar ? "'1'" : "'0'";
+    case TypeKind::Boolean: return scalar ? "true" : "false";
+    case TypeKind::Integer: return std::to_string(scalar);
+    case TypeKind::BitVector: return "\"" + bits.toString() + "\"";
+  }
+  return "?";
+}
+
+void checkAssignable(const ValueType& type, const Value& value, NameId target) {
+  if (value.kind != type.kind) {
+    throw std::runtime_error("cannot assign " + typeName(value.kind) + " to '" +
+                             NameTable::global().str(target) + "' of type " + type.toString());
+  }
+  if (type.kind == TypeKind::BitVector && value.bits.width() != type.width()) {
+    throw std::runtime_error("cannot assign " + std::to_string(value.bits.width()) + " bits to '" +
+                             NameTable::global().str(target) + "' of type " + type.toString());
+  }
+  if (type.kind == TypeKind::Integer) {
+    checkRange(type, value.scalar, target);
+  }
+}
+
+std::runtime_error rangeError(const ValueType& type, int64_t value, NameId target) {
+  return std::runtime_error("value " + std::to_string(value) + " is out of range for '" +
+                            NameTable::global().str(target) + "' of type " + type.toString());
+}
+
+// ---------------------------------------------------------------------------
+// Literals
+
+static int64_t parseInteger(std::string_view text) {
+  std::string_view literal = text;
+  int base = 10;
+  size_t hash = text.find('#');
+  if (hash != std::string_view::npos) {
+    base = static_cast<int>(parseInteger(text.substr(0, hash)));
+    text = text.substr(hash + 1, text.size() - hash - 2);
+    if (base < 2 || base > 16) {
+      throw std::runtime_error("invalid base in literal");
+    }
+  }
+
+  int64_t value = 0;
+  for (char c : text) {
+    if (c == '_') continue;
+    int digit = asciiDigit(c) ? c - '0' : lowerAscii(c) - 'a' + 10;
+    if (digit < 0 || digit >= base) {
+      throw std::runtime_error("invalid digit in literal '" + std::string(text) + "'");
+    }
+    if (__builtin_mul_overflow(value, base, &value) || __builtin_add_overflow(value, digit, &value)) {
+      throw std::runtime_error("literal out of range: " + std::string(literal));
+    }
+  }
+  return value;
+}
+
+int64_t timeUnitScale(std::string_view unit) {
+  static const struct { std::string_view name; int64_t scale; } units[] = {
+    { "fs", 1 }, { "ps", 1000 }, { "ns", 1000000 }, { "us", 1000000000 },
+    { "ms", 1000000000000 }, { "sec", 1000000000000000 },
+  };
+  for (const auto& entry : units) {
+    if (entry.name.size() == unit.size() &&
+        std::equal(unit.begin(), unit.end(), entry.name.begin(), [](char a, char b) { return lowerAscii(a) == b; })) {
+      return entry.scale;
+    }
+  }
+  throw std::runtime_error("unknown time unit '" + std::string(unit) + "'");
+}
+
+Value parseLiteral(std::string_view text, std::string_view unit) {
+  if (text.size() == 3 && text.front() == '\'') {
+    if (text[1] != '0' && text[1] != '1') {
+      throw std::runtime_error("unsupported character literal " + std::string(text));
+    }
+    return Value::makeBit(text[1] == '1');
+  }
+
+  if (text.size() >= 2 && text.front() == '"') {
+    Value value;
+    value.kind = TypeKind::BitVector;
+    value.bits = BitVector::fromString(text.substr(1, text.size() - 2));
+    return value;
+  }
+
+  if (!unit.empty()) {
+    int64_t scale = timeUnitScale(unit);
+    int64_t value;
+    if (text.find('.') != std::string_view::npos) {
+      // 2^63, the first double past the int64_t range
+      double scaled = std::strtod(std::string(text).c_str(), nullptr) * scale + 0.5;
+      if (!(scaled < 9223372036854775808.0)) {
+        throw std::runtime_error("literal out of range: " + std::string(text) + " " + std::string(unit));
+      }
+      return Value::makeInteger(static_cast<int64_t>(scaled));
+    }
+    if (__builtin_mul_overflow(parseInteger(text), scale, &value)) {
+      throw std::runtime_error("literal out of range: " + std::string(text) + " " + std::string(unit));
+    }
+    return Value::makeInteger(value);
+  }
+
+  if (text.find('.') != std::string_view::npos) {
+    throw std::runtime_error("real literals are not supported: " + std::string(text));
+  }
+  return Value::makeInteger(parseInteger(text));
+}
+
+int64_t parseTime(std::string_view text) {
+  size_t split = 0;
+  while (split < text.size() && (asciiDigit(text[split]) || text[split] == '.' || text[split] == '_')) {
+    split++;
+  }
+  std::string_view number = text.substr(0, split);
+  std::string_view unit = text.substr(split);
+  while (!unit.empty() && unit.front() == ' ') {
+    unit.remove_prefix(1);
+  }
+  if (number.empty()) {
+    throw std::runtime_error("invalid time '" + std::string(text) + "'");
+  }
+  return parseLiteral(number, unit.empty() ? std::string_view("ns") : unit).scalar;
+}
+
+std::string formatTime(uint64_t time) {
+  static const char* names[] = { "fs", "ps", "ns", "us", "ms", "sec" };
+  size_t unit = 0;
+  while (unit + 1 < sizeof(names) / sizeof(names[0]) && time != 0 && time % 1000 == 0) {
+    time /= 1000;
+    unit++;
+  }
+  return std::to_string(time) + " " + names[unit];
+}
+
+Value parseValue(const ValueType& type, std::string_view text) {
+  if (text.size() >= 2 && (text.front() == '\'' || text.front() == '"') && text.back() == text.front()) {
+    text = text.substr(1, text.size() - 2);
+  }
+  switch (type.kind) {
+    case TypeKind::Bit:
+      if (text == "0" || text == "1") return Value::makeBit(text == "1");
+      break;
+    case TypeKind::Boolean:
+      if (text == "true" || text == "false") return Value::makeBoolean(text == "true");
+      break;
+    case TypeKind::Integer: {
+      // from_chars takes a '-' but no '+'
+      std::string_view digits = text.size() > 1 && text[0] == '+' && text[1] != '-' ? text.substr(1) : text;
+      int64_t value = 0;
+      const char* last = digits.data() + digits.size();
+      auto parsed = std::from_chars(digits.data(), last, value);
+      if (!digits.empty() && parsed.ec == std::errc() && parsed.ptr == last) return Value::makeInteger(value);
+      break;
+    }
+    case TypeKind::BitVector:
+      return parseLiteral("\"" + std::string(text) + "\"", std::string_view());
+  }
+  throw std::runtime_error("'" + std::string(text) + "' is not a valid " + type.toString());
+}
+
+// ---------------------------------------------------------------------------
+// Operators
+
+static std::runtime_error operandError(Operator op, const Value& left, const Value* right) {
+  std::string message = "operator '" + std::string(operatorSpelling(op)) + "' is not defined for " + typeName(left.kind);
+  if (right) {
+    message += " and " + typeName(right->kind);
+  }
+  return std::runtime_error(message);
+}
+
+static bool logical(Operator op, bool a, bool b) {
+  switch (op) {
+    case Operator::And:  return a && b;
+    case Operator::Or:   return a || b;
+    case Operator::Xor:  return a != b;
+    case Operator::Nand: return !(a && b);
+    case Operator::Nor:  return !(a || b);
+    case Operator::Xnor: return a == b;
+    default:             return false;
+  }
+}
+
+// Lexicographic for vectors, numeric for scalars.
+static int compare(const Value& left, const Value& right) {
+  if (left.kind == TypeKind::BitVector) {
+    return left.bits.compare(right.bits);
+  }
+  return left.scalar == right.scalar ? 0 : (left.scalar < right.scalar ? -1 : 1);
+}
+
+static Value vectorValue(BitVector bits) {
+  Value value;
+  value.kind = TypeKind::BitVector;
+  value.bits = std::move(bits);
+  return value;
+}
+
+// Element 0 is the rightmost one, so sll/sla move bits to higher indices.
+static Value shift(Operator op, const Value& vector, int64_t amount) {
+  const BitVector& bits = vector.bits;
+  size_t width = bits.width();
+  if (width == 0) {
+    return vector;
+  }
+  if (amount < 0) {
+    // A negative amount shifts the other way
+    static const Operator opposite[][2] = {
+      { Operator::Sll, Operator::Srl }, { Operator::Sla, Operator::Sra },
+      { Operator::Rol, Operator::Ror },
+    };
+    for (const auto& pair : opposite) {
+      if (pair[0] == op) return shift(pair[1], vector, -amount);
+      if (pair[1] == op) return shift(pair[0], vector, -amount);
+    }
+  }
+
+  size_t n = static_cast<size_t>(amount);
+  switch (op) {
+    case Operator::Sll: return vectorValue(bits.shiftLeft(n, false));
+    case Operator::Srl: return vectorValue(bits.shiftRight(n, false));
+    case Operator::Sla: return vectorValue(bits.shiftLeft(n, bits.get(0)));
+    case Operator::Sra: return vectorValue(bits.shiftRight(n, bits.get(width - 1)));
+    case Operator::Rol: return vectorValue(bits.rotateLeft(n % width));
+    default:            return vectorValue(bits.rotateLeft(width - n % width));
+  }
+}
+
+std::runtime_error overflowError(Operator op) {
+  return std::runtime_error("result of operator '" + std::string(operatorSpelling(op)) + "' is out of range");
+}
+
+// By squaring; an overflowing square is always part of the result
+int64_t powerInteger(int64_t a, int64_t b) {
+  if (b < 0) {
+    throw std::runtime_error("negative exponent");
+  }
+  int64_t result = 1;
+  while (b > 0) {
+    if ((b & 1) && __builtin_mul_overflow(result, a, &result)) {
+      throw overflowError(Operator::Power);
+    }
+    b >>= 1;
+    if (b > 0 && __builtin_mul_overflow(a, a, &a)) {
+      throw overflowError(Operator::Power);
+    }
+  }
+  return result;
+}
+
+Value evaluateUnary(Operator op, const Value& operand) {
+  switch (op) {
+    case Operator::Not:
+      if (operand.kind == TypeKind::Bit)     return Value::makeBit(!operand.scalar);
+      if (operand.kind == TypeKind::Boolean) return Value::makeBoolean(!operand.scalar);
+      if (operand.kind == TypeKind::BitVector) {
+        return vectorValue(~operand.bits);
+      }
+      break;
+    case Operator::Minus:
+      if (operand.kind == TypeKind::Integer) return Value::makeInteger(negateInteger(operand.scalar));
+      break;
+    case Operator::Plus:
+      if (operand.kind == TypeKind::Integer) return operand;
+      break;
+    case Operator::Abs:
+      if (operand.kind == TypeKind::Integer) return Value::makeInteger(absInteger(operand.scalar));
+      break;
+    default:
+      break;
+  }
+  throw operandError(op, operand, nullptr);
+}
+
+Value evaluateBinary(Operator op, const Value& left, const Value& right) {
+  switch (op) {
+    case Operator::And: case Operator::Or: case Operator::Xor:
+    case Operator::Nand: case Operator::Nor: case Operator::Xnor:
+      if (left.kind != right.kind) break;
+      if (left.kind == TypeKind::Bit)     return Value::makeBit(logical(op, left.scalar, right.scalar));
+      if (left.kind == TypeKind::Boolean) return Value::makeBoolean(logical(op, left.scalar, right.scalar));
+      if (left.kind == TypeKind::BitVector) {
+        if (left.bits.width() != right.bits.width()) {
+          throw std::runtime_error("operator '" + std::string(operatorSpelling(op)) + "' on bit_vectors of different lengths");
+        }
+        return vectorValue(BitVector::logic(op, left.bits, right.bits));
+      }
+      break;
+
+    case Operator::Equal:
+    case Operator::NotEqual:
+      if (left.kind != right.kind) break;
+      return Value::makeBoolean((compare(left, right) == 0) == (op == Operator::Equal));
+
+    case Operator::Less:
+    case Operator::LessEqual:
+    case Operator::Greater:
+    case Operator::GreaterEqual: {
+      if (left.kind != right.kind) break;
+      int order = compare(left, right);
+      bool result = op == Operator::Less      ? order < 0
+                  : op == Operator::LessEqual ? order <= 0
+                  : op == Operator::Greater   ? order > 0
+                  :                             order >= 0;
+      return Value::makeBoolean(result);
+    }
+
+    case Operator::Concat: {
+      if ((left.kind != TypeKind::Bit && left.kind != TypeKind::BitVector) ||
+          (right.kind != TypeKind::Bit && right.kind != TypeKind::BitVector)) {
+        break;
+      }
+      BitVector left_bit, right_bit;
+      const BitVector& high = left.kind == TypeKind::Bit ? (left_bit = BitVector(1, left.scalar != 0)) : left.bits;
+      const BitVector& low  = right.kind == TypeKind::Bit ? (right_bit = BitVector(1, right.scalar != 0)) : right.bits;
+      return vectorValue(BitVector::concat(high, low));
+    }
+
+    case Operator::Sll: case Operator::Srl: case Operator::Sla:
+    case Operator::Sra: case Operator::Rol: case Operator::Ror:
+      if (left.kind != TypeKind::BitVector || right.kind != TypeKind::Integer) break;
+      return shift(op, left, right.scalar);
+
+    case Operator::Plus: case Operator::Minus: case Operator::Multiply:
+    case Operator::Divide: case Operator::Mod: case Operator::Rem: case Operator::Power: {
+      if (left.kind != TypeKind::Integer || right.kind != TypeKind::Integer) break;
+      int64_t a = left.scalar, b = right.scalar;
+      if ((op == Operator::Divide || op == Operator::Mod || op == Operator::Rem) && b == 0) {
+        throw std::runtime_error("division by zero");
+      }
+      switch (op) {
+        case Operator::Plus:     return Value::makeInteger(addInteger(a, b));
+        case Operator::Minus:    return Value::makeInteger(subtractInteger(a, b));
+        case Operator::Multiply: return Value::makeInteger(multiplyInteger(a, b));
+        // The one quotient past 64 bits is INT64_MIN / -1; its remainder is 0
+        case Operator::Divide:
+          if (a == INT64_MIN && b == -1) throw overflowError(op);
+          return Value::makeInteger(a / b);
+        case Operator::Rem:      return Value::makeInteger(b == -1 ? 0 : a % b);
+        case Operator::Mod: {
+          int64_t m = b == -1 ? 0 : a % b;
+          return Value::makeInteger((m != 0 && ((m < 0) != (b < 0))) ? m + b : m);
+        }
+        default:
+          return Value::makeInteger(powerInteger(a, b));
+      }
+    }
+
+    default:
+      break;
+  }
+  throw operandError(op, left, &right);
+}
@@ -0,0 +1,193 @@
+#pragma once
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Node.h"
+#include "BitVector.h"
+
+// Runtime values of the simulator.
+
+// Simulated time in femtoseconds.
+using SimTime = uint64_t;
+
+enum class TypeKind : uint8_t {
+  Bit, Boolean, Integer, BitVector,
+};
+
+// "bit", "boolean", "integer", "bit_vector"
+std::string typeName(TypeKind kind);
+
+// Subtype of a signal, variable or constant.
+struct ValueType {
+  TypeKind kind = TypeKind::Bit;
+  int64_t  left  = 0;  // index range of a bit_vector, value range of an integer
+  int64_t  right = 0;
+
+  static constexpr int64_t INTEGER_LOW  = -2147483647 - 1;
+  static constexpr int64_t INTEGER_HIGH = 2147483647;
+
+  // An integer subtype; `integer` itself spans 32 bits.
+  static ValueType integer(int64_t low = INTEGER_LOW, int64_t high = INTEGER_HIGH) {
+    ValueType type;
+    type.kind  = TypeKind::Integer;
+    type.left  = low;
+    type.right = high;
+    return type;
+  }
+
+  bool contains(int64_t value) const {
+    return value >= left && value <= right;
+  }
+
+  size_t width() const {
+    if (kind != TypeKind::BitVector) return 1;
+    return static_cast<size_t>((left >= right ? left - right : right - left) + 1);
+  }
+
+  std::string toString() const;
+
+  // Resolves `bit`, `boolean`, `integer`/`natural`/`positive` and
+  // `bit_vector(L downto R)` / `bit_vector(L to R)`.
+  static ValueType fromInterfaceType(const InterfaceType& type);
+};
+
+class Value {
+public:
+  TypeKind kind  = TypeKind::Bit;
+  int64_t scalar = 0;          // bit and boolean (0/1), integer
+  BitVector bits;              // bit_vector elements, packed
+
+  static Value makeBit(bool bit);
+  static Value makeBoolean(bool value);
+  static Value makeInteger(int64_t value);
+  static Value makeVector(size_t width, bool fill);
+
+  // T'left of the type: '0', false, the low bound of an integer subtype
+  // (natural 0, positive 1), all zeros.
+  static Value defaultFor(const ValueType& type);
+
+  bool operator==(const Value& other) const {
+    return kind == other.kind && scalar == other.scalar && bits == other.bits;
+  }
+
+  bool operator!=(const Value& other) const {
+    return !(*this == other);
+  }
+
+  // '1', true, 42, "1100"
+  std::string toString() const;
+};
+
+// Throws std::runtime_error when `value` cannot be stored in an object of `type`.
+void checkAssignable(const ValueType& type, const Value& value, NameId target);
+
+std::runtime_error rangeError(const ValueType& type, int64_t value, NameId target);
+
+// Throws std::runtime_error when an integer is outside the range of `type`.
+inline void checkRange(const ValueType& type, int64_t value, NameId target) {
+  if (!type.contains(value)) {
+    throw rangeError(type, value, target);
+  }
+}
+
+// `text` is a literal as lexed ('1', "1100", 42, 16#FF#); a physical literal
+// such as `5 ns` has its unit in `unit` and evaluates to femtoseconds.
+Value parseLiteral(std::string_view text, std::string_view unit);
+
+// Femtoseconds per time unit (fs, ps, ns, us, ms, sec); throws for anything else.
+int64_t timeUnitScale(std::string_view unit);
+
+// Parses a time given on the command line, such as `100ns` or `2 us`.
+int64_t parseTime(std::string_view text);
+
+// Largest unit that represents `time` exactly, e.g. "20 ns".
+std::string formatTime(uint64_t time);
+
+// Parses a value of `type` given on the command line: 0/1 (or '0'/'1') for a
+// bit, a string of 0s and 1s for a bit_vector, true/false, or an integer.
+Value parseValue(const ValueType& type, std::string_view text);
+
+Value evaluateUnary(Operator op, const Value& operand);
+Value evaluateBinary(Operator op, const Value& left, const Value& right);
+
+// Integer operators. A result that does not fit in 64 bits throws
+// overflowError() instead of wrapping, so it cannot slip past checkRange().
+std::runtime_error overflowError(Operator op);
+int64_t powerInteger(int64_t a, int64_t b);
+
+inline int64_t addInteger(int64_t a, int64_t b) {
+  int64_t result;
+  if (__builtin_add_overflow(a, b, &result)) {
+    throw overflowError(Operator::Plus);
+  }
+  return result;
+}
+
+inline int64_t subtractInteger(int64_t a, int64_t b) {
+  int64_t result;
+  if (__builtin_sub_overflow(a, b, &result)) {
+    throw overflowError(Operator::Minus);
+  }
+  return result;
+}
+
+inline int64_t multiplyInteger(int64_t a, int64_t b) {
+  int64_t result;
+  if (__builtin_mul_overflow(a, b, &result)) {
+    throw overflowError(Operator::Multiply);
+  }
+  return result;
+}
+
+inline int64_t negateInteger(int64_t a) {
+  if (a == INT64_MIN) {
+    throw overflowError(Operator::Minus);
+  }
+  return -a;
+}
+
+inline int64_t absInteger(int64_t a) {
+  if (a == INT64_MIN) {
+    throw overflowError(Operator::Abs);
+  }
+  return a < 0 ? -a : a;
+}
+
+// Evaluates `expr` over the AST. `lookup(NameId)` returns the current value of
+// a name; `expected` is the subtype of the target, which gives `others`
+// aggregates their width (it may be null when there is no target).
+template <class Lookup>
+Value evaluateExpression(const Expression* expr, const ValueType* expected, Lookup&& lookup) {
+  switch (expr->kind) {
+    case ExpressionKind::Name:
+      return lookup(expr->identifier());
+
+    case ExpressionKind::Literal: {
+      std::string_view unit = expr->unit() == NO_NAME ? std::string_view() : NameTable::global().spelling(expr->unit());
+      return parseLiteral(NameTable::global().spelling(expr->text()), unit);
+    }
+
+    case ExpressionKind::Unary:
+      return evaluateUnary(expr->op, evaluateExpression(expr->operand(), expected, lookup));
+
+    case ExpressionKind::Binary: {
+      Value left  = evaluateExpression(expr->left(), nullptr, lookup);
+      Value right = evaluateExpression(expr->right(), nullptr, lookup);
+      return evaluateBinary(expr->op, left, right);
+    }
+
+    case ExpressionKind::Aggregate: {
+      if (!expected || expected->kind != TypeKind::BitVector) {
+        throw std::runtime_error("'others' aggregate needs a bit_vector target");
+      }
+      Value element = evaluateExpression(expr->others(), nullptr, lookup);
+      if (element.kind != TypeKind::Bit) {
+        throw std::runtime_error("'others' aggregate element must be a bit");
+      }
+      return Value::makeVector(expected->width(), element.scalar != 0);
+    }
+  }
+  throw std::runtime_error("unknown expression kind");
+}
@@ -0,0 +1,648 @@
+#include "Waveform.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+static bool globFrom(std::string_view pattern, std::string_view path) {
+  while (!pattern.empty()) {
+    if (pattern[0] == '*') {
+      bool deep = pattern.size() > 1 && pattern[1] == '*';
+      std::string_view rest = pattern.substr(deep ? 2 : 1);
+      for (size_t i = 0;; i++) {
+        if (globFrom(rest, path.substr(i))) return true;
+        if (i == path.size() || (!deep && path[i] == '.')) return false;
+      }
+    }
+    if (path.empty()) return false;
+    if (pattern[0] == '?' ? path[0] == '.'
+                          : std::tolower(static_cast<unsigned char>(pattern[0])) !=
+                            std::tolower(static_cast<unsigned char>(path[0]))) {
+      return false;
+    }
+    pattern.remove_prefix(1);
+    path.remove_prefix(1);
+  }
+  return path.empty();
+}
+
+bool matchesGlob(std::string_view pattern, std::string_view path) {
+  return globFrom(pattern, path);
+}
+
+// ---------------------------------------------------------------------------
+// Encoders. Both run on the writer thread and get every change with the value
+// as the words recorded by WaveformWriter::record().
+
+class WaveformEncoder {
+public:
+  virtual ~WaveformEncoder() = default;
+  virtual void change(SimTime time, uint32_t index, const uint64_t* value) = 0;
+  virtual void finish(SimTime end) = 0;
+};
+
+static std::ofstream createFile(const std::string& path) {
+  std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+  if (!stream) {
+    throw std::runtime_error("cannot create waveform file " + path);
+  }
+  return stream;
+}
+
+static void writeOut(std::ofstream& stream, std::string& buffer) {
+  stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+  if (!stream) {
+    throw std::runtime_error("cannot write waveform file");
+  }
+  buffer.clear();
+}
+
+static constexpr size_t OUTPUT_BUFFER = 1 << 20;
+
+class VcdEncoder : public WaveformEncoder {
+public:
+  VcdEncoder(const std::string& path, NameId entity, const std::vector<WaveformSignal>& signals,
+             const std::vector<std::vector<uint64_t>>& initial)
+    : stream(createFile(path)), signals(signals) {
+    out += "$version vhdl_sim $end\n$timescale 1 fs $end\n";
+    out += "$scope module " + NameTable::global().str(entity) + " $end\n";
+    for (size_t i = 0; i < signals.size(); i++) {
+      const WaveformSignal& signal = signals[i];
+      codes.push_back(identifierCode(i));
+      std::string leaf = signal.name.substr(signal.name.rfind('.') + 1);
+      switch (signal.type.kind) {
+        case TypeKind::Bit:
+        case TypeKind::Boolean:
+          out += "$var wire 1 " + codes[i] + " " + leaf + " $end\n";
+          break;
+        case TypeKind::Integer:
+          out += "$var integer 64 " + codes[i] + " " + leaf + " $end\n";
+          break;
+        case TypeKind::BitVector:
+          out += "$var wire " + std::to_string(signal.type.width()) + " " + codes[i] + " " + leaf + " [" +
+                 std::to_string(signal.type.left) + ":" + std::to_string(signal.type.right) + "] $end\n";
+          break;
+      }
+    }
+    out += "$upscope $end\n$enddefinitions $end\n#0\n$dumpvars\n";
+    for (size_t i = 0; i < signals.size(); i++) {
+      appendValue(static_cast<uint32_t>(i), initial[i].data());
+    }
+    out += "$end\n";
+  }
+
+  void change(SimTime time, uint32_t index, const uint64_t* value) override {
+    if (time != last_time) {
+      out += '#';
+      out += std::to_string(time);
+      out += '\n';
+      last_time = time;
+    }
+    appendValue(index, value);
+    if (out.size() >= OUTPUT_BUFFER) {
+      writeOut(stream, out);
+    }
+  }
+
+  void finish(SimTime end) override {
+    if (end > last_time) {
+      out += "#" + std::to_string(end) + "\n";
+    }
+    writeOut(stream, out);
+    stream.close();
+  }
+
+private:
+  std::ofstream stream;
+  const std::vector<WaveformSignal>& signals;
+  std::vector<std::string> codes;
+  std::string out;
+  SimTime last_time = 0;
+
+  // "!", "\"", ..., "~", "!!", ...: printable ASCII, base 94
+  static std::string identifierCode(size_t index) {
+    std::string code;
+    do {
+      code += static_cast<char>('!' + index % 94);
+      index /= 94;
+    } while (index != 0);
+    return code;
+  }
+
+  void appendValue(uint32_t index, const uint64_t* value) {
+    const ValueType& type = signals[index].type;
+    if (type.kind == TypeKind::Bit || type.kind == TypeKind::Boolean) {
+      out += value[0] ? '1' : '0';
+    } else {
+      size_t width = type.kind == TypeKind::Integer ? 64 : type.width();
+      out += 'b';
+      for (size_t bit = width; bit-- > 0;) {
+        out += (value[bit / 64] >> (bit % 64)) & 1 ? '1' : '0';
+      }
+      out += ' ';
+    }
+    out += codes[index];
+    out += '\n';
+  }
+};
+
+// Binary format, all integers little-endian:
+//
+//   header   "VHDLWAVE", u32 version, u32 signal count, then per signal:
+//            u8 kind, i64 left, i64 right, u32 name length, name
+//   blocks   u64 first time, u32 raw size, u32 stored size, u32 change count,
+//            then the payload, LZ-compressed unless stored size == raw size
+//   index    per block: u64 first time, u64 file offset
+//   trailer  u64 index offset, u64 block count, u64 end time, "WAVEIDX\0"
+//
+// A payload holds the value of every signal before the block's first change,
+// then the changes: varint time delta from the previous change (the first
+// from the block's first time), varint signal index, value. Scalars are
+// zigzag varints, bit_vectors their packed bits in (width + 7) / 8 bytes.
+
+static const char WAVE_MAGIC[8] = {'V', 'H', 'D', 'L', 'W', 'A', 'V', 'E'};
+static const char INDEX_MAGIC[8] = {'W', 'A', 'V', 'E', 'I', 'D', 'X', '\0'};
+static constexpr uint32_t WAVE_VERSION = 1;
+static constexpr size_t BLOCK_BYTES = 1 << 16;
+static constexpr size_t TRAILER = 32;
+
+template <class T>
+static void putRaw(std::string& out, T value) {
+  char bytes[sizeof(T)];
+  std::memcpy(bytes, &value, sizeof(T));
+  out.append(bytes, sizeof(T));
+}
+
+static void putVarint(std::string& out, uint64_t value) {
+  while (value >= 0x80) {
+    out += static_cast<char>((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  out += static_cast<char>(value);
+}
+
+// Reads the binary format, checking every access against the end of the data.
+class WaveCursor {
+public:
+  WaveCursor(std::string_view data, size_t pos = 0) : data(data), pos(pos) {}
+
+  template <class T>
+  T raw() {
+    need(sizeof(T));
+    T value;
+    std::memcpy(&value, data.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return value;
+  }
+
+  uint64_t varint() {
+    uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      uint8_t byte = raw<uint8_t>();
+      value |= uint64_t(byte & 0x7F) << shift;
+      if (!(byte & 0x80)) return value;
+    }
+    throw std::runtime_error("bad varint in waveform file");
+  }
+
+  std::string_view bytes(size_t count) {
+    need(count);
+    std::string_view view = data.substr(pos, count);
+    pos += count;
+    return view;
+  }
+
+private:
+  std::string_view data;
+  size_t pos;
+
+  void need(size_t count) const {
+    if (count > data.size() - pos) {
+      throw std::runtime_error("truncated waveform file");
+    }
+  }
+};
+
+// Values of one signal in a payload
+static void putValue(std::string& out, const ValueType& type, const uint64_t* value) {
+  if (type.kind != TypeKind::BitVector) {
+    int64_t scalar = static_cast<int64_t>(value[0]);
+    putVarint(out, (static_cast<uint64_t>(scalar) << 1) ^ static_cast<uint64_t>(scalar >> 63));
+    return;
+  }
+  size_t bytes = (type.width() + 7) / 8;
+  for (size_t i = 0; i < bytes; i++) {
+    out += static_cast<char>(value[i / 8] >> (8 * (i % 8)));
+  }
+}
+
+static void getValue(WaveCursor& in, const ValueType& type, uint64_t* value) {
+  if (type.kind != TypeKind::BitVector) {
+    uint64_t zigzag = in.varint();
+    value[0] = (zigzag >> 1) ^ (~(zigzag & 1) + 1);
+    return;
+  }
+  size_t bytes = (type.width() + 7) / 8;
+  std::string_view data = in.bytes(bytes);
+  std::fill(value, value + (type.width() + 63) / 64, 0);
+  for (size_t i = 0; i < bytes; i++) {
+    value[i / 8] |= uint64_t(static_cast<uint8_t>(data[i])) << (8 * (i % 8));
+  }
+}
+
+// Byte-oriented LZ77: a literal run (varint length, bytes), then a match
+// (varint length - MIN_MATCH, varint distance), repeated; the stream ends
+// after a literal run once the raw size is reached.
+static constexpr size_t MIN_MATCH = 4;
+static constexpr size_t HASH_BITS = 13;
+
+static std::string compress(std::string_view input) {
+  std::string out;
+  std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0xFFFFFFFFu);
+  auto hashAt = [&input](size_t pos) {
+    uint32_t word;
+    std::memcpy(&word, input.data() + pos, sizeof(word));
+    return (word * 2654435761u) >> (32 - HASH_BITS);
+  };
+
+  size_t literal_start = 0;
+  size_t pos = 0;
+  while (pos + MIN_MATCH <= input.size()) {
+    uint32_t& slot = table[hashAt(pos)];
+    size_t candidate = slot;
+    slot = static_cast<uint32_t>(pos);
+    if (candidate == 0xFFFFFFFFu || std::memcmp(input.data() + candidate, input.data() + pos, MIN_MATCH) != 0) {
+      pos++;
+      continue;
+    }
+    size_t length = MIN_MATCH;
+    while (pos + length < input.size() && input[candidate + length] == input[pos + length]) {
+      length++;
+    }
+    putVarint(out, pos - literal_start);
+    out.append(input.data() + literal_start, pos - literal_start);
+    putVarint(out, length - MIN_MATCH);
+    putVarint(out, pos - candidate);
+    pos += length;
+    literal_start = pos;
+  }
+  putVarint(out, input.size() - literal_start);
+  out.append(input.data() + literal_start, input.size() - literal_start);
+  return out;
+}
+
+static std::string decompress(std::string_view input, size_t raw_size) {
+  std::string out;
+  out.reserve(raw_size);
+  WaveCursor in(input);
+  while (true) {
+    uint64_t literals = in.varint();
+    if (literals > raw_size - out.size()) {
+      throw std::runtime_error("bad compressed block in waveform file");
+    }
+    out.append(in.bytes(literals));
+    if (out.size() == raw_size) {
+      return out;
+    }
+    uint64_t length = in.varint() + MIN_MATCH;
+    uint64_t distance = in.varint();
+    if (distance == 0 || distance > out.size() || length > raw_size - out.size()) {
+      throw std::runtime_error("bad compressed block in waveform file");
+    }
+    for (size_t from = out.size() - distance; length > 0; length--) {
+      out += out[from++];  // byte by byte: the match may overlap its own output
+    }
+  }
+}
+
+class BinaryEncoder : public WaveformEncoder {
+public:
+  BinaryEncoder(const std::string& path, const std::vector<WaveformSignal>& signals,
+                std::vector<std::vector<uint64_t>> initial)
+    : stream(createFile(path)), signals(signals), state(std::move(initial)) {
+    out.append(WAVE_MAGIC, sizeof(WAVE_MAGIC));
+    putRaw<uint32_t>(out, WAVE_VERSION);
+    putRaw<uint32_t>(out, static_cast<uint32_t>(signals.size()));
+    for (const WaveformSignal& signal : signals) {
+      putRaw<uint8_t>(out, static_cast<uint8_t>(signal.type.kind));
+      putRaw<int64_t>(out, signal.type.left);
+      putRaw<int64_t>(out, signal.type.right);
+      putRaw<uint32_t>(out, static_cast<uint32_t>(signal.name.size()));
+      out += signal.name;
+    }
+    startBlock(0);
+  }
+
+  void change(SimTime time, uint32_t index, const uint64_t* value) override {
+    if (!block_open) {
+      startBlock(time);
+    }
+    putVarint(block, time - previous_time);
+    putVarint(block, index);
+    putValue(block, signals[index].type, value);
+    previous_time = time;
+    changes++;
+    std::copy(value, value + state[index].size(), state[index].begin());
+    if (block.size() >= BLOCK_BYTES) {
+      closeBlock();
+    }
+  }
+
+  void finish(SimTime end) override {
+    if (block_open) {
+      closeBlock();
+    }
+    uint64_t index_offset = written + out.size();
+    for (const auto& entry : index) {
+      putRaw<uint64_t>(out, entry.first);
+      putRaw<uint64_t>(out, entry.second);
+    }
+    putRaw<uint64_t>(out, index_offset);
+    putRaw<uint64_t>(out, index.size());
+    putRaw<uint64_t>(out, end);
+    out.append(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    writeOut(stream, out);
+    stream.close();
+  }
+
+private:
+  std::ofstream stream;
+  const std::vector<WaveformSignal>& signals;
+  std::vector<std::vector<uint64_t>> state;            // current value of every signal
+  std::vector<std::pair<SimTime, uint64_t>> index;     // block first time, offset
+  std::string out;
+  uint64_t written = 0;                                // bytes already in the file
+
+  std::string block;
+  bool block_open = false;
+  SimTime first_time = 0;
+  SimTime previous_time = 0;
+  uint32_t changes = 0;
+
+  void startBlock(SimTime time) {
+    block_open = true;
+    first_time = previous_time = time;
+    changes = 0;
+    block.clear();
+    for (size_t i = 0; i < signals.size(); i++) {
+      putValue(block, signals[i].type, state[i].data());
+    }
+  }
+
+  void closeBlock() {
+    std::string packed = compress(block);
+    bool stored = packed.size() >= block.size();
+    const std::string& payload = stored ? block : packed;
+    index.emplace_back(first_time, written + out.size());
+    putRaw<uint64_t>(out, first_time);
+    putRaw<uint32_t>(out, static_cast<uint32_t>(block.size()));
+    putRaw<uint32_t>(out, static_cast<uint32_t>(payload.size()));
+    putRaw<uint32_t>(out, changes);
+    out += payload;
+    block_open = false;
+    if (out.size() >= OUTPUT_BUFFER) {
+      written += out.size();
+      writeOut(stream, out);
+    }
+  }
+};
+
+// ---------------------------------------------------------------------------
+
+WaveformWriter::WaveformWriter(const Design& design, const std::string& path,
+                               const std::vector<std::string>& patterns) {
+  std::string scope = NameTable::global().str(design.entity_name);
+  std::vector<bool> matched(patterns.size(), false);
+  traced_index.assign(design.signals.size(), NOT_TRACED);
+  std::vector<std::vector<uint64_t>> initial;
+
+  for (size_t s = 0; s < design.signals.size(); s++) {
+    const SignalInfo& info = design.signals[s];
+    std::string leaf = NameTable::global().str(info.name);
+    std::string name = scope + "." + leaf;
+    bool selected = patterns.empty();
+    for (size_t p = 0; p < patterns.size(); p++) {
+      bool hierarchical = patterns[p].find('.') != std::string::npos;
+      if (matchesGlob(patterns[p], hierarchical ? name : leaf)) {
+        matched[p] = selected = true;
+      }
+    }
+    if (!selected) continue;
+
+    traced_index[s] = static_cast<uint32_t>(traced.size());
+    traced.push_back(WaveformSignal{name, info.type});
+    const Value& value = info.initial;
+    if (value.kind == TypeKind::BitVector) {
+      initial.emplace_back(value.bits.words(), value.bits.words() + value.bits.wordCount());
+    } else {
+      initial.push_back({static_cast<uint64_t>(value.scalar)});
+    }
+  }
+  for (size_t p = 0; p < patterns.size(); p++) {
+    if (!matched[p]) {
+      throw std::runtime_error("trace pattern '" + patterns[p] + "' matches no signal");
+    }
+  }
+
+  if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".vcd") == 0) {
+    encoder.reset(new VcdEncoder(path, design.entity_name, traced, initial));
+  } else {
+    encoder.reset(new BinaryEncoder(path, traced, std::move(initial)));
+  }
+
+  size_t widest = 1;
+  for (const WaveformSignal& signal : traced) {
+    widest = std::max(widest, signal.words());
+  }
+  chunks.resize(CHUNK_COUNT);
+  for (std::vector<uint64_t>& chunk : chunks) {
+    chunk.reserve(CHUNK_WORDS + 2 + widest);
+    empty_chunks.push(&chunk);
+  }
+  empty_chunks.pop(current);
+  writer = std::thread([this] { drain(); });
+}
+
+WaveformWriter::~WaveformWriter() {
+  if (writer.joinable()) {
+    try {
+      close(end_time);
+    } catch (...) {
+      // Errors are only reported through an explicit close()
+    }
+  }
+}
+
+void WaveformWriter::flush() {
+  while (!filled.push(current)) {
+    std::this_thread::yield();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+  }
+  wake.notify_one();
+  // Blocks only while the writer is a whole queue behind
+  while (!empty_chunks.pop(current)) {
+    std::this_thread::yield();
+  }
+}
+
+void WaveformWriter::close(SimTime end) {
+  if (!writer.joinable()) {
+    return;
+  }
+  if (!current->empty()) {
+    flush();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    closing = true;
+    end_time = end;
+  }
+  wake.notify_one();
+  writer.join();
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void WaveformWriter::drain() {
+  bool failed = false;
+  while (true) {
+    std::vector<uint64_t>* chunk;
+    if (filled.pop(chunk)) {
+      if (!failed) {
+        try {
+          for (size_t pos = 0; pos < chunk->size();) {
+            uint64_t time = (*chunk)[pos];
+            uint32_t index = static_cast<uint32_t>((*chunk)[pos + 1]);
+            encoder->change(time, index, chunk->data() + pos + 2);
+            pos += 2 + traced[index].words();
+          }
+        } catch (...) {
+          error = std::current_exception();
+          failed = true;  // keep draining so the simulation never blocks
+        }
+      }
+      chunk->clear();
+      empty_chunks.push(chunk);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    if (closing && filled.empty()) {
+      break;
+    }
+    wake.wait(lock, [this] { return closing || !filled.empty(); });
+  }
+
+  if (!failed) {
+    try {
+      encoder->finish(end_time);
+    } catch (...) {
+      error = std::current_exception();
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+
+std::unique_ptr<WaveformReader> WaveformReader::open(const std::string& path) {
+  std::unique_ptr<WaveformReader> reader(new WaveformReader());
+  if (!reader->file.open(path)) {
+    throw std::runtime_error("cannot open waveform file " + path);
+  }
+  std::string_view data = reader->file.view();
+  if (data.size() < sizeof(WAVE_MAGIC) + 8 + TRAILER || std::memcmp(data.data(), WAVE_MAGIC, sizeof(WAVE_MAGIC)) != 0 ||
+      std::memcmp(data.data() + data.size() - sizeof(INDEX_MAGIC), INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0) {
+    throw std::runtime_error(path + " is not a binary waveform file");
+  }
+
+  WaveCursor header(data, sizeof(WAVE_MAGIC));
+  if (header.raw<uint32_t>() != WAVE_VERSION) {
+    throw std::runtime_error(path + " was written by an incompatible version");
+  }
+  uint32_t count = header.raw<uint32_t>();
+  for (uint32_t i = 0; i < count; i++) {
+    WaveformSignal signal;
+    uint8_t kind = header.raw<uint8_t>();
+    if (kind > static_cast<uint8_t>(TypeKind::BitVector)) {
+      throw std::runtime_error("bad signal type in waveform file");
+    }
+    signal.type.kind  = static_cast<TypeKind>(kind);
+    signal.type.left  = header.raw<int64_t>();
+    signal.type.right = header.raw<int64_t>();
+    signal.name = std::string(header.bytes(header.raw<uint32_t>()));
+    reader->traced.push_back(std::move(signal));
+  }
+
+  WaveCursor trailer(data, data.size() - TRAILER);
+  uint64_t index_offset = trailer.raw<uint64_t>();
+  uint64_t blocks = trailer.raw<uint64_t>();
+  reader->end_time = trailer.raw<uint64_t>();
+  if (index_offset > data.size() || blocks > (data.size() - index_offset) / 16) {
+    throw std::runtime_error("bad block index in waveform file");
+  }
+  WaveCursor entries(data, index_offset);
+  for (uint64_t i = 0; i < blocks; i++) {
+    SimTime first = entries.raw<uint64_t>();
+    uint64_t offset = entries.raw<uint64_t>();
+    if (offset > index_offset) {
+      throw std::runtime_error("bad block index in waveform file");
+    }
+    reader->index.push_back(BlockEntry{first, offset});
+  }
+  if (reader->index.empty()) {
+    throw std::runtime_error("waveform file has no blocks");
+  }
+  return reader;
+}
+
+std::vector<Value> WaveformReader::valuesAt(SimTime time) const {
+  // Last block starting at or before `time`; its leading values hold everything before it
+  auto after = std::upper_bound(index.begin(), index.end(), time,
+                                [](SimTime t, const BlockEntry& entry) { return t < entry.first_time; });
+  const BlockEntry& entry = after == index.begin() ? index.front() : *(after - 1);
+
+  std::string_view data = file.view();
+  WaveCursor header(data, entry.offset);
+  SimTime current = header.raw<uint64_t>();
+  uint32_t raw_size = header.raw<uint32_t>();
+  uint32_t stored_size = header.raw<uint32_t>();
+  uint32_t changes = header.raw<uint32_t>();
+  std::string_view stored = header.bytes(stored_size);
+  std::string unpacked;
+  if (stored_size != raw_size) {
+    unpacked = decompress(stored, raw_size);
+    stored = unpacked;
+  }
+
+  WaveCursor in(stored);
+  std::vector<std::vector<uint64_t>> state(traced.size());
+  for (size_t i = 0; i < traced.size(); i++) {
+    state[i].resize(traced[i].words());
+    getValue(in, traced[i].type, state[i].data());
+  }
+  for (uint32_t c = 0; c < changes; c++) {
+    current += in.varint();
+    if (current > time) break;
+    uint64_t index = in.varint();
+    if (index >= traced.size()) {
+      throw std::runtime_error("bad signal index in waveform file");
+    }
+    getValue(in, traced[index].type, state[index].data());
+  }
+
+  std::vector<Value> values;
+  for (size_t i = 0; i < traced.size(); i++) {
+    const ValueType& type = traced[i].type;
+    Value value = Value::defaultFor(type);
+    if (type.kind == TypeKind::BitVector) {
+      std::copy(state[i].begin(), state[i].end(), value.bits.words());
+    } else {
+      value.scalar = static_cast<int64_t>(state[i][0]);
+    }
+    values.push_back(std::move(value));
+  }
+  return values;
+}
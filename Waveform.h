@@ -0,0 +1,144 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "Elaborate.h"
+#include "SourceBuffer.h"
+#include "SpscQueue.h"
+#include "Value.h"
+
+// Waveform recording. The simulator hands every value change of a traced
+// signal to a WaveformWriter, which only appends it to a chunk in memory;
+// full chunks go through a lock-free queue to a writer thread that encodes
+// them, so formatting and I/O stay off the simulation thread.
+//
+// Two formats are written: standard VCD, and a binary format of independently
+// compressed blocks. Each binary block starts with the values of every traced
+// signal and the file ends with an index of block start times, so a reader
+// can jump to any time by decoding a single block (see WaveformReader).
+
+// A traced signal, named hierarchically: "entity.signal".
+struct WaveformSignal {
+  std::string name;
+  ValueType   type;
+
+  // 64-bit words of a value in the change records
+  size_t words() const {
+    return type.kind == TypeKind::BitVector ? (type.width() + 63) / 64 : 1;
+  }
+};
+
+// True when `path` matches the glob `pattern`: `?` is any one character and
+// `*` any run of characters within one level of the hierarchy (no '.'), while
+// `**` also crosses levels. Case is ignored, as in VHDL names.
+bool matchesGlob(std::string_view pattern, std::string_view path);
+
+class WaveformEncoder;
+
+class WaveformWriter {
+public:
+  // Traces the signals of `design` whose hierarchical name matches one of
+  // `patterns`; a pattern without a '.' is matched against the signal's own
+  // name at any level. A path ending in ".vcd" gets VCD, any other the binary
+  // format. Throws std::runtime_error when the file cannot be created or a
+  // pattern matches no signal.
+  WaveformWriter(const Design& design, const std::string& path, const std::vector<std::string>& patterns);
+  ~WaveformWriter();
+
+  WaveformWriter(const WaveformWriter&) = delete;
+  WaveformWriter& operator=(const WaveformWriter&) = delete;
+
+  bool traces(uint32_t signal) const {
+    return traced_index[signal] != NOT_TRACED;
+  }
+
+  // Records that traced `signal` took `value` at `time`. Calls come from one
+  // thread, in time order.
+  void record(SimTime time, uint32_t signal, const Value& value) {
+    std::vector<uint64_t>& words = *current;
+    words.push_back(time);
+    words.push_back(traced_index[signal]);
+    if (value.kind == TypeKind::BitVector) {
+      words.insert(words.end(), value.bits.words(), value.bits.words() + value.bits.wordCount());
+    } else {
+      words.push_back(static_cast<uint64_t>(value.scalar));
+    }
+    if (words.size() >= CHUNK_WORDS) {
+      flush();
+    }
+  }
+
+  // Hands over what is left, ends the waveform at `end` and waits for the
+  // writer thread. Rethrows the writer's error, if it had one.
+  void close(SimTime end);
+
+  const std::vector<WaveformSignal>& signals() const {
+    return traced;
+  }
+
+  static constexpr size_t CHUNK_WORDS = 1 << 15;
+  static constexpr size_t CHUNK_COUNT = 8;
+
+private:
+  static constexpr uint32_t NOT_TRACED = 0xFFFFFFFFu;
+
+  std::vector<WaveformSignal> traced;
+  std::vector<uint32_t> traced_index;          // signal -> index into `traced`
+  std::unique_ptr<WaveformEncoder> encoder;    // used by the writer thread only
+
+  std::vector<std::vector<uint64_t>> chunks;   // never resized, so the pointers stay valid
+  std::vector<uint64_t>* current = nullptr;    // being filled by the simulation thread
+  SpscQueue<std::vector<uint64_t>*> filled{CHUNK_COUNT};
+  SpscQueue<std::vector<uint64_t>*> empty_chunks{CHUNK_COUNT};
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  bool closing = false;
+  SimTime end_time = 0;
+  std::exception_ptr error;
+  std::thread writer;
+
+  void flush();
+  void drain();
+};
+
+// Random access to a binary waveform file.
+class WaveformReader {
+public:
+  // Throws std::runtime_error when `path` is not a binary waveform.
+  static std::unique_ptr<WaveformReader> open(const std::string& path);
+
+  const std::vector<WaveformSignal>& signals() const {
+    return traced;
+  }
+
+  SimTime endTime() const {
+    return end_time;
+  }
+
+  size_t blockCount() const {
+    return index.size();
+  }
+
+  // The value of every signal after all changes at `time`.
+  std::vector<Value> valuesAt(SimTime time) const;
+
+private:
+  struct BlockEntry {
+    SimTime  first_time;
+    uint64_t offset;
+  };
+
+  WaveformReader() = default;
+
+  SourceBuffer file;
+  std::vector<WaveformSignal> traced;
+  std::vector<BlockEntry> index;
+  SimTime end_time = 0;
+};
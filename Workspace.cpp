@@ -0,0 +1,280 @@
+#include "Workspace.h"
+#include <algorithm>
+#include <stdexcept>
+#include "SourceBuffer.h"
+#include "Lexer.h"
+#include "TokenStream.h"
+#include "Parser.h"
+
+Workspace::File& Workspace::find(const std::string& path) {
+  auto it = files.find(path);
+  if (it == files.end()) {
+    throw std::runtime_error(path + " is not open");
+  }
+  return it->second;
+}
+
+const Workspace::File& Workspace::find(const std::string& path) const {
+  return const_cast<Workspace*>(this)->find(path);
+}
+
+// Token offsets are relative to the start of the line
+void Workspace::lexLine(Line& line) {
+  line.tokens.clear();
+  line.error = Token();
+  Lexer lexer(*line.text);
+  while (true) {
+    Token token = lexer.getNextToken();
+    if (token.getTokenType() == TokenType::EoF) {
+      return;
+    }
+    if (token.getTokenType() == TokenType::Error) {
+      line.error = token;  // the lexer does not move past an error
+      return;
+    }
+    line.tokens.push_back(token);
+  }
+}
+
+// The last token before `position`, or null at the start of the file
+const Token* Workspace::tokenBefore(const File& file, Position position) {
+  if (position.line < file.lines.size() && position.token > 0) {
+    return &file.lines[position.line].tokens[position.token - 1];
+  }
+  for (size_t line = std::min(position.line, file.lines.size()); line-- > 0;) {
+    if (!file.lines[line].tokens.empty()) {
+      return &file.lines[line].tokens.back();
+    }
+  }
+  return nullptr;
+}
+
+bool Workspace::startsUnit(const Token& token, const Token* previous) {
+  if (token.getTokenType() != TokenType::Keyword ||
+      (token.getKeyword() != Keyword::Entity && token.getKeyword() != Keyword::Architecture)) {
+    return false;
+  }
+  return !previous || previous->getTokenType() != TokenType::Keyword || previous->getKeyword() != Keyword::End;
+}
+
+// Starts of the design units in [from, to)
+std::vector<Workspace::Position> Workspace::unitStarts(const File& file, Position from, Position to) {
+  std::vector<Position> starts;
+  const Token* previous = tokenBefore(file, from);
+  for (size_t line = from.line; line < file.lines.size() && line <= to.line; line++) {
+    const std::vector<Token>& tokens = file.lines[line].tokens;
+    for (size_t token = line == from.line ? from.token : 0; token < tokens.size(); token++) {
+      Position position{line, token};
+      if (!(position < to)) {
+        return starts;
+      }
+      if (startsUnit(tokens[token], previous)) {
+        starts.push_back(position);
+      }
+      previous = &tokens[token];
+    }
+  }
+  return starts;
+}
+
+// Parses the tokens of [unit.start, end). A lexing error on one of its lines
+// leaves the unit failed without a syntax diagnostic of its own.
+void Workspace::parseUnit(const File& file, Unit& unit, Position end) {
+  unit.tree = VhdlFile();
+  unit.failed = false;
+  unit.errors.clear();
+
+  // Offsets are rebased onto the unit's lines as if they were one text
+  // starting at the unit's first line; lines may have moved since lexing.
+  std::vector<Token> tokens;
+  LineIndex lines(static_cast<int>(unit.start.line + 1));
+  size_t base = 0;
+  for (size_t index = unit.start.line; index < file.lines.size() && index <= end.line; index++) {
+    const Line& line = file.lines[index];
+    if (index > unit.start.line) {
+      lines.addLine(base);
+    }
+    size_t first = index == unit.start.line ? unit.start.token : 0;
+    size_t last  = index == end.line ? end.token : line.tokens.size();
+    for (size_t token = first; token < last; token++) {
+      tokens.push_back(line.tokens[token]);
+      tokens.back().setOffset(base + line.tokens[token].getOffset());
+    }
+    if (index < end.line && line.error.getTokenType() == TokenType::Error) {
+      unit.failed = true;
+    }
+    base += line.text->size() + 1;
+  }
+  // Errors at the end of the unit point after its last token
+  size_t last = tokens.empty() ? 0 : tokens.back().getOffset() + tokens.back().getText().size();
+  tokens.push_back(Token(TokenType::EoF, "", last));
+  if (unit.failed) {
+    return;
+  }
+
+  TokenStream stream(tokens, lines);
+  Parser parser(stream);
+  unit.errors = parser.parseRecovering();
+  unit.failed = !unit.errors.empty();
+  unit.tree = std::move(parser.getTree());
+}
+
+Workspace::EditResult Workspace::open(const std::string& path) {
+  SourceBuffer source;
+  if (!source.open(path)) {
+    throw std::runtime_error("cannot open " + path);
+  }
+  return load(path, source.view());
+}
+
+Workspace::EditResult Workspace::load(const std::string& path, std::string_view text) {
+  File file;
+  for (size_t start = 0; start < text.size();) {
+    size_t end = std::min(text.find('\n', start), text.size());
+    Line line;
+    line.text.reset(new std::string(text.substr(start, end - start)));
+    lexLine(line);
+    file.lines.push_back(std::move(line));
+    start = end + 1;
+  }
+
+  Position end{file.lines.size(), 0};
+  std::vector<Position> starts = unitStarts(file, Position{}, end);
+  file.units.resize(starts.size());
+  for (size_t i = 0; i < starts.size(); i++) {
+    file.units[i].start = starts[i];
+    parseUnit(file, file.units[i], i + 1 < starts.size() ? starts[i + 1] : end);
+  }
+
+  EditResult result{file.lines.size(), file.units.size()};
+  files[path] = std::move(file);
+  return result;
+}
+
+bool Workspace::close(const std::string& path) {
+  return files.erase(path) > 0;
+}
+
+Workspace::EditResult Workspace::edit(const std::string& path, size_t first_line, size_t removed,
+                                      const std::vector<std::string>& lines) {
+  File& file = find(path);
+  if (first_line == 0 || first_line - 1 > file.lines.size() || removed > file.lines.size() - (first_line - 1)) {
+    throw std::runtime_error("lines " + std::to_string(first_line) + "-" + std::to_string(first_line + removed) +
+                             " are outside " + path);
+  }
+  size_t edited = first_line - 1;
+  std::ptrdiff_t shift = static_cast<std::ptrdiff_t>(lines.size()) - static_cast<std::ptrdiff_t>(removed);
+  std::vector<Unit>& units = file.units;
+
+  // The units that may change: from the last one starting before the edit
+  // (it may now run on or end earlier) up to the first one starting after it
+  auto starts_at_or_after = [&units](size_t line) {
+    return static_cast<size_t>(std::partition_point(units.begin(), units.end(),
+                                                    [line](const Unit& unit) { return unit.start.line < line; }) -
+                               units.begin());
+  };
+  size_t low = starts_at_or_after(edited);
+  Position region_start;
+  if (low > 0) {
+    low--;
+    region_start = units[low].start;
+  }
+  size_t high = starts_at_or_after(edited + removed);
+  std::vector<Position> old_ends;  // of units[low, high), before lines move
+  for (size_t u = low; u < high; u++) {
+    old_ends.push_back(u + 1 < units.size() ? units[u + 1].start : Position{file.lines.size(), 0});
+  }
+
+  file.lines.erase(file.lines.begin() + static_cast<std::ptrdiff_t>(edited),
+                   file.lines.begin() + static_cast<std::ptrdiff_t>(edited + removed));
+  std::vector<Line> added(lines.size());
+  for (size_t i = 0; i < lines.size(); i++) {
+    added[i].text.reset(new std::string(lines[i]));
+    lexLine(added[i]);
+  }
+  file.lines.insert(file.lines.begin() + static_cast<std::ptrdiff_t>(edited),
+                    std::make_move_iterator(added.begin()), std::make_move_iterator(added.end()));
+  for (size_t u = high; u < units.size(); u++) {
+    units[u].start.line = static_cast<size_t>(static_cast<std::ptrdiff_t>(units[u].start.line) + shift);
+  }
+
+  // A unit after the edit stops being one if, say, an `end` was typed before it
+  while (high < units.size() &&
+         !startsUnit(file.lines[units[high].start.line].tokens[units[high].start.token],
+                     tokenBefore(file, units[high].start))) {
+    high++;
+  }
+  Position file_end{file.lines.size(), 0};
+  Position region_end = high < units.size() ? units[high].start : file_end;
+
+  EditResult result{lines.size(), 0};
+  std::vector<Position> starts = unitStarts(file, region_start, region_end);
+  std::vector<Unit> replacement(starts.size());
+  for (size_t i = 0; i < starts.size(); i++) {
+    Unit& unit = replacement[i];
+    unit.start = starts[i];
+    Position end = i + 1 < starts.size() ? starts[i + 1] : region_end;
+
+    // A unit that ended before the edit and still spans the same tokens keeps its tree
+    bool reused = false;
+    if (!(Position{edited, 0} < end)) {
+      for (size_t u = low; u < high; u++) {
+        if (units[u].start == unit.start && old_ends[u - low] == end) {
+          unit = std::move(units[u]);
+          reused = true;
+          break;
+        }
+      }
+    }
+    if (!reused) {
+      parseUnit(file, unit, end);
+      result.reparsed_units++;
+    }
+  }
+  units.erase(units.begin() + static_cast<std::ptrdiff_t>(low), units.begin() + static_cast<std::ptrdiff_t>(high));
+  units.insert(units.begin() + static_cast<std::ptrdiff_t>(low),
+               std::make_move_iterator(replacement.begin()), std::make_move_iterator(replacement.end()));
+
+  // Syntax errors further down name lines that have moved
+  if (shift != 0) {
+    for (size_t u = low + replacement.size(); u < units.size(); u++) {
+      if (!units[u].errors.empty()) {
+        parseUnit(file, units[u], u + 1 < units.size() ? units[u + 1].start : file_end);
+        result.reparsed_units++;
+      }
+    }
+  }
+  return result;
+}
+
+std::vector<Diagnostic> Workspace::diagnostics(const std::string& path) const {
+  const File& file = find(path);
+  std::vector<Diagnostic> diagnostics;
+  for (size_t index = 0; index < file.lines.size(); index++) {
+    const Token& error = file.lines[index].error;
+    if (error.getTokenType() == TokenType::Error) {
+      diagnostics.push_back(Diagnostic{static_cast<int>(index + 1), static_cast<int>(error.getOffset()), std::string(error.getText())});
+    }
+  }
+  for (const Unit& unit : file.units) {
+    diagnostics.insert(diagnostics.end(), unit.errors.begin(), unit.errors.end());
+  }
+  std::stable_sort(diagnostics.begin(), diagnostics.end(), [](const Diagnostic& a, const Diagnostic& b) {
+    return a.line < b.line || (a.line == b.line && a.col < b.col);
+  });
+  return diagnostics;
+}
+
+size_t Workspace::lineCount(const std::string& path) const {
+  return find(path).lines.size();
+}
+
+std::vector<const VhdlFile*> Workspace::units(const std::string& path) const {
+  std::vector<const VhdlFile*> trees;
+  for (const Unit& unit : find(path).units) {
+    if (!unit.failed) {
+      trees.push_back(&unit.tree);
+    }
+  }
+  return trees;
+}
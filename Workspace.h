@@ -0,0 +1,99 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "Token.h"
+#include "Node.h"
+#include "Parser.h"
+
+// Front-end state of files kept open by a long-lived process such as an
+// editor or lint service, updated incrementally as they are edited.
+//
+// Each file is held as lines, and every line keeps its own tokens. Lines are
+// lexed one at a time (VHDL tokens never span lines), so an edit re-lexes
+// only the lines it replaces. The tokens are grouped into design units, each
+// starting at an `entity` or `architecture` keyword that does not follow
+// `end`, and every unit is parsed into a VhdlFile of its own, recovering from
+// syntax errors so that all of them are reported. After an edit
+// only the units that overlap the edited lines are segmented and parsed
+// again; the others keep their trees.
+class Workspace {
+public:
+  struct EditResult {
+    size_t relexed_lines  = 0;
+    size_t reparsed_units = 0;
+  };
+
+  // Reads `path` from disk, replacing any open copy. Throws
+  // std::runtime_error if it cannot be read.
+  EditResult open(const std::string& path);
+
+  // Opens `path` with the given contents instead of reading it.
+  EditResult load(const std::string& path, std::string_view text);
+
+  // Returns false if `path` was not open.
+  bool close(const std::string& path);
+
+  // Replaces `removed` lines starting at 1-based `first_line` with `lines`
+  // (given without line terminators); `first_line` may be one past the last
+  // line to append. Throws std::runtime_error if `path` is not open or the
+  // range is outside the file.
+  EditResult edit(const std::string& path, size_t first_line, size_t removed, const std::vector<std::string>& lines);
+
+  // Lexing errors, one per line at most, and the syntax errors of every
+  // design unit, in line order.
+  std::vector<Diagnostic> diagnostics(const std::string& path) const;
+
+  size_t lineCount(const std::string& path) const;
+
+  // The parsed design units of `path` in file order, skipping units with errors.
+  std::vector<const VhdlFile*> units(const std::string& path) const;
+
+private:
+  // Token position: line index and index among that line's tokens
+  struct Position {
+    size_t line  = 0;
+    size_t token = 0;
+
+    bool operator==(const Position& other) const {
+      return line == other.line && token == other.token;
+    }
+    bool operator<(const Position& other) const {
+      return line < other.line || (line == other.line && token < other.token);
+    }
+  };
+
+  struct Line {
+    // Tokens are views into the text, so it is kept at a stable address
+    // while the vector of lines shifts around it.
+    std::unique_ptr<std::string> text;
+    std::vector<Token> tokens;  // offsets from the start of the line
+    Token error;                // TokenType::Error if lexing stopped early
+  };
+
+  struct Unit {
+    Position start;
+    VhdlFile tree;
+    bool failed = false;        // a lexing or syntax error; `tree` is incomplete
+    std::vector<Diagnostic> errors;  // the syntax errors
+  };
+
+  struct File {
+    std::vector<Line> lines;
+    std::vector<Unit> units;    // ordered by start
+  };
+
+  std::unordered_map<std::string, File> files;
+
+  File& find(const std::string& path);
+  const File& find(const std::string& path) const;
+
+  static void lexLine(Line& line);
+  static const Token* tokenBefore(const File& file, Position position);
+  static bool startsUnit(const Token& token, const Token* previous);
+  static std::vector<Position> unitStarts(const File& file, Position from, Position to);
+  static void parseUnit(const File& file, Unit& unit, Position end);
+};